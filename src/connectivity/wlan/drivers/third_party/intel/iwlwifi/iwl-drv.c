@@ -42,6 +42,7 @@
 #include <threads.h>
 #include <zircon/listnode.h>
 #include <zircon/status.h>
+#include <zircon/syscalls.h>
 
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/fw/img.h"
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/iwl-agn-hw.h"
@@ -1398,6 +1399,7 @@ static struct iwl_op_mode* _iwl_op_mode_start(struct iwl_drv* drv,
   }
 
   iwl_stats_init(drv->trans->dev->irq_dispatcher);
+  iwl_stats_publish(drv->trans->dev->inspector);
   iwl_stats_start_reporting();
 
   return op_mode;
@@ -1408,6 +1410,7 @@ static void _iwl_op_mode_stop(struct iwl_drv* drv) {
   if (drv->op_mode) {
     iwl_op_mode_stop(drv->op_mode);
     drv->op_mode = NULL;
+    iwl_stats_publish(NULL);
 
 #ifdef CPTCFG_IWLWIFI_DEBUGFS
     debugfs_remove_recursive(drv->dbgfs_op_mode);
@@ -1436,6 +1439,7 @@ static void iwl_req_fw_callback(struct firmware* ucode_raw, void* context) {
   size_t i;
   bool load_module = false;
   bool usniffer_images = false;
+  zx_time_t parse_start = zx_clock_get_monotonic();
 
 #ifdef CPTCFG_IWLWIFI_SUPPORT_DEBUG_OVERRIDES
   const struct firmware* fw_dbg_config;
@@ -1688,7 +1692,8 @@ static void iwl_req_fw_callback(struct firmware* ucode_raw, void* context) {
     op = &iwlwifi_opmode_table[TRANS_TEST_OP_MODE];
   }
 #endif
-  IWL_INFO(drv, "loaded firmware version %s op_mode %s\n", drv->fw.fw_version, op->name);
+  IWL_INFO(drv, "loaded firmware version %s op_mode %s (parsed in %ld us)\n", drv->fw.fw_version,
+           op->name, (zx_clock_get_monotonic() - parse_start) / 1000);
 
   /* add this device to the list of devices using this op_mode */
   list_add_tail(&op->drv, &drv->list);
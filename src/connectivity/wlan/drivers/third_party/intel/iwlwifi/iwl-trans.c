@@ -37,6 +37,7 @@
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/iwl-constants.h"
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/iwl-drv.h"
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/iwl-fh.h"
+#include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/iwl-io.h"
 
 struct iwl_trans* iwl_trans_alloc(unsigned int priv_size, struct device* dev,
                                   const struct iwl_cfg* cfg, struct iwl_trans_ops* ops) {
@@ -81,6 +82,10 @@ zx_status_t iwl_trans_send_cmd(struct iwl_trans* trans, struct iwl_host_cmd* cmd
     return ZX_ERR_IO_INVALID;
   }
 
+  if (WARN_ON(cmd->complete && !(cmd->flags & CMD_ASYNC))) {
+    return ZX_ERR_IO_INVALID;
+  }
+
   if (trans->wide_cmd_header && !iwl_cmd_groupid(cmd->id)) {
     cmd->id = DEF_ID(cmd->id);
   }
@@ -95,6 +100,78 @@ zx_status_t iwl_trans_send_cmd(struct iwl_trans* trans, struct iwl_host_cmd* cmd
   return ret;
 }
 
+// The firmware is expected to answer every command within this time (the same bound as for a SYNC
+// command), so it applies to the last command of a batch.
+#define HCMD_BATCH_TIMEOUT ZX_SEC(2)
+
+void iwl_hcmd_batch_init(struct iwl_hcmd_batch* batch) {
+  mtx_init(&batch->lock, mtx_plain);
+  sync_completion_signal(&batch->done);
+  batch->pending = 0;
+  batch->status = ZX_OK;
+}
+
+static void iwl_hcmd_batch_complete(void* ctx, zx_status_t status, struct iwl_rx_packet* pkt) {
+  struct iwl_hcmd_batch* batch = ctx;
+
+  mtx_lock(&batch->lock);
+  if (status != ZX_OK && batch->status == ZX_OK) {
+    batch->status = status;
+  }
+  if (--batch->pending == 0) {
+    sync_completion_signal(&batch->done);
+  }
+  mtx_unlock(&batch->lock);
+}
+
+zx_status_t iwl_trans_send_cmd_batched(struct iwl_trans* trans, struct iwl_hcmd_batch* batch,
+                                       struct iwl_host_cmd* cmd) {
+  // The command queue would not keep the order of a high priority command, and a NOCOPY buffer is
+  // usually on the stack of the caller, which is gone by the time the command is fetched.
+  if (WARN_ON(cmd->flags & (CMD_ASYNC | CMD_WANT_SKB | CMD_HIGH_PRIO)) || WARN_ON(cmd->complete)) {
+    return ZX_ERR_INVALID_ARGS;
+  }
+  for (int i = 0; i < IWL_MAX_CMD_TBS_PER_TFD; i++) {
+    if (WARN_ON(cmd->dataflags[i] & IWL_HCMD_DFL_NOCOPY)) {
+      return ZX_ERR_INVALID_ARGS;
+    }
+  }
+
+  mtx_lock(&batch->lock);
+  if (batch->pending++ == 0) {
+    sync_completion_reset(&batch->done);
+  }
+  mtx_unlock(&batch->lock);
+
+  cmd->flags |= CMD_ASYNC;
+  cmd->complete = iwl_hcmd_batch_complete;
+  cmd->complete_ctx = batch;
+  zx_status_t ret = iwl_trans_send_cmd(trans, cmd);
+  if (ret != ZX_OK) {
+    // The transport did not take the command, so its completion will never be called.
+    iwl_hcmd_batch_complete(batch, ZX_OK, NULL);
+  }
+
+  return ret;
+}
+
+zx_status_t iwl_hcmd_batch_wait(struct iwl_trans* trans, struct iwl_hcmd_batch* batch) {
+  zx_status_t ret = sync_completion_wait(&batch->done, HCMD_BATCH_TIMEOUT);
+  if (ret != ZX_OK) {
+    IWL_ERR(trans, "Timed out waiting for batched host commands\n");
+    iwl_force_nmi(trans);
+    iwl_trans_fw_error(trans);
+    return ZX_ERR_TIMED_OUT;
+  }
+
+  mtx_lock(&batch->lock);
+  ret = batch->status;
+  batch->status = ZX_OK;
+  mtx_unlock(&batch->lock);
+
+  return ret;
+}
+
 /* Comparator for struct iwl_hcmd_names.
  * Used in the binary search over a list of host commands.
  *
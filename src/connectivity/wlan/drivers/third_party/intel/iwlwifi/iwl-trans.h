@@ -36,6 +36,9 @@
 #ifndef SRC_CONNECTIVITY_WLAN_DRIVERS_THIRD_PARTY_INTEL_IWLWIFI_IWL_TRANS_H_
 #define SRC_CONNECTIVITY_WLAN_DRIVERS_THIRD_PARTY_INTEL_IWLWIFI_IWL_TRANS_H_
 
+#include <lib/sync/completion.h>
+#include <threads.h>
+
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/fw/img.h"
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/iwl-config.h"
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/iwl-debug.h"
@@ -146,6 +149,10 @@ static inline uint32_t iwl_rx_packet_payload_len(const struct iwl_rx_packet* pkt
  *  (i.e. mark it as non-idle).
  * @CMD_WANT_ASYNC_CALLBACK: the op_mode's async callback function must be
  *  called after this command completes. Valid only with CMD_ASYNC.
+ * @CMD_PIPELINED: Not valid with CMD_ASYNC or CMD_WANT_SKB. The caller doesn't
+ *  depend on the completion of this command to go on. It is sent without
+ *  waiting for the response when the op_mode has a command batch open (see
+ *  struct iwl_hcmd_batch), and as a normal SYNC command otherwise.
  */
 enum CMD_MODE {
   CMD_ASYNC = BIT(0),
@@ -156,6 +163,7 @@ enum CMD_MODE {
   CMD_MAKE_TRANS_IDLE = BIT(5),
   CMD_WAKE_UP_TRANS = BIT(6),
   CMD_WANT_ASYNC_CALLBACK = BIT(7),
+  CMD_PIPELINED = BIT(8),
 };
 
 #define DEF_CMD_PAYLOAD_SIZE 320
@@ -212,6 +220,18 @@ enum iwl_hcmd_dataflag {
   IWL_HCMD_DFL_DUP = BIT(1),
 };
 
+/**
+ * iwl_hcmd_complete_t - completion callback of a host command
+ *
+ * @ctx: the complete_ctx of the command
+ * @status: ZX_OK if the firmware has responded
+ * @pkt: the response, only valid during the callback. NULL if @status is not ZX_OK.
+ *
+ * Called from the RX path with the command queue locked: it must neither block
+ * nor send host commands.
+ */
+typedef void (*iwl_hcmd_complete_t)(void* ctx, zx_status_t status, struct iwl_rx_packet* pkt);
+
 /**
  * struct iwl_host_cmd - Host command to the uCode
  *
@@ -225,6 +245,10 @@ enum iwl_hcmd_dataflag {
  * @dataflags: IWL_HCMD_DFL_*
  * @id: command id of the host command, for wide commands encoding the
  *  version and group as well
+ * @complete: if set, called once the firmware has responded to this CMD_ASYNC
+ *  command, or with ZX_ERR_CANCELED when the command queue is torn down before
+ *  that. It is only called if the transport accepted the command.
+ * @complete_ctx: passed to @complete
  */
 struct iwl_host_cmd {
   const void* data[IWL_MAX_CMD_TBS_PER_TFD];
@@ -234,6 +258,33 @@ struct iwl_host_cmd {
   uint32_t id;
   uint16_t len[IWL_MAX_CMD_TBS_PER_TFD];
   uint8_t dataflags[IWL_MAX_CMD_TBS_PER_TFD];
+
+  iwl_hcmd_complete_t complete;
+  void* complete_ctx;
+};
+
+/**
+ * struct iwl_hcmd_batch - host commands in flight together
+ *
+ * Commands sent with iwl_trans_send_cmd_batched() are queued to the firmware
+ * without waiting for each response. The command queue is executed in order, so
+ * the firmware sees the same sequence as with SYNC commands; only the round
+ * trips overlap. iwl_hcmd_batch_wait() waits for all of them and returns the
+ * first error.
+ *
+ * A SYNC command sent while a batch is in flight completes after all the
+ * commands queued before it, so it can be freely mixed in.
+ *
+ * @lock: protects @pending and @status
+ * @done: signaled when @pending drops to 0
+ * @pending: number of commands queued but not completed yet
+ * @status: the first error reported by a completed command
+ */
+struct iwl_hcmd_batch {
+  mtx_t lock;
+  sync_completion_t done;
+  int pending;
+  zx_status_t status;
 };
 
 // Originally used by Linux to release the page mapping (says _rx_page_addr). But we don't need this
@@ -378,6 +429,11 @@ struct iwl_hcmd_arr {
  *  in DWORD (as opposed to bytes)
  * @scd_set_active: should the transport configure the SCD for HCMD queue
  * @sw_csum_tx: transport should compute the TCP checksum
+ * @tx_batch_size: number of data frames the transport may queue on a TX queue
+ *  before it rings the doorbell; 0 or 1 disables batching
+ * @tx_batch_timeout: max time a queued data frame waits for its doorbell
+ * @rx_queue_threads: process the RSS RX queues on their own threads; when
+ *  unset, all the RX queues are processed on the interrupt thread
  * @command_groups: array of command groups, each member is an array of the
  *  commands in the group; for debugging only
  * @command_groups_size: number of command groups, to avoid illegal access
@@ -397,6 +453,9 @@ struct iwl_trans_config {
   bool bc_table_dword;
   bool scd_set_active;
   bool sw_csum_tx;
+  int tx_batch_size;
+  zx_duration_t tx_batch_timeout;
+  bool rx_queue_threads;
   const struct iwl_hcmd_arr* command_groups;
   int command_groups_size;
 
@@ -889,6 +948,17 @@ static inline struct iwl_trans_dump_data* iwl_trans_dump_data(struct iwl_trans*
 // It is called ERFKILL originally. We remap it to ZX_ERR_BAD_STATE in Fuchsia.
 zx_status_t iwl_trans_send_cmd(struct iwl_trans* trans, struct iwl_host_cmd* cmd);
 
+void iwl_hcmd_batch_init(struct iwl_hcmd_batch* batch);
+
+// Queue a host command to the firmware as part of 'batch', without waiting for its response. The
+// command must be a SYNC command without CMD_WANT_SKB; it is sent as CMD_ASYNC.
+zx_status_t iwl_trans_send_cmd_batched(struct iwl_trans* trans, struct iwl_hcmd_batch* batch,
+                                       struct iwl_host_cmd* cmd);
+
+// Wait for all the commands queued in 'batch' to complete. Returns the first error, and resets the
+// error so that the batch can be reused.
+zx_status_t iwl_hcmd_batch_wait(struct iwl_trans* trans, struct iwl_hcmd_batch* batch);
+
 static inline void iwl_trans_free_tx_cmd(struct iwl_trans* trans, struct iwl_device_cmd* dev_cmd) {
   free(dev_cmd);
 }
@@ -228,6 +228,13 @@
 
 #endif /* CPTCFG_IWLWIFI_SUPPORT_DEBUG_OVERRIDES */
 
+/* TX doorbell coalescing: frames per batch and max time a frame waits for its doorbell */
+#define IWL_MVM_TX_BATCH_SIZE 8
+#define IWL_MVM_TX_BATCH_TIMEOUT_USEC 100
+
+/* Process the RSS RX queues on their own threads instead of on the interrupt thread */
+#define IWL_MVM_RX_QUEUE_THREADS 0
+
 /* Default values for the FTM range_request_ext command: */
 #define IWL_MVM_FTM_REQ_EXT_TSF_TIMER_OFFSET_MSEC_DFLT 5
 #define IWL_MVM_FTM_REQ_EXT_MIN_DELTA_FTM_DFLT 0
@@ -34,6 +34,7 @@
  *
  *****************************************************************************/
 #include <zircon/status.h>
+#include <zircon/syscalls.h>
 
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/fw/acpi.h"
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/fw/dbg.h"
@@ -268,6 +269,7 @@ static zx_status_t iwl_mvm_load_ucode_wait_alive(struct iwl_mvm* mvm,
   zx_status_t ret;
   enum iwl_ucode_type old_type = mvm->fwrt.cur_fw_img;
   static const uint16_t alive_cmd[] = {MVM_ALIVE};
+  zx_time_t start, loaded;
 
   set_bit(IWL_FWRT_STATUS_WAIT_ALIVE, &mvm->fwrt.status);
   if (ucode_type == IWL_UCODE_REGULAR &&
@@ -286,12 +288,14 @@ static zx_status_t iwl_mvm_load_ucode_wait_alive(struct iwl_mvm* mvm,
   iwl_init_notification_wait(&mvm->notif_wait, &alive_wait, alive_cmd, ARRAY_SIZE(alive_cmd),
                              iwl_alive_fn, &alive_data);
 
+  start = zx_clock_get_monotonic();
   ret = iwl_trans_start_fw(mvm->trans, fw, ucode_type == IWL_UCODE_INIT);
   if (ret != ZX_OK) {
     iwl_fw_set_current_image(&mvm->fwrt, old_type);
     iwl_remove_notification(&mvm->notif_wait, &alive_wait);
     return ret;
   }
+  loaded = zx_clock_get_monotonic();
 
   /*
    * Some things may run in the background now, but we
@@ -318,6 +322,9 @@ static zx_status_t iwl_mvm_load_ucode_wait_alive(struct iwl_mvm* mvm,
     return ZX_ERR_IO_INVALID;
   }
 
+  IWL_INFO(mvm, "ucode type %d alive: start %ld us, ALIVE wait %ld us\n", ucode_type,
+           (loaded - start) / 1000, (zx_clock_get_monotonic() - loaded) / 1000);
+
   iwl_trans_fw_alive(mvm->trans, alive_data.scd_base_addr);
 
   /*
@@ -587,7 +587,11 @@ zx_status_t iwl_mvm_mac_tx(struct iwl_mvm_vif* mvmvif, struct iwl_mvm_sta* mvmst
     return ZX_ERR_INVALID_ARGS;
   }
 
-  return iwl_mvm_tx_skb(mvmvif->mvm, pkt, mvmsta);
+  zx_status_t ret = iwl_mvm_tx_skb(mvmvif->mvm, pkt, mvmsta);
+  if (ret == ZX_OK && ieee80211_is_action(pkt->common_header)) {
+    iwl_mvm_sta_tx_ba_action(mvmvif->mvm, mvmsta, pkt->body, pkt->body_size);
+  }
+  return ret;
 
 #if 0   // NEEDS_PORTING
     struct iwl_mvm* mvm = IWL_MAC80211_GET_MVM(hw);
@@ -1136,9 +1140,7 @@ void iwl_mvm_mac_stop(struct iwl_mvm* mvm) {
     flush_work(&mvm->d0i3_exit_work);
 #endif  // NEEDS_PORTING
   iwl_task_wait(mvm->async_handlers_wk);
-#if 0   // NEEDS_PORTING
-    flush_work(&mvm->add_stream_wk);
-#endif  // NEEDS_PORTING
+  iwl_task_wait(mvm->add_stream_wk);
 
   /*
    * Lock and clear the firmware running bit here already, so that
@@ -2945,29 +2947,31 @@ static void iwl_mvm_sta_rc_update(struct ieee80211_hw* hw, struct ieee80211_vif*
         iwl_mvm_sf_update(mvm, vif, false);
     }
 }
+#endif  // NEEDS_PORTING
 
-static int iwl_mvm_mac_conf_tx(struct ieee80211_hw* hw, struct ieee80211_vif* vif, uint16_t ac,
-                               const struct ieee80211_tx_queue_params* params) {
-    struct iwl_mvm* mvm = IWL_MAC80211_GET_MVM(hw);
-    struct iwl_mvm_vif* mvmvif = iwl_mvm_vif_from_mac80211(vif);
+zx_status_t iwl_mvm_mac_conf_tx(struct iwl_mvm_vif* mvmvif, uint16_t ac,
+                                const struct ieee80211_tx_queue_params* params) {
+  struct iwl_mvm* mvm = mvmvif->mvm;
 
-    mvmvif->queue_params[ac] = *params;
+  iwl_assert_lock_held(&mvm->mutex);
 
-    /*
-     * No need to update right away, we'll get BSS_CHANGED_QOS
-     * The exception is P2P_DEVICE interface which needs immediate update.
-     */
-    if (vif->type == NL80211_IFTYPE_P2P_DEVICE) {
-        int ret;
+  if (ac >= IEEE80211_AC_MAX) {
+    return ZX_ERR_INVALID_ARGS;
+  }
 
-        mutex_lock(&mvm->mutex);
-        ret = iwl_mvm_mac_ctxt_changed(mvm, vif, false, NULL);
-        mutex_unlock(&mvm->mutex);
-        return ret;
-    }
-    return 0;
+  mvmvif->queue_params[ac] = *params;
+  mvmvif->bss_conf.qos = true;
+
+  /*
+   * There is no BSS_CHANGED_QOS in this driver, so the EDCA parameters are pushed right away if the
+   * MAC is already associated. Otherwise they go with the MAC context update at association.
+   */
+  if (!mvmvif->bss_conf.assoc) {
+    return ZX_OK;
+  }
+
+  return iwl_mvm_mac_ctxt_changed(mvmvif, false, NULL);
 }
-#endif  // NEEDS_PORTING
 
 // Prepare for transmitting a management frame for association before associated.
 //
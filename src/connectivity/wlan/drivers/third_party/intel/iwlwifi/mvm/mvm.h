@@ -60,6 +60,7 @@
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/mvm/tof.h"
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/compiler.h"
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/ieee80211.h"
+#include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/irq.h"
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/kernel.h"
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/regulatory.h"
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/task.h"
@@ -719,7 +720,7 @@ struct iwl_mvm_reorder_buffer {
   int queue;
   uint16_t last_amsdu;
   uint8_t last_sub_index;
-  struct timer_list reorder_timer;
+  struct iwl_irq_timer* reorder_timer;
   bool removed;
   bool valid;
   mtx_t lock;
@@ -727,24 +728,29 @@ struct iwl_mvm_reorder_buffer {
 } ____cacheline_aligned_in_smp;
 
 /**
- * struct _iwl_mvm_reorder_buf_entry - reorder buffer entry per-queue/per-seqno
- * @frames: list of skbs stored
- * @reorder_time: time the packet was stored in the reorder buffer
+ * struct iwl_mvm_reorder_buf_frame - a frame held in the reorder buffer
+ * @list: entry in &struct iwl_mvm_reorder_buf_entry.frames
+ * @rx_status: the RX status of the frame, as it will be passed to MLME
+ * @len: length of @data
+ * @data: the frame. In Fuchsia the frame is formatted in-place in the RX buffer, which is
+ *  recycled once the RX handler returns, so frames held for reordering are copied out.
  */
-struct _iwl_mvm_reorder_buf_entry {
-  struct sk_buff_head frames;
-  unsigned long reorder_time;
+struct iwl_mvm_reorder_buf_frame {
+  list_node_t list;
+  struct ieee80211_rx_status rx_status;
+  size_t len;
+  uint8_t data[];
 };
 
-/* make this indirection to get the aligned thing */
+/**
+ * struct iwl_mvm_reorder_buf_entry - reorder buffer entry per-queue/per-seqno
+ * @frames: list of &struct iwl_mvm_reorder_buf_frame stored
+ * @reorder_time: time the packet was stored in the reorder buffer
+ */
 struct iwl_mvm_reorder_buf_entry {
-  struct _iwl_mvm_reorder_buf_entry e;
-}
-#ifndef __CHECKER__
-/* sparse doesn't like this construct: "bad integer constant expression" */
-__aligned(roundup_pow_of_two(sizeof(struct _iwl_mvm_reorder_buf_entry)))
-#endif
-    ;
+  list_node_t frames;
+  zx_time_t reorder_time;
+};
 
 /**
  * struct iwl_mvm_baid_data - BA session data
@@ -752,24 +758,19 @@ __aligned(roundup_pow_of_two(sizeof(struct _iwl_mvm_reorder_buf_entry)))
  * @tid: tid of the session
  * @baid baid of the session
  * @timeout: the timeout set in the addba request
- * @entries_per_queue: # of buffers per queue, this actually gets
- *  aligned up to avoid cache line sharing between queues
- * @last_rx: last rx jiffies, updated only if timeout passed from last update
- * @session_timer: timer to check if BA session expired, runs at 2 * timeout
+ * @entries_per_queue: # of buffers per queue
+ * @last_rx: last rx time, updated only if timeout passed from last update
  * @mvm: mvm pointer, needed for timer context
  * @reorder_buf: reorder buffer, allocated per queue
  * @reorder_buf_data: data
  */
 struct iwl_mvm_baid_data {
-  struct rcu_head rcu_head;
   uint8_t sta_id;
   uint8_t tid;
   uint8_t baid;
   uint16_t timeout;
   uint16_t entries_per_queue;
-  unsigned long last_rx;
-  struct timer_list session_timer;
-  struct iwl_mvm_baid_data __rcu** rcu_ptr;
+  zx_time_t last_rx;
   struct iwl_mvm* mvm;
   struct iwl_mvm_reorder_buffer reorder_buf[IWL_MAX_RX_HW_QUEUES];
   struct iwl_mvm_reorder_buf_entry entries[];
@@ -866,6 +867,12 @@ struct iwl_mvm {
 
   /* for protecting access to iwl_mvm */
   mtx_t mutex;
+
+  /* CMD_PIPELINED commands of the thread in iwl_mvm_hcmd_batch_begin() */
+  struct iwl_hcmd_batch hcmd_batch;
+  thrd_t hcmd_batch_owner;
+  int hcmd_batch_depth;
+  cnd_t hcmd_batch_cnd;
   list_node_t async_handlers_list;
   mtx_t async_handlers_lock;
   struct iwl_task* async_handlers_wk;
@@ -922,7 +929,7 @@ struct iwl_mvm {
     struct iwl_mvm_dqa_txq_info queue_info[IWL_MAX_HW_QUEUES];
     struct iwl_mvm_tvqm_txq_info tvqm_info[IWL_MAX_TVQM_QUEUES];
   };
-  struct work_struct add_stream_wk; /* To add streams to queues */
+  struct iwl_task* add_stream_wk; /* To add streams to queues */
 
   const char* nvm_file_name;
   struct iwl_nvm_data* nvm_data;
@@ -1600,6 +1607,8 @@ zx_status_t __must_check iwl_mvm_send_cmd_status(struct iwl_mvm* mvm, struct iwl
                                                  uint32_t* status);
 zx_status_t __must_check iwl_mvm_send_cmd_pdu_status(struct iwl_mvm* mvm, uint32_t id, uint16_t len,
                                                      const void* data, uint32_t* status);
+void iwl_mvm_hcmd_batch_begin(struct iwl_mvm* mvm);
+zx_status_t __must_check iwl_mvm_hcmd_batch_end(struct iwl_mvm* mvm);
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 //
@@ -1609,6 +1618,7 @@ zx_status_t __must_check iwl_mvm_send_cmd_pdu_status(struct iwl_mvm* mvm, uint32
 zx_status_t iwl_mvm_tx_skb(struct iwl_mvm* mvm, struct ieee80211_mac_packet* pkt,
                            struct iwl_mvm_sta* mvmsta);
 int iwl_mvm_tx_skb_non_sta(struct iwl_mvm* mvm, struct sk_buff* skb);
+uint8_t iwl_mvm_tx_get_tid(const struct ieee80211_frame_header* hdr);
 void iwl_mvm_set_tx_cmd(struct iwl_mvm* mvm, struct ieee80211_mac_packet* pkt,
                         struct iwl_tx_cmd* tx_cmd, uint8_t sta_id);
 void iwl_mvm_set_tx_cmd_rate(struct iwl_mvm* mvm, struct iwl_tx_cmd* tx_cmd,
@@ -2092,7 +2102,8 @@ struct iwl_mvm_tdls_peer_counter* iwl_mvm_tdls_peer_cache_find(struct iwl_mvm* m
 #endif /* CPTCFG_IWLMVM_TDLS_PEER_CACHE */
 void iwl_mvm_sync_rx_queues_internal(struct iwl_mvm* mvm, struct iwl_mvm_internal_rxq_notif* notif,
                                      uint32_t size);
-void iwl_mvm_reorder_timer_expired(struct timer_list* t);
+void iwl_mvm_reorder_timer_expired(void* data);
+void iwl_mvm_del_ba(struct iwl_mvm* mvm, int queue, struct iwl_mvm_baid_data* ba_data);
 struct ieee80211_vif* iwl_mvm_get_bss_vif(struct iwl_mvm* mvm);
 
 // Returns true if any client interface is associated.
@@ -2192,6 +2203,9 @@ zx_status_t iwl_mvm_mac_hw_scan(struct iwl_mvm_vif* mvmvif, const struct iwl_mvm
 zx_status_t iwl_mvm_mac_sta_state(struct iwl_mvm_vif* mvmvif, struct iwl_mvm_sta* mvm_sta,
                                   enum iwl_sta_state old_state, enum iwl_sta_state new_state);
 
+zx_status_t iwl_mvm_mac_conf_tx(struct iwl_mvm_vif* mvmvif, uint16_t ac,
+                                const struct ieee80211_tx_queue_params* params);
+
 void iwl_mvm_mac_mgd_prepare_tx(struct iwl_mvm* mvm, struct iwl_mvm_vif* mvmvif,
                                 uint16_t req_duration);
 
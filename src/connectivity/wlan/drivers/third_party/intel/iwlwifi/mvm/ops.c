@@ -762,6 +762,8 @@ static struct iwl_op_mode* iwl_op_mode_mvm_start(struct iwl_trans* trans, const
   mvm->drop_bcn_ap_mode = true;
 
   mtx_init(&mvm->mutex, mtx_plain);
+  iwl_hcmd_batch_init(&mvm->hcmd_batch);
+  cnd_init(&mvm->hcmd_batch_cnd);
   mtx_init(&mvm->d0i3_suspend_mutex, mtx_plain);
   mtx_init(&mvm->async_handlers_lock, mtx_plain);
   list_initialize(&mvm->time_event_list);
@@ -782,10 +784,10 @@ static struct iwl_op_mode* iwl_op_mode_mvm_start(struct iwl_trans* trans, const
 #endif  // NEEDS_PORTING
 
   iwl_task_create(mvm->dev, iwl_mvm_scan_timeout_wk, mvm, &mvm->scan_timeout_task);
+  iwl_task_create(mvm->dev, iwl_mvm_add_new_dqa_stream_wk, mvm, &mvm->add_stream_wk);
 
 #if 0   // NEEDS_PORTING
     INIT_DELAYED_WORK(&mvm->tdls_cs.dwork, iwl_mvm_tdls_ch_switch_work);
-    INIT_WORK(&mvm->add_stream_wk, iwl_mvm_add_new_dqa_stream_wk);
 #endif  // NEEDS_PORTING
 
   list_initialize(&mvm->add_stream_txqs);
@@ -873,6 +875,10 @@ static struct iwl_op_mode* iwl_op_mode_mvm_start(struct iwl_trans* trans, const
 
   trans_cfg.sw_csum_tx = IWL_MVM_SW_TX_CSUM_OFFLOAD;
 
+  trans_cfg.tx_batch_size = IWL_MVM_TX_BATCH_SIZE;
+  trans_cfg.tx_batch_timeout = ZX_USEC(IWL_MVM_TX_BATCH_TIMEOUT_USEC);
+  trans_cfg.rx_queue_threads = IWL_MVM_RX_QUEUE_THREADS;
+
 #if 0   // NEEDS_PORTING
     /* Set a short watchdog for the command queue */
     trans_cfg.cmd_q_wdg_timeout = iwl_mvm_get_wd_timeout(mvm, NULL, false, true);
@@ -1088,6 +1094,7 @@ static void iwl_op_mode_mvm_stop(struct iwl_op_mode* op_mode) {
   }
 
   iwl_task_release_sync(mvm->scan_timeout_task);
+  iwl_task_release_sync(mvm->add_stream_wk);
   iwl_task_release_sync(mvm->async_handlers_wk);
 
 #if 0   // NEEDS_PORTING
@@ -1102,6 +1109,8 @@ static void iwl_op_mode_mvm_stop(struct iwl_op_mode* op_mode) {
 
   iwl_fw_runtime_free(&mvm->fwrt);
   mtx_destroy(&mvm->mutex);
+  mtx_destroy(&mvm->hcmd_batch.lock);
+  cnd_destroy(&mvm->hcmd_batch_cnd);
   mtx_destroy(&mvm->d0i3_suspend_mutex);
 
   free(op_mode);
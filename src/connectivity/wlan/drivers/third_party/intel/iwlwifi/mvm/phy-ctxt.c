@@ -280,7 +280,8 @@ static zx_status_t iwl_mvm_phy_ctxt_apply(struct iwl_mvm* mvm, struct iwl_mvm_ph
   /* Set the command data */
   iwl_mvm_phy_ctxt_cmd_data(mvm, &cmd, chandef, chains_static, chains_dynamic);
 
-  ret = iwl_mvm_send_cmd_pdu(mvm, PHY_CONTEXT_CMD, 0, sizeof(struct iwl_phy_context_cmd), &cmd);
+  ret = iwl_mvm_send_cmd_pdu(mvm, PHY_CONTEXT_CMD, CMD_PIPELINED,
+                             sizeof(struct iwl_phy_context_cmd), &cmd);
   if (ret != ZX_OK) {
     IWL_ERR(mvm, "PHY ctxt cmd error. ret=%d\n", ret);
   }
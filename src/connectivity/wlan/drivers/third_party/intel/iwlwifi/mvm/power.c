@@ -454,7 +454,7 @@ static int iwl_mvm_power_send_cmd(struct iwl_mvm* mvm, struct iwl_mvm_vif* mvmvi
   memcpy(&iwl_mvm_vif_from_mac80211(vif)->mac_pwr_cmd, &cmd, sizeof(cmd));
 #endif
 
-  return iwl_mvm_send_cmd_pdu(mvm, MAC_PM_POWER_TABLE, 0, sizeof(cmd), &cmd);
+  return iwl_mvm_send_cmd_pdu(mvm, MAC_PM_POWER_TABLE, CMD_PIPELINED, sizeof(cmd), &cmd);
 }
 
 zx_status_t iwl_mvm_power_update_device(struct iwl_mvm* mvm) {
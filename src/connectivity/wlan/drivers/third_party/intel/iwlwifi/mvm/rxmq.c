@@ -39,6 +39,7 @@
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/ieee80211.h"
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/rcu.h"
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/stats.h"
+#include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/time.h"
 
 static bool is_multicast_ether_addr(uint8_t addr[6]) { return (addr[0] & 0x1) != 0; }
 
@@ -214,6 +215,14 @@ static void iwl_mvm_pass_packet_to_mac80211(struct iwl_mvm* mvm,
   ieee80211_rx_napi(mvm->hw, sta, skb, napi);
 #endif  // NEEDS_PORTING
 
+  // Follow the ADDBA requests before MLME can answer them, see iwl_mvm_sta_tx_ba_action().
+  if (sta && ieee80211_is_action(frame)) {
+    size_t hdr_len = ieee80211_get_header_len(frame);
+    if (hdr_len < frame_len) {
+      iwl_mvm_sta_rx_ba_action(mvm, sta, (const uint8_t*)frame + hdr_len, frame_len - hdr_len);
+    }
+  }
+
   // Send to MLME
   // TODO(fxbug.dev/43218) Need to revisit to handle multiple IFs
   wlan_rx_packet_t rx_packet = {
@@ -342,62 +351,60 @@ static void iwl_mvm_rx_csum(struct ieee80211_sta* sta, struct sk_buff* skb,
         skb->ip_summed = CHECKSUM_UNNECESSARY;
     }
 }
+#endif  // NEEDS_PORTING
 
 /*
  * returns true if a packet is a duplicate and should be dropped.
  * Updates AMSDU PN tracking info
  */
-static bool iwl_mvm_is_dup(struct ieee80211_sta* sta, int queue,
-                           struct ieee80211_rx_status* rx_status, struct ieee80211_hdr* hdr,
-                           struct iwl_rx_mpdu_desc* desc) {
-    struct iwl_mvm_sta* mvm_sta;
-    struct iwl_mvm_rxq_dup_data* dup_data;
-    uint8_t tid, sub_frame_idx;
-
-    if (WARN_ON(IS_ERR_OR_NULL(sta))) { return false; }
+static bool iwl_mvm_is_dup(struct iwl_mvm_sta* mvm_sta, int queue,
+                           struct ieee80211_rx_status* rx_status,
+                           struct ieee80211_frame_header* hdr, struct iwl_rx_mpdu_desc* desc) {
+  struct iwl_mvm_rxq_dup_data* dup_data;
+  uint8_t tid, sub_frame_idx;
 
-    mvm_sta = iwl_mvm_sta_from_mac80211(sta);
-    dup_data = &mvm_sta->dup_data[queue];
+  if (!mvm_sta->dup_data) {
+    return false;
+  }
 
-    /*
-     * Drop duplicate 802.11 retransmissions
-     * (IEEE 802.11-2012: 9.3.2.10 "Duplicate detection and recovery")
-     */
-    if (ieee80211_is_ctl(hdr->frame_control) || ieee80211_is_qos_nullfunc(hdr->frame_control) ||
-        is_multicast_ether_addr(hdr->addr1)) {
-        rx_status->flag |= RX_FLAG_DUP_VALIDATED;
-        return false;
-    }
+  dup_data = &mvm_sta->dup_data[queue];
 
-    if (ieee80211_is_data_qos(hdr->frame_control)) { /* frame has qos control */
-        tid = ieee80211_get_tid(hdr);
-    } else {
-        tid = IWL_MAX_TID_COUNT;
-    }
+  /*
+   * Drop duplicate 802.11 retransmissions
+   * (IEEE 802.11-2012: 9.3.2.10 "Duplicate detection and recovery")
+   */
+  if (ieee80211_is_ctl(hdr) || ieee80211_is_qos_nullfunc(hdr) ||
+      is_multicast_ether_addr(hdr->addr1)) {
+    return false;
+  }
 
-    /* If this wasn't a part of an A-MSDU the sub-frame index will be 0 */
-    sub_frame_idx = desc->amsdu_info & IWL_RX_MPDU_AMSDU_SUBFRAME_IDX_MASK;
+  if (ieee80211_is_data_qos(hdr)) { /* frame has qos control */
+    tid = ieee80211_get_tid(hdr);
+  } else {
+    tid = IWL_MAX_TID_COUNT;
+  }
 
-    if (unlikely(ieee80211_has_retry(hdr->frame_control) &&
-                 dup_data->last_seq[tid] == hdr->seq_ctrl &&
-                 dup_data->last_sub_frame[tid] >= sub_frame_idx)) {
-        return true;
-    }
+  /* If this wasn't a part of an A-MSDU the sub-frame index will be 0 */
+  sub_frame_idx = desc->amsdu_info & IWL_RX_MPDU_AMSDU_SUBFRAME_IDX_MASK;
 
-    /* Allow same PN as the first subframe for following sub frames */
-    if (dup_data->last_seq[tid] == hdr->seq_ctrl && sub_frame_idx > dup_data->last_sub_frame[tid] &&
-        desc->mac_flags2 & IWL_RX_MPDU_MFLG2_AMSDU) {
-        rx_status->flag |= RX_FLAG_ALLOW_SAME_PN;
-    }
+  if (unlikely(ieee80211_has_retry(hdr) && dup_data->last_seq[tid] == hdr->seq_ctrl &&
+               dup_data->last_sub_frame[tid] >= sub_frame_idx)) {
+    return true;
+  }
 
-    dup_data->last_seq[tid] = hdr->seq_ctrl;
-    dup_data->last_sub_frame[tid] = sub_frame_idx;
+  /* Allow same PN as the first subframe for following sub frames */
+  if (dup_data->last_seq[tid] == hdr->seq_ctrl && sub_frame_idx > dup_data->last_sub_frame[tid] &&
+      desc->mac_flags2 & IWL_RX_MPDU_MFLG2_AMSDU) {
+    rx_status->flag |= RX_FLAG_ALLOW_SAME_PN;
+  }
 
-    rx_status->flag |= RX_FLAG_DUP_VALIDATED;
+  dup_data->last_seq[tid] = hdr->seq_ctrl;
+  dup_data->last_sub_frame[tid] = sub_frame_idx;
 
-    return false;
+  return false;
 }
 
+#if 0   // NEEDS_PORTING
 int iwl_mvm_notify_rx_queue(struct iwl_mvm* mvm, uint32_t rxq_mask, const uint8_t* data,
                             uint32_t count) {
     struct iwl_rxq_sync_cmd* cmd;
@@ -421,6 +428,7 @@ int iwl_mvm_notify_rx_queue(struct iwl_mvm* mvm, uint32_t rxq_mask, const uint8_
     kfree(cmd);
     return ret;
 }
+#endif  // NEEDS_PORTING
 
 /*
  * Returns true if sn2 - buffer_size < sn1 < sn2.
@@ -429,151 +437,154 @@ int iwl_mvm_notify_rx_queue(struct iwl_mvm* mvm, uint32_t rxq_mask, const uint8_
  * Reorder timeout can only bring us up to buffer_size SNs ahead of NSSN.
  */
 static bool iwl_mvm_is_sn_less(uint16_t sn1, uint16_t sn2, uint16_t buffer_size) {
-    return ieee80211_sn_less(sn1, sn2) && !ieee80211_sn_less(sn1, sn2 - buffer_size);
+  return ieee80211_sn_less(sn1, sn2) && !ieee80211_sn_less(sn1, sn2 - buffer_size);
 }
 
-#define RX_REORDER_BUF_TIMEOUT_MQ (HZ / 10)
+#define RX_REORDER_BUF_TIMEOUT_MQ ZX_MSEC(100)
+
+// Arm the reorder timer to fire when the frame stored at |reorder_time| expires.
+static void iwl_mvm_reorder_timer_arm(struct iwl_mvm_reorder_buffer* reorder_buf,
+                                      zx_time_t reorder_time) {
+  zx_time_t expiry = zx_time_add_duration(reorder_time, RX_REORDER_BUF_TIMEOUT_MQ);
+  zx_time_t now = iwl_time_now(reorder_buf->mvm->dev);
+
+  iwl_irq_timer_start(reorder_buf->reorder_timer, expiry > now ? zx_time_sub_time(expiry, now) : 0);
+}
 
-static void iwl_mvm_release_frames(struct iwl_mvm* mvm, struct ieee80211_sta* sta,
-                                   struct napi_struct* napi, struct iwl_mvm_baid_data* baid_data,
+static void iwl_mvm_release_frames(struct iwl_mvm* mvm, struct iwl_mvm_sta* sta,
+                                   struct iwl_mvm_baid_data* baid_data,
                                    struct iwl_mvm_reorder_buffer* reorder_buf, uint16_t nssn) {
-    struct iwl_mvm_reorder_buf_entry* entries =
-        &baid_data->entries[reorder_buf->queue * baid_data->entries_per_queue];
-    uint16_t ssn = reorder_buf->head_sn;
+  struct iwl_mvm_reorder_buf_entry* entries =
+      &baid_data->entries[reorder_buf->queue * baid_data->entries_per_queue];
+  uint16_t ssn = reorder_buf->head_sn;
 
-    iwl_assert_lock_held(&reorder_buf->lock);
+  iwl_assert_lock_held(&reorder_buf->lock);
 
-    /* ignore nssn smaller than head sn - this can happen due to timeout */
-    if (iwl_mvm_is_sn_less(nssn, ssn, reorder_buf->buf_size)) { goto set_timer; }
+  /* ignore nssn smaller than head sn - this can happen due to timeout */
+  if (iwl_mvm_is_sn_less(nssn, ssn, reorder_buf->buf_size)) {
+    goto set_timer;
+  }
 
-    while (iwl_mvm_is_sn_less(ssn, nssn, reorder_buf->buf_size)) {
-        int index = ssn % reorder_buf->buf_size;
-        struct sk_buff_head* skb_list = &entries[index].e.frames;
-        struct sk_buff* skb;
+  while (iwl_mvm_is_sn_less(ssn, nssn, reorder_buf->buf_size)) {
+    int index = ssn % reorder_buf->buf_size;
+    list_node_t* frames = &entries[index].frames;
+    struct iwl_mvm_reorder_buf_frame* frame;
 
-        ssn = ieee80211_sn_inc(ssn);
+    ssn = ieee80211_sn_inc(ssn);
 
-        /*
-         * Empty the list. Will have more than one frame for A-MSDU.
-         * Empty list is valid as well since nssn indicates frames were
-         * received.
-         */
-        while ((skb = __skb_dequeue(skb_list))) {
-            iwl_mvm_pass_packet_to_mac80211(mvm, napi, skb, reorder_buf->queue, sta);
-            reorder_buf->num_stored--;
-        }
+    /*
+     * Empty the list. Will have more than one frame for A-MSDU.
+     * Empty list is valid as well since nssn indicates frames were
+     * received.
+     */
+    while ((frame = list_remove_head_type(frames, struct iwl_mvm_reorder_buf_frame, list))) {
+      iwl_mvm_pass_packet_to_mac80211(mvm, (struct ieee80211_frame_header*)frame->data,
+                                      frame->len, &frame->rx_status, reorder_buf->queue, sta);
+      free(frame);
+      reorder_buf->num_stored--;
     }
-    reorder_buf->head_sn = nssn;
+  }
+  reorder_buf->head_sn = nssn;
 
 set_timer:
-    if (reorder_buf->num_stored && !reorder_buf->removed) {
-        uint16_t index = reorder_buf->head_sn % reorder_buf->buf_size;
+  if (reorder_buf->num_stored && !reorder_buf->removed) {
+    uint16_t index = reorder_buf->head_sn % reorder_buf->buf_size;
 
-        while (skb_queue_empty(&entries[index].e.frames)) {
-            index = (index + 1) % reorder_buf->buf_size;
-        }
-        /* modify timer to match next frame's expiration time */
-        mod_timer(&reorder_buf->reorder_timer,
-                  entries[index].e.reorder_time + 1 + RX_REORDER_BUF_TIMEOUT_MQ);
-    } else {
-        del_timer(&reorder_buf->reorder_timer);
+    while (list_is_empty(&entries[index].frames)) {
+      index = (index + 1) % reorder_buf->buf_size;
     }
+    /* modify timer to match next frame's expiration time */
+    iwl_mvm_reorder_timer_arm(reorder_buf, entries[index].reorder_time);
+  } else {
+    iwl_irq_timer_stop(reorder_buf->reorder_timer);
+  }
 }
 
-void iwl_mvm_reorder_timer_expired(struct timer_list* t) {
-    struct iwl_mvm_reorder_buffer* buf = from_timer(buf, t, reorder_timer);
-    struct iwl_mvm_baid_data* baid_data = iwl_mvm_baid_data_from_reorder_buf(buf);
-    struct iwl_mvm_reorder_buf_entry* entries =
-        &baid_data->entries[buf->queue * baid_data->entries_per_queue];
-    int i;
-    uint16_t sn = 0, index = 0;
-    bool expired = false;
-    bool cont = false;
-
-    spin_lock(&buf->lock);
-
-    if (!buf->num_stored || buf->removed) {
-        spin_unlock(&buf->lock);
-        return;
-    }
+void iwl_mvm_reorder_timer_expired(void* data) {
+  struct iwl_mvm_reorder_buffer* buf = data;
+  struct iwl_mvm_baid_data* baid_data = iwl_mvm_baid_data_from_reorder_buf(buf);
+  struct iwl_mvm_reorder_buf_entry* entries =
+      &baid_data->entries[buf->queue * baid_data->entries_per_queue];
+  struct iwl_mvm* mvm = buf->mvm;
+  zx_time_t now = iwl_time_now(mvm->dev);
+  int i;
+  uint16_t sn = 0, index = 0;
+  bool expired = false;
+  bool cont = false;
+
+  // Take the RCU read lock before the buffer lock, in the same order as the RX path does.
+  iwl_rcu_read_lock(mvm->dev);
+  mtx_lock(&buf->lock);
 
-    for (i = 0; i < buf->buf_size; i++) {
-        index = (buf->head_sn + i) % buf->buf_size;
+  if (!buf->num_stored || buf->removed) {
+    goto out;
+  }
 
-        if (skb_queue_empty(&entries[index].e.frames)) {
-            /*
-             * If there is a hole and the next frame didn't expire
-             * we want to break and not advance SN
-             */
-            cont = false;
-            continue;
-        }
-        if (!cont &&
-            !time_after(jiffies, entries[index].e.reorder_time + RX_REORDER_BUF_TIMEOUT_MQ)) {
-            break;
-        }
+  for (i = 0; i < buf->buf_size; i++) {
+    index = (buf->head_sn + i) % buf->buf_size;
 
-        expired = true;
-        /* continue until next hole after this expired frames */
-        cont = true;
-        sn = ieee80211_sn_add(buf->head_sn, i + 1);
+    if (list_is_empty(&entries[index].frames)) {
+      /*
+       * If there is a hole and the next frame didn't expire
+       * we want to break and not advance SN
+       */
+      cont = false;
+      continue;
     }
-
-    if (expired) {
-        struct ieee80211_sta* sta;
-        struct iwl_mvm_sta* mvmsta;
-        uint8_t sta_id = baid_data->sta_id;
-
-        rcu_read_lock();
-        sta = rcu_dereference(buf->mvm->fw_id_to_mac_id[sta_id]);
-        mvmsta = iwl_mvm_sta_from_mac80211(sta);
-
-        /* SN is set to the last expired frame + 1 */
-        IWL_DEBUG_HT(buf->mvm, "Releasing expired frames for sta %u, sn %d\n", sta_id, sn);
-        iwl_mvm_event_frame_timeout_callback(buf->mvm, mvmsta->vif, sta, baid_data->tid);
-        iwl_mvm_release_frames(buf->mvm, sta, NULL, baid_data, buf, sn);
-        rcu_read_unlock();
-    } else {
-        /*
-         * If no frame expired and there are stored frames, index is now
-         * pointing to the first unexpired frame - modify timer
-         * accordingly to this frame.
-         */
-        mod_timer(&buf->reorder_timer,
-                  entries[index].e.reorder_time + 1 + RX_REORDER_BUF_TIMEOUT_MQ);
+    if (!cont &&
+        now < zx_time_add_duration(entries[index].reorder_time, RX_REORDER_BUF_TIMEOUT_MQ)) {
+      break;
     }
-    spin_unlock(&buf->lock);
-}
 
-static void iwl_mvm_del_ba(struct iwl_mvm* mvm, int queue, struct iwl_mvm_delba_data* data) {
-    struct iwl_mvm_baid_data* ba_data;
-    struct ieee80211_sta* sta;
-    struct iwl_mvm_reorder_buffer* reorder_buf;
-    uint8_t baid = data->baid;
+    expired = true;
+    /* continue until next hole after this expired frames */
+    cont = true;
+    sn = ieee80211_sn_add(buf->head_sn, i + 1);
+  }
+
+  if (expired) {
+    uint8_t sta_id = baid_data->sta_id;
+    struct iwl_mvm_sta* sta = iwl_rcu_load(mvm->fw_id_to_mac_id[sta_id]);
 
-    if (WARN_ONCE(baid >= IWL_MAX_BAID, "invalid BAID: %x\n", baid)) { return; }
+    /* SN is set to the last expired frame + 1 */
+    IWL_DEBUG_HT(mvm, "Releasing expired frames for sta %u, sn %d\n", sta_id, sn);
+    iwl_mvm_release_frames(mvm, sta, baid_data, buf, sn);
+  } else {
+    /*
+     * If no frame expired and there are stored frames, index is now
+     * pointing to the first unexpired frame - modify timer
+     * accordingly to this frame.
+     */
+    iwl_mvm_reorder_timer_arm(buf, entries[index].reorder_time);
+  }
 
-    rcu_read_lock();
+out:
+  mtx_unlock(&buf->lock);
+  iwl_rcu_read_unlock(mvm->dev);
+}
 
-    ba_data = rcu_dereference(mvm->baid_map[baid]);
-    if (WARN_ON_ONCE(!ba_data)) { goto out; }
+// Release all the frames held in the reorder buffer of `queue` to MLME.
+//
+// In Linux this runs from the RX queue itself, in response to the internal DEL_BA notification
+// that the driver sends through the firmware.  That RX queue sync is not ported, so the BA session
+// teardown calls this directly for each queue instead, after `ba_data` has been removed from
+// mvm->baid_map.  The reorder buffer lock serializes this against the RX path and the timer.
+void iwl_mvm_del_ba(struct iwl_mvm* mvm, int queue, struct iwl_mvm_baid_data* ba_data) {
+  struct iwl_mvm_reorder_buffer* reorder_buf = &ba_data->reorder_buf[queue];
+  struct iwl_mvm_sta* sta;
 
-    sta = rcu_dereference(mvm->fw_id_to_mac_id[ba_data->sta_id]);
-    if (WARN_ON_ONCE(IS_ERR_OR_NULL(sta))) { goto out; }
+  iwl_rcu_read_lock(mvm->dev);
 
-    reorder_buf = &ba_data->reorder_buf[queue];
+  sta = iwl_rcu_load(mvm->fw_id_to_mac_id[ba_data->sta_id]);
 
-    /* release all frames that are in the reorder buffer to the stack */
-    spin_lock_bh(&reorder_buf->lock);
-    iwl_mvm_release_frames(mvm, sta, NULL, ba_data, reorder_buf,
-                           ieee80211_sn_add(reorder_buf->head_sn, reorder_buf->buf_size));
-    spin_unlock_bh(&reorder_buf->lock);
-    del_timer_sync(&reorder_buf->reorder_timer);
+  /* release all frames that are in the reorder buffer to the stack */
+  mtx_lock(&reorder_buf->lock);
+  iwl_mvm_release_frames(mvm, sta, ba_data, reorder_buf,
+                         ieee80211_sn_add(reorder_buf->head_sn, reorder_buf->buf_size));
+  mtx_unlock(&reorder_buf->lock);
 
-out:
-    rcu_read_unlock();
+  iwl_rcu_read_unlock(mvm->dev);
 }
-#endif  // NEEDS_PORTING
 
 void iwl_mvm_rx_queue_notif(struct iwl_mvm* mvm, struct iwl_rx_cmd_buffer* rxb, int queue) {
 #if 0   // NEEDS_PORTING
@@ -609,178 +620,198 @@ void iwl_mvm_rx_queue_notif(struct iwl_mvm* mvm, struct iwl_rx_cmd_buffer* rxb,
  * Returns true if the MPDU was buffered\dropped, false if it should be passed
  * to upper layer.
  */
-static bool iwl_mvm_reorder(struct iwl_mvm* mvm, int queue, struct iwl_rx_mpdu_desc* desc) {
-  // TODO(fxbug.dev/79993) (fxbug.dev/51295)
-#if 0   // NEEDS_PORTING
-    struct ieee80211_hdr* hdr = (struct ieee80211_hdr*)skb->data;
-    struct iwl_mvm_sta* mvm_sta;
-    struct iwl_mvm_baid_data* baid_data;
-    struct iwl_mvm_reorder_buffer* buffer;
-    struct sk_buff* tail;
-    uint32_t reorder = le32_to_cpu(desc->reorder_data);
-    bool amsdu = desc->mac_flags2 & IWL_RX_MPDU_MFLG2_AMSDU;
-    bool last_subframe = desc->amsdu_info & IWL_RX_MPDU_AMSDU_LAST_SUBFRAME;
-    uint8_t tid = ieee80211_get_tid(hdr);
-    uint8_t sub_frame_idx = desc->amsdu_info & IWL_RX_MPDU_AMSDU_SUBFRAME_IDX_MASK;
-    struct iwl_mvm_reorder_buf_entry* entries;
-    int index;
-    uint16_t nssn, sn;
-    uint8_t baid;
-
-    baid = (reorder & IWL_RX_MPDU_REORDER_BAID_MASK) >> IWL_RX_MPDU_REORDER_BAID_SHIFT;
+static bool iwl_mvm_reorder(struct iwl_mvm* mvm, struct iwl_mvm_sta* sta, int queue,
+                            struct ieee80211_frame_header* hdr, size_t len,
+                            struct ieee80211_rx_status* rx_status,
+                            struct iwl_rx_mpdu_desc* desc) {
+  struct iwl_mvm_baid_data* baid_data;
+  struct iwl_mvm_reorder_buffer* buffer;
+  struct iwl_mvm_reorder_buf_frame* frame;
+  uint32_t reorder = le32_to_cpu(desc->reorder_data);
+  bool amsdu = desc->mac_flags2 & IWL_RX_MPDU_MFLG2_AMSDU;
+  bool last_subframe = desc->amsdu_info & IWL_RX_MPDU_AMSDU_LAST_SUBFRAME;
+  uint8_t sub_frame_idx = desc->amsdu_info & IWL_RX_MPDU_AMSDU_SUBFRAME_IDX_MASK;
+  struct iwl_mvm_reorder_buf_entry* entries;
+  int index;
+  uint16_t nssn, sn;
+  uint8_t baid, tid;
+
+  baid = (reorder & IWL_RX_MPDU_REORDER_BAID_MASK) >> IWL_RX_MPDU_REORDER_BAID_SHIFT;
 
-    /*
-     * This also covers the case of receiving a Block Ack Request
-     * outside a BA session; we'll pass it to mac80211 and that
-     * then sends a delBA action frame.
-     */
-    if (baid == IWL_RX_REORDER_DATA_INVALID_BAID) { return false; }
+  /*
+   * This also covers the case of receiving a Block Ack Request
+   * outside a BA session; we'll pass it to MLME and that
+   * then sends a delBA action frame.
+   */
+  if (baid == IWL_RX_REORDER_DATA_INVALID_BAID) {
+    return false;
+  }
 
-    /* no sta yet */
-    if (WARN_ONCE(IS_ERR_OR_NULL(sta), "Got valid BAID without a valid station assigned\n")) {
-        return false;
-    }
+  if (WARN(baid >= IWL_MAX_BAID, "invalid BAID: %x\n", baid)) {
+    return false;
+  }
 
-    mvm_sta = iwl_mvm_sta_from_mac80211(sta);
+  /* no sta yet */
+  if (WARN(!sta, "Got valid BAID without a valid station assigned\n")) {
+    return false;
+  }
 
-    /* not a data packet or a bar */
-    if (!ieee80211_is_back_req(hdr->frame_control) &&
-        (!ieee80211_is_data_qos(hdr->frame_control) || is_multicast_ether_addr(hdr->addr1))) {
-        return false;
-    }
+  /* not a data packet or a bar */
+  if (!ieee80211_is_back_req(hdr) &&
+      (!ieee80211_is_data_qos(hdr) || is_multicast_ether_addr(hdr->addr1))) {
+    return false;
+  }
 
-    if (unlikely(!ieee80211_is_data_present(hdr->frame_control))) { return false; }
+  if (ieee80211_is_back_req(hdr)) {
+    struct ieee80211_bar* bar = (struct ieee80211_bar*)hdr;
 
-    baid_data = rcu_dereference(mvm->baid_map[baid]);
-    if (!baid_data) {
-        IWL_DEBUG_RX(mvm,
-                     "Got valid BAID but no baid allocated, bypass the re-ordering buffer. Baid %d "
-                     "reorder 0x%x\n",
-                     baid, reorder);
-        return false;
-    }
+    tid = le16_to_cpu(bar->control) >> IEEE80211_BAR_CTRL_TID_INFO_SHIFT;
+  } else if (unlikely(!ieee80211_is_data_present(hdr))) {
+    return false;
+  } else {
+    tid = ieee80211_get_tid(hdr);
+  }
 
-    if (WARN(tid != baid_data->tid || mvm_sta->sta_id != baid_data->sta_id,
-             "baid 0x%x is mapped to sta:%d tid:%d, but was received for sta:%d tid:%d\n", baid,
-             baid_data->sta_id, baid_data->tid, mvm_sta->sta_id, tid)) {
-        return false;
-    }
+  baid_data = iwl_rcu_load(mvm->baid_map[baid]);
+  if (!baid_data) {
+    IWL_DEBUG_RX(mvm,
+                 "Got valid BAID but no baid allocated, bypass the re-ordering buffer. Baid %d "
+                 "reorder 0x%x\n",
+                 baid, reorder);
+    return false;
+  }
 
-    nssn = reorder & IWL_RX_MPDU_REORDER_NSSN_MASK;
-    sn = (reorder & IWL_RX_MPDU_REORDER_SN_MASK) >> IWL_RX_MPDU_REORDER_SN_SHIFT;
+  if (WARN(tid != baid_data->tid || sta->sta_id != baid_data->sta_id,
+           "baid 0x%x is mapped to sta:%d tid:%d, but was received for sta:%d tid:%d\n", baid,
+           baid_data->sta_id, baid_data->tid, sta->sta_id, tid)) {
+    return false;
+  }
 
-    buffer = &baid_data->reorder_buf[queue];
-    entries = &baid_data->entries[queue * baid_data->entries_per_queue];
+  nssn = reorder & IWL_RX_MPDU_REORDER_NSSN_MASK;
+  sn = (reorder & IWL_RX_MPDU_REORDER_SN_MASK) >> IWL_RX_MPDU_REORDER_SN_SHIFT;
 
-    spin_lock_bh(&buffer->lock);
+  buffer = &baid_data->reorder_buf[queue];
+  entries = &baid_data->entries[queue * baid_data->entries_per_queue];
 
-    if (!buffer->valid) {
-        if (reorder & IWL_RX_MPDU_REORDER_BA_OLD_SN) {
-            spin_unlock_bh(&buffer->lock);
-            return false;
-        }
-        buffer->valid = true;
-    }
+  mtx_lock(&buffer->lock);
 
-    if (ieee80211_is_back_req(hdr->frame_control)) {
-        iwl_mvm_release_frames(mvm, sta, napi, baid_data, buffer, nssn);
-        goto drop;
+  if (!buffer->valid) {
+    if (reorder & IWL_RX_MPDU_REORDER_BA_OLD_SN) {
+      mtx_unlock(&buffer->lock);
+      return false;
     }
+    buffer->valid = true;
+  }
 
-    /*
-     * If there was a significant jump in the nssn - adjust.
-     * If the SN is smaller than the NSSN it might need to first go into
-     * the reorder buffer, in which case we just release up to it and the
-     * rest of the function will take care of storing it and releasing up to
-     * the nssn
-     */
-    if (!iwl_mvm_is_sn_less(nssn, buffer->head_sn + buffer->buf_size, buffer->buf_size) ||
-        !ieee80211_sn_less(sn, buffer->head_sn + buffer->buf_size)) {
-        uint16_t min_sn = ieee80211_sn_less(sn, nssn) ? sn : nssn;
+  if (ieee80211_is_back_req(hdr)) {
+    iwl_mvm_release_frames(mvm, sta, baid_data, buffer, nssn);
+    goto drop;
+  }
 
-        iwl_mvm_release_frames(mvm, sta, napi, baid_data, buffer, min_sn);
-    }
+  /*
+   * If there was a significant jump in the nssn - adjust.
+   * If the SN is smaller than the NSSN it might need to first go into
+   * the reorder buffer, in which case we just release up to it and the
+   * rest of the function will take care of storing it and releasing up to
+   * the nssn
+   */
+  if (!iwl_mvm_is_sn_less(nssn, buffer->head_sn + buffer->buf_size, buffer->buf_size) ||
+      !ieee80211_sn_less(sn, buffer->head_sn + buffer->buf_size)) {
+    uint16_t min_sn = ieee80211_sn_less(sn, nssn) ? sn : nssn;
 
-    /* drop any oudated packets */
-    if (ieee80211_sn_less(sn, buffer->head_sn)) { goto drop; }
+    iwl_mvm_release_frames(mvm, sta, baid_data, buffer, min_sn);
+  }
 
-    /* release immediately if allowed by nssn and no stored frames */
-    if (!buffer->num_stored && ieee80211_sn_less(sn, nssn)) {
-        if (iwl_mvm_is_sn_less(buffer->head_sn, nssn, buffer->buf_size) &&
-            (!amsdu || last_subframe)) {
-            buffer->head_sn = nssn;
-        }
-        /* No need to update AMSDU last SN - we are moving the head */
-        spin_unlock_bh(&buffer->lock);
-        return false;
-    }
+  /* drop any oudated packets */
+  if (ieee80211_sn_less(sn, buffer->head_sn)) {
+    goto drop;
+  }
 
-    /*
-     * release immediately if there are no stored frames, and the sn is
-     * equal to the head.
-     * This can happen due to reorder timer, where NSSN is behind head_sn.
-     * When we released everything, and we got the next frame in the
-     * sequence, according to the NSSN we can't release immediately,
-     * while technically there is no hole and we can move forward.
-     */
-    if (!buffer->num_stored && sn == buffer->head_sn) {
-        if (!amsdu || last_subframe) { buffer->head_sn = ieee80211_sn_inc(buffer->head_sn); }
-        /* No need to update AMSDU last SN - we are moving the head */
-        spin_unlock_bh(&buffer->lock);
-        return false;
+  /* release immediately if allowed by nssn and no stored frames */
+  if (!buffer->num_stored && ieee80211_sn_less(sn, nssn)) {
+    if (iwl_mvm_is_sn_less(buffer->head_sn, nssn, buffer->buf_size) &&
+        (!amsdu || last_subframe)) {
+      buffer->head_sn = nssn;
     }
+    /* No need to update AMSDU last SN - we are moving the head */
+    mtx_unlock(&buffer->lock);
+    return false;
+  }
 
-    index = sn % buffer->buf_size;
-
-    /*
-     * Check if we already stored this frame
-     * As AMSDU is either received or not as whole, logic is simple:
-     * If we have frames in that position in the buffer and the last frame
-     * originated from AMSDU had a different SN then it is a retransmission.
-     * If it is the same SN then if the subframe index is incrementing it
-     * is the same AMSDU - otherwise it is a retransmission.
-     */
-    tail = skb_peek_tail(&entries[index].e.frames);
-    if (tail && !amsdu) {
-        goto drop;
-    } else if (tail && (sn != buffer->last_amsdu || buffer->last_sub_index >= sub_frame_idx)) {
-        goto drop;
+  /*
+   * release immediately if there are no stored frames, and the sn is
+   * equal to the head.
+   * This can happen due to reorder timer, where NSSN is behind head_sn.
+   * When we released everything, and we got the next frame in the
+   * sequence, according to the NSSN we can't release immediately,
+   * while technically there is no hole and we can move forward.
+   */
+  if (!buffer->num_stored && sn == buffer->head_sn) {
+    if (!amsdu || last_subframe) {
+      buffer->head_sn = ieee80211_sn_inc(buffer->head_sn);
     }
+    /* No need to update AMSDU last SN - we are moving the head */
+    mtx_unlock(&buffer->lock);
+    return false;
+  }
 
-    /* put in reorder buffer */
-    __skb_queue_tail(&entries[index].e.frames, skb);
-    buffer->num_stored++;
-    entries[index].e.reorder_time = jiffies;
+  index = sn % buffer->buf_size;
 
-    if (amsdu) {
-        buffer->last_amsdu = sn;
-        buffer->last_sub_index = sub_frame_idx;
+  /*
+   * Check if we already stored this frame
+   * As AMSDU is either received or not as whole, logic is simple:
+   * If we have frames in that position in the buffer and the last frame
+   * originated from AMSDU had a different SN then it is a retransmission.
+   * If it is the same SN then if the subframe index is incrementing it
+   * is the same AMSDU - otherwise it is a retransmission.
+   */
+  if (!list_is_empty(&entries[index].frames)) {
+    if (!amsdu) {
+      goto drop;
+    } else if (sn != buffer->last_amsdu || buffer->last_sub_index >= sub_frame_idx) {
+      goto drop;
     }
+  }
 
-    /*
-     * We cannot trust NSSN for AMSDU sub-frames that are not the last.
-     * The reason is that NSSN advances on the first sub-frame, and may
-     * cause the reorder buffer to advance before all the sub-frames arrive.
-     * Example: reorder buffer contains SN 0 & 2, and we receive AMSDU with
-     * SN 1. NSSN for first sub frame will be 3 with the result of driver
-     * releasing SN 0,1, 2. When sub-frame 1 arrives - reorder buffer is
-     * already ahead and it will be dropped.
-     * If the last sub-frame is not on this queue - we will get frame
-     * release notification with up to date NSSN.
-     */
-    if (!amsdu || last_subframe) {
-        iwl_mvm_release_frames(mvm, sta, napi, baid_data, buffer, nssn);
-    }
+  /* put in reorder buffer */
+  frame = malloc(sizeof(*frame) + len);
+  if (!frame) {
+    IWL_ERR(mvm, "cannot allocate %zu bytes to hold the frame for reordering\n", len);
+    goto drop;
+  }
+  frame->rx_status = *rx_status;
+  frame->len = len;
+  memcpy(frame->data, hdr, len);
+  list_add_tail(&entries[index].frames, &frame->list);
+  buffer->num_stored++;
+  entries[index].reorder_time = iwl_time_now(mvm->dev);
+
+  if (amsdu) {
+    buffer->last_amsdu = sn;
+    buffer->last_sub_index = sub_frame_idx;
+  }
 
-    spin_unlock_bh(&buffer->lock);
-    return true;
+  /*
+   * We cannot trust NSSN for AMSDU sub-frames that are not the last.
+   * The reason is that NSSN advances on the first sub-frame, and may
+   * cause the reorder buffer to advance before all the sub-frames arrive.
+   * Example: reorder buffer contains SN 0 & 2, and we receive AMSDU with
+   * SN 1. NSSN for first sub frame will be 3 with the result of driver
+   * releasing SN 0,1, 2. When sub-frame 1 arrives - reorder buffer is
+   * already ahead and it will be dropped.
+   * If the last sub-frame is not on this queue - we will get frame
+   * release notification with up to date NSSN.
+   */
+  if (!amsdu || last_subframe) {
+    iwl_mvm_release_frames(mvm, sta, baid_data, buffer, nssn);
+  }
+
+  mtx_unlock(&buffer->lock);
+  return true;
 
 drop:
-    kfree_skb(skb);
-    spin_unlock_bh(&buffer->lock);
-    return true;
-#endif  // NEEDS_PORTING
-  return false;
+  mtx_unlock(&buffer->lock);
+  return true;
 }
 
 #if 0  // NEEDS_PORTING
@@ -1404,6 +1435,10 @@ void iwl_mvm_rx_mpdu_mq(struct iwl_mvm* mvm, struct napi_struct* napi,
     sta = iwl_mvm_find_sta_by_addr(mvm, hdr->addr2);
   }
 
+  if (sta && iwl_mvm_is_dup(sta, queue, &rx_status, hdr, desc)) {
+    goto out;
+  }
+
 #if 0  // NEEDS_PORTING
     if (sta) {
         struct iwl_mvm_sta* mvmsta = iwl_mvm_sta_from_mac80211(sta);
@@ -1559,7 +1594,7 @@ void iwl_mvm_rx_mpdu_mq(struct iwl_mvm* mvm, struct napi_struct* napi,
 #endif  // NEEDS_PORTING
 
   len = iwl_mvm_create_packet(hdr, len, crypt_len, &rx_status.rx_info, rxb);
-  if (!iwl_mvm_reorder(mvm, queue, desc)) {
+  if (!iwl_mvm_reorder(mvm, sta, queue, hdr, len, &rx_status, desc)) {
     iwl_mvm_pass_packet_to_mac80211(mvm, hdr, len, &rx_status, queue, sta);
   }
 out:
@@ -1683,35 +1718,39 @@ out:
 
 void iwl_mvm_rx_frame_release(struct iwl_mvm* mvm, struct napi_struct* napi,
                               struct iwl_rx_cmd_buffer* rxb, int queue) {
-#if 0   // NEEDS_PORTING
-    struct iwl_rx_packet* pkt = rxb_addr(rxb);
-    struct iwl_frame_release* release = (void*)pkt->data;
-    struct ieee80211_sta* sta;
-    struct iwl_mvm_reorder_buffer* reorder_buf;
-    struct iwl_mvm_baid_data* ba_data;
+  struct iwl_rx_packet* pkt = rxb_addr(rxb);
+  struct iwl_frame_release* release = (void*)pkt->data;
+  struct iwl_mvm_sta* sta;
+  struct iwl_mvm_reorder_buffer* reorder_buf;
+  struct iwl_mvm_baid_data* ba_data;
 
-    int baid = release->baid;
+  int baid = release->baid;
 
-    IWL_DEBUG_HT(mvm, "Frame release notification for BAID %u, NSSN %d\n", release->baid,
-                 le16_to_cpu(release->nssn));
+  IWL_DEBUG_HT(mvm, "Frame release notification for BAID %u, NSSN %d\n", release->baid,
+               le16_to_cpu(release->nssn));
 
-    if (WARN_ON_ONCE(baid == IWL_RX_REORDER_DATA_INVALID_BAID)) { return; }
+  if (WARN_ON_ONCE(baid == IWL_RX_REORDER_DATA_INVALID_BAID || baid >= IWL_MAX_BAID)) {
+    return;
+  }
 
-    rcu_read_lock();
+  iwl_rcu_read_lock(mvm->dev);
 
-    ba_data = rcu_dereference(mvm->baid_map[baid]);
-    if (WARN_ON_ONCE(!ba_data)) { goto out; }
+  ba_data = iwl_rcu_load(mvm->baid_map[baid]);
+  if (WARN_ON_ONCE(!ba_data)) {
+    goto out;
+  }
 
-    sta = rcu_dereference(mvm->fw_id_to_mac_id[ba_data->sta_id]);
-    if (WARN_ON_ONCE(IS_ERR_OR_NULL(sta))) { goto out; }
+  sta = iwl_rcu_load(mvm->fw_id_to_mac_id[ba_data->sta_id]);
+  if (WARN_ON_ONCE(!sta)) {
+    goto out;
+  }
 
-    reorder_buf = &ba_data->reorder_buf[queue];
+  reorder_buf = &ba_data->reorder_buf[queue];
 
-    spin_lock_bh(&reorder_buf->lock);
-    iwl_mvm_release_frames(mvm, sta, napi, ba_data, reorder_buf, le16_to_cpu(release->nssn));
-    spin_unlock_bh(&reorder_buf->lock);
+  mtx_lock(&reorder_buf->lock);
+  iwl_mvm_release_frames(mvm, sta, ba_data, reorder_buf, le16_to_cpu(release->nssn));
+  mtx_unlock(&reorder_buf->lock);
 
 out:
-    rcu_read_unlock();
-#endif  // NEEDS_PORTING
+  iwl_rcu_read_unlock(mvm->dev);
 }
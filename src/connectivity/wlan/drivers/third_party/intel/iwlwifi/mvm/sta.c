@@ -41,6 +41,7 @@
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/mvm/rs.h"
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/ieee80211.h"
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/rcu.h"
+#include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/time.h"
 
 static zx_status_t iwl_mvm_set_fw_key_idx(struct iwl_mvm* mvm);
 
@@ -1366,36 +1367,44 @@ static inline uint8_t iwl_mvm_tid_to_ac_queue(int tid) {
   return tid_to_mac80211_ac[tid];
 }
 
-void iwl_mvm_add_new_dqa_stream_wk(struct work_struct* wk) {
-  struct iwl_mvm* mvm = container_of(wk, struct iwl_mvm, add_stream_wk);
-
-  mutex_lock(&mvm->mutex);
+#endif  // NEEDS_PORTING
 
-  iwl_mvm_inactivity_check(mvm, IWL_MVM_INVALID_STA);
+// Allocate the queues of the TIDs which had traffic before they had a queue of their own (see
+// iwl_mvm_tx_mpdu()). Their frames have been sent on the station's default queue meanwhile.
+void iwl_mvm_add_new_dqa_stream_wk(void* data) {
+  struct iwl_mvm* mvm = data;
 
-  while (!list_empty(&mvm->add_stream_txqs)) {
-    struct iwl_mvm_txq* mvmtxq;
-    struct ieee80211_txq* txq;
-    uint8_t tid;
+  mtx_lock(&mvm->mutex);
 
-    mvmtxq = list_first_entry(&mvm->add_stream_txqs, struct iwl_mvm_txq, list);
+  for (size_t sta_id = 0; sta_id < ARRAY_SIZE(mvm->fw_id_to_mac_id); sta_id++) {
+    struct iwl_mvm_sta* mvmsta = mvm->fw_id_to_mac_id[sta_id];
 
-    txq = container_of((void*)mvmtxq, struct ieee80211_txq, drv_priv);
-    tid = txq->tid;
-    if (tid == fuchsia_wlan_ieee80211_TIDS_MAX) {
-      tid = IWL_MAX_TID_COUNT;
+    if (!mvmsta) {
+      continue;
     }
 
-    iwl_mvm_sta_alloc_queue(mvm, txq->sta, txq->ac, tid);
-    list_del_init(&mvmtxq->list);
-    local_bh_disable();
-    iwl_mvm_mac_itxq_xmit(mvm->hw, txq);
-    local_bh_enable();
+    for (uint8_t tid = 0; tid < IWL_MAX_TID_COUNT; tid++) {
+      if (!(mvmsta->deferred_traffic_tid_map & BIT(tid))) {
+        continue;
+      }
+      mvmsta->deferred_traffic_tid_map &= ~BIT(tid);
+      if (mvmsta->tid_data[tid].txq_id != IWL_MVM_INVALID_QUEUE) {
+        continue;
+      }
+
+      // On failure, the TID simply keeps using the default queue.
+      zx_status_t ret = iwl_mvm_sta_alloc_queue(mvm, mvmsta, tid_to_mac80211_ac[tid], tid);
+      if (ret != ZX_OK) {
+        IWL_WARN(mvm, "failed to allocate a queue for tid %d on sta_id %zu: %s\n", tid, sta_id,
+                 zx_status_get_string(ret));
+      }
+    }
   }
 
-  mutex_unlock(&mvm->mutex);
+  mtx_unlock(&mvm->mutex);
 }
 
+#if 0   // NEEDS_PORTING
 static int iwl_mvm_reserve_sta_stream(struct iwl_mvm* mvm, struct ieee80211_sta* sta,
                                       enum nl80211_iftype vif_type) {
   struct iwl_mvm_sta* mvmsta = iwl_mvm_sta_from_mac80211(sta);
@@ -1623,15 +1632,20 @@ zx_status_t iwl_mvm_add_sta(struct iwl_mvm_vif* mvmvif, struct iwl_mvm_sta* mvm_
   }
 
   mvm_sta->agg_tids = 0;
+  mvm_sta->deferred_traffic_tid_map = 0;
 
-#if 0   // NEEDS_PORTING
-  if (iwl_mvm_has_new_rx_api(mvm) && !test_bit(IWL_MVM_STATUS_IN_HW_RESTART, &mvm->status)) {
+  for (size_t i = 0; i < ARRAY_SIZE(mvm_sta->tid_to_baid); i++) {
+    mvm_sta->tid_to_baid[i] = IWL_RX_REORDER_DATA_INVALID_BAID;
+  }
+
+  if (iwl_mvm_has_new_rx_api(mvmvif->mvm) &&
+      !test_bit(IWL_MVM_STATUS_IN_HW_RESTART, &mvmvif->mvm->status)) {
     int q;
 
     struct iwl_mvm_rxq_dup_data* dup_data =
-      kcalloc(mvm->trans->num_rx_queues, sizeof(*dup_data), GFP_KERNEL);
+        calloc(mvmvif->mvm->trans->num_rx_queues, sizeof(*dup_data));
     if (!dup_data) {
-      return -ENOMEM;
+      return ZX_ERR_NO_MEMORY;
     }
     /*
      * Initialize all the last_seq values to 0xffff which can never
@@ -1642,12 +1656,13 @@ zx_status_t iwl_mvm_add_sta(struct iwl_mvm_vif* mvmvif, struct iwl_mvm_sta* mvm_
      * This thus allows receiving a packet with seqno 0 and the
      * retry bit set as the very first packet on a new TID.
      */
-    for (q = 0; q < mvm->trans->num_rx_queues; q++) {
+    for (q = 0; q < mvmvif->mvm->trans->num_rx_queues; q++) {
       memset(dup_data[q].last_seq, 0xff, sizeof(dup_data[q].last_seq));
     }
     mvm_sta->dup_data = dup_data;
   }
 
+#if 0   // NEEDS_PORTING
   if (!iwl_mvm_has_new_tx_api(mvm)) {
     ret = iwl_mvm_reserve_sta_stream(mvm, sta, ieee80211_vif_type_p2p(vif));
     if (ret) {
@@ -1693,6 +1708,10 @@ update_fw:
   ret = ZX_OK;
 
 err:
+  if (ret != ZX_OK) {
+    free(mvm_sta->dup_data);
+    mvm_sta->dup_data = NULL;
+  }
   return ret;
 }
 
@@ -1824,11 +1843,22 @@ zx_status_t iwl_mvm_rm_sta(struct iwl_mvm_vif* mvmvif, struct iwl_mvm_sta* mvm_s
 
   iwl_assert_lock_held(&mvm->mutex);
 
-#if 0   // // NEEDS_PORTING
-  if (iwl_mvm_has_new_rx_api(mvm)) {
-    kfree(mvm_sta->dup_data);
+  /* tear down any RX BA session still open, releasing the frames held for reordering */
+  for (int tid = 0; tid < IWL_MAX_TID_COUNT; tid++) {
+    uint8_t baid = mvm_sta->tid_to_baid[tid];
+    struct iwl_mvm_baid_data* baid_data;
+
+    if (baid >= IWL_MAX_BAID) {
+      continue;
+    }
+    baid_data = iwl_rcu_load(mvm->baid_map[baid]);
+    if (!baid_data || baid_data->sta_id != sta_id || baid_data->tid != tid) {
+      continue;
+    }
+    if (iwl_mvm_sta_rx_agg(mvm, mvm_sta, tid, 0, false, 0, 0) != ZX_OK) {
+      IWL_WARN(mvmvif, "Failed to stop RX BA session for tid %d\n", tid);
+    }
   }
-#endif  // NEEDS_PORTING
 
   ret = iwl_mvm_drain_sta(mvm, mvm_sta, true);
   if (ret != ZX_OK) {
@@ -1914,6 +1944,12 @@ zx_status_t iwl_mvm_rm_sta(struct iwl_mvm_vif* mvmvif, struct iwl_mvm_sta* mvm_s
   ret = iwl_mvm_rm_sta_common(mvm, mvm_sta->sta_id);
   iwl_rcu_store(mvm->fw_id_to_mac_id[mvm_sta->sta_id], NULL);
 
+  /* the RX path may still be looking at the duplicate detection data */
+  if (mvm_sta->dup_data) {
+    iwl_rcu_free_sync(mvm->dev, mvm_sta->dup_data);
+    mvm_sta->dup_data = NULL;
+  }
+
   return ret;
 }
 
@@ -2360,150 +2396,146 @@ int iwl_mvm_rm_mcast_sta(struct iwl_mvm* mvm, struct ieee80211_vif* vif) {
   return ret;
 }
 
-#define IWL_MAX_RX_BA_SESSIONS 16
+#endif  // NEEDS_PORTING
 
-static void iwl_mvm_sync_rxq_del_ba(struct iwl_mvm* mvm, uint8_t baid) {
-  struct iwl_mvm_delba_notif notif = {
-      .metadata.type = IWL_MVM_RXQ_NOTIF_DEL_BA,
-      .metadata.sync = 1,
-      .delba.baid = baid,
-  };
-  iwl_mvm_sync_rx_queues_internal(mvm, (void*)&notif, sizeof(notif));
-};
+#define IWL_MAX_RX_BA_SESSIONS 16
 
 static void iwl_mvm_free_reorder(struct iwl_mvm* mvm, struct iwl_mvm_baid_data* data) {
-  int i;
-
-  iwl_mvm_sync_rxq_del_ba(mvm, data->baid);
-
-  for (i = 0; i < mvm->trans->num_rx_queues; i++) {
-    int j;
+  for (int i = 0; i < mvm->trans->num_rx_queues; i++) {
     struct iwl_mvm_reorder_buffer* reorder_buf = &data->reorder_buf[i];
     struct iwl_mvm_reorder_buf_entry* entries = &data->entries[i * data->entries_per_queue];
 
-    spin_lock_bh(&reorder_buf->lock);
-    if (likely(!reorder_buf->num_stored)) {
-      spin_unlock_bh(&reorder_buf->lock);
-      continue;
+    if (!reorder_buf->reorder_timer) {
+      // The reorder buffer initialization failed before this queue.
+      break;
     }
 
-    /*
-     * This shouldn't happen in regular DELBA since the internal
-     * delBA notification should trigger a release of all frames in
-     * the reorder buffer.
-     */
-    WARN_ON(1);
+    iwl_mvm_del_ba(mvm, i, data);
+
+    mtx_lock(&reorder_buf->lock);
+    if (unlikely(reorder_buf->num_stored)) {
+      /*
+       * This shouldn't happen since iwl_mvm_del_ba() has released all
+       * the frames and the RX path can no longer reach the BA data.
+       */
+      WARN_ON(1);
+
+      for (int j = 0; j < reorder_buf->buf_size; j++) {
+        struct iwl_mvm_reorder_buf_frame* frame;
 
-    for (j = 0; j < reorder_buf->buf_size; j++) {
-      __skb_queue_purge(&entries[j].e.frames);
+        while ((frame = list_remove_head_type(&entries[j].frames, struct iwl_mvm_reorder_buf_frame,
+                                              list))) {
+          free(frame);
+        }
+      }
+      reorder_buf->num_stored = 0;
     }
+    /* Prevent timer re-arm. */
+    reorder_buf->removed = true;
+    mtx_unlock(&reorder_buf->lock);
+
     /*
-     * Prevent timer re-arm. This prevents a very far fetched case
-     * where we timed out on the notification. There may be prior
-     * RX frames pending in the RX queue before the notification
-     * that might get processed between now and the actual deletion
-     * and we would re-arm the timer although we are deleting the
-     * reorder buffer.
+     * The timer may have fired after the RCU sync of the caller, and still be running on
+     * the buffer: wait for it to return before the BA data is freed.
      */
-    reorder_buf->removed = true;
-    spin_unlock_bh(&reorder_buf->lock);
-    del_timer_sync(&reorder_buf->reorder_timer);
+    iwl_irq_timer_stop_sync(reorder_buf->reorder_timer);
+    iwl_irq_timer_release_sync(reorder_buf->reorder_timer);
+    reorder_buf->reorder_timer = NULL;
   }
 }
 
-static void iwl_mvm_init_reorder_buffer(struct iwl_mvm* mvm, struct iwl_mvm_baid_data* data,
-                                        uint16_t ssn, uint16_t buf_size) {
-  int i;
-
-  for (i = 0; i < mvm->trans->num_rx_queues; i++) {
+static zx_status_t iwl_mvm_init_reorder_buffer(struct iwl_mvm* mvm,
+                                               struct iwl_mvm_baid_data* data, uint16_t ssn,
+                                               uint16_t buf_size) {
+  for (int i = 0; i < mvm->trans->num_rx_queues; i++) {
     struct iwl_mvm_reorder_buffer* reorder_buf = &data->reorder_buf[i];
     struct iwl_mvm_reorder_buf_entry* entries = &data->entries[i * data->entries_per_queue];
-    int j;
+    zx_status_t ret;
 
     reorder_buf->num_stored = 0;
     reorder_buf->head_sn = ssn;
     reorder_buf->buf_size = buf_size;
-    /* rx reorder timer */
-    timer_setup(&reorder_buf->reorder_timer, iwl_mvm_reorder_timer_expired, 0);
-    spin_lock_init(&reorder_buf->lock);
+    mtx_init(&reorder_buf->lock, mtx_plain);
     reorder_buf->mvm = mvm;
     reorder_buf->queue = i;
     reorder_buf->valid = false;
-    for (j = 0; j < reorder_buf->buf_size; j++) {
-      __skb_queue_head_init(&entries[j].e.frames);
+    for (int j = 0; j < reorder_buf->buf_size; j++) {
+      list_initialize(&entries[j].frames);
+    }
+    /* rx reorder timer */
+    ret = iwl_irq_timer_create(mvm->dev, iwl_mvm_reorder_timer_expired, reorder_buf,
+                               &reorder_buf->reorder_timer);
+    if (ret != ZX_OK) {
+      return ret;
     }
   }
+
+  return ZX_OK;
 }
 
-int iwl_mvm_sta_rx_agg(struct iwl_mvm* mvm, struct ieee80211_sta* sta, int tid, uint16_t ssn,
-                       bool start, uint16_t buf_size, uint16_t timeout) {
-  struct iwl_mvm_sta* mvm_sta = iwl_mvm_sta_from_mac80211(sta);
+// Send the ADD_STA command which starts or stops the RX BA session of the TID in the firmware.
+static zx_status_t iwl_mvm_send_rx_ba_cmd(struct iwl_mvm* mvm, struct iwl_mvm_sta* mvm_sta, int tid,
+                                          uint16_t ssn, bool start, uint16_t buf_size,
+                                          uint32_t* status) {
   struct iwl_mvm_add_sta_cmd cmd = {};
+
+  cmd.mac_id_n_color = cpu_to_le32(mvm_sta->mac_id_n_color);
+  cmd.sta_id = mvm_sta->sta_id;
+  cmd.add_modify = STA_MODE_MODIFY;
+  if (start) {
+    cmd.add_immediate_ba_tid = (uint8_t)tid;
+    cmd.add_immediate_ba_ssn = cpu_to_le16(ssn);
+    cmd.rx_ba_window = cpu_to_le16(buf_size);
+  } else {
+    cmd.remove_immediate_ba_tid = (uint8_t)tid;
+  }
+  cmd.modify_mask = start ? STA_MODIFY_ADD_BA_TID : STA_MODIFY_REMOVE_BA_TID;
+
+  *status = ADD_STA_SUCCESS;
+  return iwl_mvm_send_cmd_pdu_status(mvm, ADD_STA, iwl_mvm_add_sta_cmd_size(mvm), &cmd, status);
+}
+
+// Start or stop an RX BA session for the TID of the station.
+//
+// The firmware assigns a BAID to the session, which is then reported in the reorder data of the
+// MPDUs received in the session.  When the new RX API is in use, the driver keeps a reorder buffer
+// per RX queue for the session and reorders the MPDUs before passing them to MLME.
+zx_status_t iwl_mvm_sta_rx_agg(struct iwl_mvm* mvm, struct iwl_mvm_sta* mvm_sta, int tid,
+                               uint16_t ssn, bool start, uint16_t buf_size, uint16_t timeout) {
   struct iwl_mvm_baid_data* baid_data = NULL;
-  int ret;
+  zx_status_t ret;
   uint32_t status;
 
   iwl_assert_lock_held(&mvm->mutex);
 
+  if (tid < 0 || tid >= IWL_MAX_TID_COUNT) {
+    return ZX_ERR_INVALID_ARGS;
+  }
+
   if (start && mvm->rx_ba_sessions >= IWL_MAX_RX_BA_SESSIONS) {
     IWL_WARN(mvm, "Not enough RX BA SESSIONS\n");
-    return -ENOSPC;
+    return ZX_ERR_NO_RESOURCES;
   }
 
   if (iwl_mvm_has_new_rx_api(mvm) && start) {
-    uint16_t reorder_buf_size = buf_size * sizeof(baid_data->entries[0]);
-
-    /* sparse doesn't like the __align() so don't check */
-#ifndef __CHECKER__
-    /*
-     * The division below will be OK if either the cache line size
-     * can be divided by the entry size (ALIGN will round up) or if
-     * if the entry size can be divided by the cache line size, in
-     * which case the ALIGN() will do nothing.
-     */
-    BUILD_BUG_ON(SMP_CACHE_BYTES % sizeof(baid_data->entries[0]) &&
-                 sizeof(baid_data->entries[0]) % SMP_CACHE_BYTES);
-#endif
-
-    /*
-     * Upward align the reorder buffer size to fill an entire cache
-     * line for each queue, to avoid sharing cache lines between
-     * different queues.
-     */
-    reorder_buf_size = ALIGN(reorder_buf_size, SMP_CACHE_BYTES);
+    if (!buf_size) {
+      return ZX_ERR_INVALID_ARGS;
+    }
 
     /*
      * Allocate here so if allocation fails we can bail out early
      * before starting the BA session in the firmware
      */
-    baid_data =
-        kzalloc(sizeof(*baid_data) + mvm->trans->num_rx_queues * reorder_buf_size, GFP_KERNEL);
+    baid_data = calloc(1, sizeof(*baid_data) + mvm->trans->num_rx_queues * buf_size *
+                                                   sizeof(baid_data->entries[0]));
     if (!baid_data) {
-      return -ENOMEM;
+      return ZX_ERR_NO_MEMORY;
     }
-
-    /*
-     * This division is why we need the above BUILD_BUG_ON(),
-     * if that doesn't hold then this will not be right.
-     */
-    baid_data->entries_per_queue = reorder_buf_size / sizeof(baid_data->entries[0]);
-  }
-
-  cmd.mac_id_n_color = cpu_to_le32(mvm_sta->mac_id_n_color);
-  cmd.sta_id = mvm_sta->sta_id;
-  cmd.add_modify = STA_MODE_MODIFY;
-  if (start) {
-    cmd.add_immediate_ba_tid = (uint8_t)tid;
-    cmd.add_immediate_ba_ssn = cpu_to_le16(ssn);
-    cmd.rx_ba_window = cpu_to_le16(buf_size);
-  } else {
-    cmd.remove_immediate_ba_tid = (uint8_t)tid;
+    baid_data->entries_per_queue = buf_size;
   }
-  cmd.modify_mask = start ? STA_MODIFY_ADD_BA_TID : STA_MODIFY_REMOVE_BA_TID;
 
-  status = ADD_STA_SUCCESS;
-  ret = iwl_mvm_send_cmd_pdu_status(mvm, ADD_STA, iwl_mvm_add_sta_cmd_size(mvm), &cmd, &status);
-  if (ret) {
+  ret = iwl_mvm_send_rx_ba_cmd(mvm, mvm_sta, tid, ssn, start, buf_size, &status);
+  if (ret != ZX_OK) {
     goto out_free;
   }
 
@@ -2513,56 +2545,62 @@ int iwl_mvm_sta_rx_agg(struct iwl_mvm* mvm, struct ieee80211_sta* sta, int tid,
       break;
     case ADD_STA_IMMEDIATE_BA_FAILURE:
       IWL_WARN(mvm, "RX BA Session refused by fw\n");
-      ret = -ENOSPC;
+      ret = ZX_ERR_NO_RESOURCES;
       break;
     default:
-      ret = -EIO;
+      ret = ZX_ERR_IO;
       IWL_ERR(mvm, "RX BA Session failed %sing, status 0x%x\n", start ? "start" : "stopp", status);
       break;
   }
 
-  if (ret) {
+  if (ret != ZX_OK) {
     goto out_free;
   }
 
   if (start) {
     uint8_t baid;
 
-    mvm->rx_ba_sessions++;
-
     if (!iwl_mvm_has_new_rx_api(mvm)) {
-      return 0;
+      mvm->rx_ba_sessions++;
+      return ZX_OK;
     }
 
     if (WARN_ON(!(status & IWL_ADD_STA_BAID_VALID_MASK))) {
-      ret = -EINVAL;
-      goto out_free;
+      ret = ZX_ERR_INTERNAL;
+      goto out_stop;
     }
     baid = (uint8_t)((status & IWL_ADD_STA_BAID_MASK) >> IWL_ADD_STA_BAID_SHIFT);
+    if (WARN_ON(baid >= IWL_MAX_BAID)) {
+      ret = ZX_ERR_INTERNAL;
+      goto out_stop;
+    }
     baid_data->baid = baid;
     baid_data->timeout = timeout;
-    baid_data->last_rx = jiffies;
-    baid_data->rcu_ptr = &mvm->baid_map[baid];
-    timer_setup(&baid_data->session_timer, iwl_mvm_rx_agg_session_expired, 0);
+    baid_data->last_rx = iwl_time_now(mvm->dev);
     baid_data->mvm = mvm;
     baid_data->tid = tid;
     baid_data->sta_id = mvm_sta->sta_id;
 
-    mvm_sta->tid_to_baid[tid] = baid;
-    if (timeout) {
-      mod_timer(&baid_data->session_timer, TU_TO_EXP_TIME(timeout * 2));
+    // TODO(fxbug.dev/51295): the session timer which tears down an idle session is not ported,
+    // since MLME has no hook to be told about it.
+
+    ret = iwl_mvm_init_reorder_buffer(mvm, baid_data, ssn, buf_size);
+    if (ret != ZX_OK) {
+      iwl_mvm_free_reorder(mvm, baid_data);
+      goto out_stop;
     }
 
-    iwl_mvm_init_reorder_buffer(mvm, baid_data, ssn, buf_size);
+    mvm_sta->tid_to_baid[tid] = baid;
+
     /*
-     * protect the BA data with RCU to cover a case where our
-     * internal RX sync mechanism will timeout (not that it's
-     * supposed to happen) and we will free the session data while
-     * RX is being processed in parallel
+     * protect the BA data with RCU to cover a case where
+     * we free the session data while RX is being processed
+     * in parallel
      */
     IWL_DEBUG_HT(mvm, "Sta %d(%d) is assigned to BAID %d\n", mvm_sta->sta_id, tid, baid);
-    WARN_ON(rcu_access_pointer(mvm->baid_map[baid]));
-    rcu_assign_pointer(mvm->baid_map[baid], baid_data);
+    WARN_ON(iwl_rcu_load(mvm->baid_map[baid]));
+    iwl_rcu_store(mvm->baid_map[baid], baid_data);
+    mvm->rx_ba_sessions++;
   } else {
     uint8_t baid = mvm_sta->tid_to_baid[tid];
 
@@ -2570,32 +2608,143 @@ int iwl_mvm_sta_rx_agg(struct iwl_mvm* mvm, struct ieee80211_sta* sta, int tid,
       mvm->rx_ba_sessions--;
     }
     if (!iwl_mvm_has_new_rx_api(mvm)) {
-      return 0;
+      return ZX_OK;
     }
 
-    if (WARN_ON(baid == IWL_RX_REORDER_DATA_INVALID_BAID)) {
-      return -EINVAL;
+    if (WARN_ON(baid == IWL_RX_REORDER_DATA_INVALID_BAID || baid >= IWL_MAX_BAID)) {
+      return ZX_ERR_INVALID_ARGS;
     }
 
-    baid_data = rcu_access_pointer(mvm->baid_map[baid]);
+    baid_data = iwl_rcu_load(mvm->baid_map[baid]);
     if (WARN_ON(!baid_data)) {
-      return -EINVAL;
+      return ZX_ERR_INVALID_ARGS;
     }
 
-    /* synchronize all rx queues so we can safely delete */
+    /* unpublish the BA data and wait until no RX path can see it, so we can safely delete */
+    iwl_rcu_store(mvm->baid_map[baid], NULL);
+    mvm_sta->tid_to_baid[tid] = IWL_RX_REORDER_DATA_INVALID_BAID;
+    iwl_rcu_sync(mvm->dev);
+
     iwl_mvm_free_reorder(mvm, baid_data);
-    del_timer_sync(&baid_data->session_timer);
-    RCU_INIT_POINTER(mvm->baid_map[baid], NULL);
-    kfree_rcu(baid_data, rcu_head);
+    free(baid_data);
     IWL_DEBUG_HT(mvm, "BAID %d is free\n", baid);
   }
-  return 0;
+  return ZX_OK;
 
+out_stop:
+  // The firmware has accepted the session, tear it down again so that it does not keep a BAID the
+  // driver has no reorder buffer for.
+  if (iwl_mvm_send_rx_ba_cmd(mvm, mvm_sta, tid, 0, false, 0, &status) != ZX_OK ||
+      (status & IWL_ADD_STA_STATUS_MASK) != ADD_STA_SUCCESS) {
+    IWL_ERR(mvm, "Failed to stop RX BA session of tid %d in fw\n", tid);
+  }
 out_free:
-  kfree(baid_data);
+  free(baid_data);
   return ret;
 }
 
+// MLME negotiates the RX BA sessions with the station, the driver only sees the Block Ack action
+// frames go by. The two functions below follow them to start and stop the sessions:
+//
+//   - The ADDBA request received from the station carries the starting sequence number of the
+//     session, which is kept until MLME answers it.
+//   - A successful ADDBA response sent by MLME starts the session, with the buffer size and timeout
+//     it has accepted.
+//   - A DELBA sent by MLME as the recipient stops the session.
+//
+// A DELBA received from the station is not followed, since the RX path cannot take the mvm mutex.
+// The stale session does no harm: the station now sends in-order frames, which pass through the
+// reorder buffer, and the session is replaced by the next ADDBA exchange on the TID or torn down
+// with the station.
+//
+// The sessions are only followed with the multi-queue RX API, whose RX path records the starting
+// sequence number.
+
+// Called on the RX path, without the mvm mutex, for the action frames received from the station.
+void iwl_mvm_sta_rx_ba_action(struct iwl_mvm* mvm, struct iwl_mvm_sta* mvm_sta,
+                              const uint8_t* body, size_t body_len) {
+  const struct ieee80211_back_action* action = (const struct ieee80211_back_action*)body;
+
+  if (!iwl_mvm_has_new_rx_api(mvm) ||
+      body_len < offsetof(struct ieee80211_back_action, u) + sizeof(action->u.addba_req) ||
+      action->category != IEEE80211_ACTION_CATEGORY_BACK ||
+      action->action != IEEE80211_BACK_ACTION_ADDBA_REQ) {
+    return;
+  }
+
+  uint16_t params = le16_to_cpu(action->u.addba_req.params);
+  uint8_t tid = (params & IEEE80211_ADDBA_PARAM_TID_MASK) >> IEEE80211_ADDBA_PARAM_TID_SHIFT;
+  if (tid >= IWL_MAX_TID_COUNT) {
+    return;
+  }
+  mvm_sta->rx_ba_req_ssn[tid] = IEEE80211_SEQ_TO_SN(le16_to_cpu(action->u.addba_req.start_seq_num));
+}
+
+// Called with the mvm mutex held, once an action frame for the station is queued for TX.
+void iwl_mvm_sta_tx_ba_action(struct iwl_mvm* mvm, struct iwl_mvm_sta* mvm_sta,
+                              const uint8_t* body, size_t body_len) {
+  const struct ieee80211_back_action* action = (const struct ieee80211_back_action*)body;
+  uint16_t params;
+  uint8_t tid;
+
+  iwl_assert_lock_held(&mvm->mutex);
+
+  if (!iwl_mvm_has_new_rx_api(mvm) || body_len < offsetof(struct ieee80211_back_action, u) ||
+      action->category != IEEE80211_ACTION_CATEGORY_BACK) {
+    return;
+  }
+
+  switch (action->action) {
+    case IEEE80211_BACK_ACTION_ADDBA_RESP: {
+      if (body_len < offsetof(struct ieee80211_back_action, u) + sizeof(action->u.addba_resp) ||
+          le16_to_cpu(action->u.addba_resp.status) != IEEE80211_STATUS_SUCCESS) {
+        return;
+      }
+      params = le16_to_cpu(action->u.addba_resp.params);
+      tid = (params & IEEE80211_ADDBA_PARAM_TID_MASK) >> IEEE80211_ADDBA_PARAM_TID_SHIFT;
+      if (tid >= IWL_MAX_TID_COUNT) {
+        return;
+      }
+      uint16_t buf_size =
+          (params & IEEE80211_ADDBA_PARAM_BUF_SIZE_MASK) >> IEEE80211_ADDBA_PARAM_BUF_SIZE_SHIFT;
+      if (!buf_size || buf_size > IEEE80211_MAX_AMPDU_BUF_HT) {
+        buf_size = IEEE80211_MAX_AMPDU_BUF_HT;
+      }
+
+      // A new ADDBA exchange replaces the session of the TID.
+      if (mvm_sta->tid_to_baid[tid] != IWL_RX_REORDER_DATA_INVALID_BAID &&
+          iwl_mvm_sta_rx_agg(mvm, mvm_sta, tid, 0, false, 0, 0) != ZX_OK) {
+        IWL_WARN(mvm, "Failed to stop RX BA session for tid %d\n", tid);
+        return;
+      }
+      if (iwl_mvm_sta_rx_agg(mvm, mvm_sta, tid, mvm_sta->rx_ba_req_ssn[tid], true, buf_size,
+                             le16_to_cpu(action->u.addba_resp.timeout)) != ZX_OK) {
+        IWL_WARN(mvm, "Failed to start RX BA session for tid %d\n", tid);
+      }
+      break;
+    }
+    case IEEE80211_BACK_ACTION_DELBA: {
+      if (body_len < offsetof(struct ieee80211_back_action, u) + sizeof(action->u.delba)) {
+        return;
+      }
+      params = le16_to_cpu(action->u.delba.params);
+      tid = (params & IEEE80211_DELBA_PARAM_TID_MASK) >> IEEE80211_DELBA_PARAM_TID_SHIFT;
+      // As the originator, the DELBA is about a TX BA session.
+      if ((params & IEEE80211_DELBA_PARAM_INITIATOR_MASK) || tid >= IWL_MAX_TID_COUNT ||
+          mvm_sta->tid_to_baid[tid] == IWL_RX_REORDER_DATA_INVALID_BAID) {
+        return;
+      }
+      if (iwl_mvm_sta_rx_agg(mvm, mvm_sta, tid, 0, false, 0, 0) != ZX_OK) {
+        IWL_WARN(mvm, "Failed to stop RX BA session for tid %d\n", tid);
+      }
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+#if 0   // NEEDS_PORTING
 int iwl_mvm_sta_tx_agg(struct iwl_mvm* mvm, struct ieee80211_sta* sta, int tid, uint8_t queue,
                        bool start) {
   struct iwl_mvm_sta* mvm_sta = iwl_mvm_sta_from_mac80211(sta);
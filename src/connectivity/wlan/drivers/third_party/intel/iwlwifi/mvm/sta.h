@@ -374,6 +374,8 @@ struct iwl_mvm_txq {
  * and from Tx response flow, it needs a spinlock.
  * @tid_data: per tid data + mgmt. Look at %iwl_mvm_tid_data.
  * @tid_to_baid: a simple map of TID to baid
+ * @rx_ba_req_ssn: per TID, the starting sequence number of the last ADDBA
+ *  request received from the station (see iwl_mvm_sta_rx_ba_action())
  * @lq_sta: holds rate scaling data, either for the case when RS is done in
  *  the driver - %rs_drv or in the FW - %rs_fw.
  * @reserved_queue: the queue reserved for this STA for DQA purposes
@@ -393,7 +395,8 @@ struct iwl_mvm_txq {
  *  the BA window. To be used for UAPSD only.
  * @ptk_pn: per-queue PTK PN data structures
  * @dup_data: per queue duplicate packet detection data
- * @deferred_traffic_tid_map: indication bitmap of deferred traffic per-TID
+ * @deferred_traffic_tid_map: bitmap of the TIDs which had traffic but no
+ *  queue yet, and wait for %mvm->add_stream_wk to allocate one
  * @tx_ant: the index of the antenna to use for data tx to this station. Only
  *  used during connection establishment (e.g. for the 4 way handshake
  *  exchange).
@@ -417,6 +420,7 @@ struct iwl_mvm_sta {
   mtx_t lock;
   struct iwl_mvm_tid_data tid_data[IWL_MAX_TID_COUNT + 1];
   uint8_t tid_to_baid[IWL_MAX_TID_COUNT];
+  uint16_t rx_ba_req_ssn[IWL_MAX_TID_COUNT];
   union {
     struct iwl_lq_sta_rs_fw rs_fw;
     struct iwl_lq_sta rs_drv;
@@ -442,6 +446,7 @@ struct iwl_mvm_sta {
   uint16_t max_amsdu_len;
   bool sleeping;
   uint8_t agg_tids;
+  uint8_t deferred_traffic_tid_map;
   uint8_t sleep_tx_count;
   uint8_t avg_energy;
   uint8_t tx_ant;
@@ -515,8 +520,12 @@ void iwl_mvm_update_tkip_key(struct iwl_mvm* mvm, struct ieee80211_vif* vif,
 void iwl_mvm_rx_eosp_notif(struct iwl_mvm* mvm, struct iwl_rx_cmd_buffer* rxb);
 
 /* AMPDU */
-int iwl_mvm_sta_rx_agg(struct iwl_mvm* mvm, struct ieee80211_sta* sta, int tid, uint16_t ssn,
-                       bool start, uint16_t buf_size, uint16_t timeout);
+zx_status_t iwl_mvm_sta_rx_agg(struct iwl_mvm* mvm, struct iwl_mvm_sta* mvm_sta, int tid,
+                               uint16_t ssn, bool start, uint16_t buf_size, uint16_t timeout);
+void iwl_mvm_sta_rx_ba_action(struct iwl_mvm* mvm, struct iwl_mvm_sta* mvm_sta,
+                              const uint8_t* body, size_t body_len);
+void iwl_mvm_sta_tx_ba_action(struct iwl_mvm* mvm, struct iwl_mvm_sta* mvm_sta,
+                              const uint8_t* body, size_t body_len);
 int iwl_mvm_sta_tx_agg_start(struct iwl_mvm* mvm, struct ieee80211_vif* vif,
                              struct ieee80211_sta* sta, uint16_t tid, uint16_t* ssn);
 int iwl_mvm_sta_tx_agg_oper(struct iwl_mvm* mvm, struct ieee80211_vif* vif,
@@ -557,6 +566,6 @@ void iwl_mvm_sta_modify_disable_tx_ap(struct iwl_mvm* mvm, struct ieee80211_sta*
 void iwl_mvm_modify_all_sta_disable_tx(struct iwl_mvm* mvm, struct iwl_mvm_vif* mvmvif,
                                        bool disable);
 void iwl_mvm_csa_client_absent(struct iwl_mvm* mvm, struct ieee80211_vif* vif);
-void iwl_mvm_add_new_dqa_stream_wk(struct work_struct* wk);
+void iwl_mvm_add_new_dqa_stream_wk(void* data);
 
 #endif  // SRC_CONNECTIVITY_WLAN_DRIVERS_THIRD_PARTY_INTEL_IWLWIFI_MVM_STA_H_
@@ -154,6 +154,23 @@ out:
 }
 #endif  // NEEDS_PORTING
 
+/*
+ * Returns the TID whose queue and sequence number space a frame uses.
+ *
+ * QoS data frames use the TID in their QoS Control field. Everything else, including QoS Null
+ * frames, goes to the MGMT TID (IWL_MAX_TID_COUNT), whose sequence number is assigned by the
+ * firmware.
+ */
+uint8_t iwl_mvm_tx_get_tid(const struct ieee80211_frame_header* hdr) {
+  if (ieee80211_is_data_qos(hdr) && !ieee80211_is_qos_nullfunc(hdr)) {
+    uint8_t tid = ieee80211_get_tid(hdr);
+
+    /* TSPEC TIDs (8-15) are not supported, so those frames go with the non-QoS ones. */
+    return tid < IWL_MAX_TID_COUNT ? tid : IWL_MAX_TID_COUNT;
+  }
+  return IWL_MAX_TID_COUNT;
+}
+
 /*
  * Sets most of the Tx cmd's fields
  */
@@ -163,9 +180,14 @@ void iwl_mvm_set_tx_cmd(struct iwl_mvm* mvm, struct ieee80211_mac_packet* pkt,
   tx_flags |= TX_CMD_FLG_SEQ_CTL;
   tx_flags |= TX_CMD_FLG_BT_DIS;
   tx_flags |= TX_CMD_FLG_ACK;
-  tx_cmd->tid_tspec = IWL_MAX_TID_COUNT;
 
-  // TODO(51120): below code needs rewrite to support QoS.
+  tx_cmd->tid_tspec = iwl_mvm_tx_get_tid(pkt->common_header);
+  if (tx_cmd->tid_tspec < IWL_MAX_TID_COUNT) {
+    /* the sequence number is assigned per-TID in iwl_mvm_tx_mpdu() */
+    tx_flags &= ~TX_CMD_FLG_SEQ_CTL;
+  }
+
+  // TODO(51120): below code needs rewrite to support the rest of QoS (A-MSDU, BAR, BT priority).
 #if 0   // NEEDS_PORTING
     struct ieee80211_hdr* hdr = (void*)skb->data;
     __le16 fc = hdr->frame_control;
@@ -969,8 +991,44 @@ static zx_status_t iwl_mvm_tx_pkt_queued(struct iwl_mvm* mvm, struct iwl_mvm_sta
 static zx_status_t iwl_mvm_tx_mpdu(struct iwl_mvm* mvm, struct ieee80211_mac_packet* pkt,
                                    struct ieee80211_tx_info* info, struct iwl_mvm_sta* mvmsta) {
   zx_status_t ret = ZX_OK;
-  uint8_t tid = IWL_MAX_TID_COUNT;  // TODO(51120): support QoS
-  uint16_t txq_id = mvmsta->tid_data[tid].txq_id;
+  uint8_t tid = iwl_mvm_tx_get_tid(pkt->common_header);
+  uint16_t seq_number = 0;
+
+  iwl_assert_lock_held(&mvm->mutex);
+
+  /*
+   * DQA mode: a TID gets its own queue, mapped to the FIFO of its AC. This is what gives the
+   * latency-sensitive ACs priority over bulk traffic.
+   *
+   * Allocating the queue takes host commands, so it is not done on the TX path: the first frames of
+   * a TID go on the station's default queue (the one of the MGMT TID, on the BE FIFO) until
+   * iwl_mvm_add_new_dqa_stream_wk() has allocated the TID's own queue. They keep the per-TID
+   * sequence number.
+   */
+  uint8_t queue_tid = tid;
+  if (mvmsta->tid_data[tid].txq_id == IWL_MVM_INVALID_QUEUE && tid < IWL_MAX_TID_COUNT) {
+    if (!(mvmsta->deferred_traffic_tid_map & BIT(tid))) {
+      mvmsta->deferred_traffic_tid_map |= BIT(tid);
+      iwl_task_post(mvm->add_stream_wk, 0);
+    }
+    queue_tid = IWL_MAX_TID_COUNT;
+  }
+  uint16_t txq_id = mvmsta->tid_data[queue_tid].txq_id;
+  if (txq_id == IWL_MVM_INVALID_QUEUE) {
+    IWL_ERR(mvm, "no queue for tid %d on sta_id %d\n", tid, mvmsta->sta_id);
+    return ZX_ERR_BAD_STATE;
+  }
+
+  /*
+   * The transport stops the queue when its ring runs low (see iwl_mvm_stop_sw_queue()). Push back
+   * on the caller until the reclaim path wakes it up again, instead of filling the reserved space.
+   */
+  struct iwl_mvm_txq* mvmtxq =
+      mvmsta->txq[queue_tid == IWL_MAX_TID_COUNT ? fuchsia_wlan_ieee80211_TIDS_MAX : queue_tid];
+  if (mvmtxq->stopped) {
+    IWL_DEBUG_TX(mvm, "txq %d is stopped, deferring tid %d\n", txq_id, tid);
+    return ZX_ERR_SHOULD_WAIT;
+  }
 
   struct iwl_device_cmd dev_cmd;
   if ((ret = iwl_mvm_set_tx_params(mvm, pkt, info, mvmsta, &dev_cmd)) != ZX_OK) {
@@ -980,11 +1038,23 @@ static zx_status_t iwl_mvm_tx_mpdu(struct iwl_mvm* mvm, struct ieee80211_mac_pac
 
   mtx_lock(&mvmsta->lock);
 
-  uint16_t seq_number = mvmsta->tid_data[tid].seq_number;
+  if (tid < IWL_MAX_TID_COUNT) {
+    struct iwl_tx_cmd* tx_cmd = (struct iwl_tx_cmd*)dev_cmd.payload;
+    struct ieee80211_frame_header* hdr = (struct ieee80211_frame_header*)tx_cmd->hdr;
+
+    seq_number = mvmsta->tid_data[tid].seq_number;
+    /* update the tx_cmd hdr as it was already copied */
+    hdr->seq_ctrl = (hdr->seq_ctrl & IEEE80211_SCTL_FRAG_MASK) |
+                    IEEE80211_SN_TO_SEQ(IEEE80211_SEQ_TO_SN(seq_number));
+  }
+
   IWL_DEBUG_TX(mvm, "iwl_mvm_tx_mpdu() TX to [std_id:%d|tid:%d] txq_id:%d - seq:0x%x\n",
                mvmsta->sta_id, tid, txq_id, seq_number >> 4);
 
   ret = iwl_trans_tx(mvm->trans, pkt, &dev_cmd, txq_id);
+  if (ret == ZX_OK && tid < IWL_MAX_TID_COUNT && !ieee80211_has_morefrags(pkt->common_header)) {
+    mvmsta->tid_data[tid].seq_number = seq_number + 0x10;
+  }
   mtx_unlock(&mvmsta->lock);
   if ((ret != ZX_OK)) {
     IWL_ERR(mvm, "failed to Tx packet: %s\n", zx_status_get_string(ret));
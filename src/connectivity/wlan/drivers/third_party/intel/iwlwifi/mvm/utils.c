@@ -48,6 +48,11 @@
  * CMD_WANT_SKB is set in cmd->flags.
  */
 zx_status_t iwl_mvm_send_cmd(struct iwl_mvm* mvm, struct iwl_host_cmd* cmd) {
+  /*
+   * iwl_trans_send_cmd_batched() sets CMD_ASYNC in cmd->flags, so the
+   * ref taken below is released based on the flags of the caller.
+   */
+  const uint32_t flags = cmd->flags;
   zx_status_t ret;
 
 #if defined(CPTCFG_IWLWIFI_DEBUGFS) && defined(CONFIG_PM_SLEEP)
@@ -67,9 +72,14 @@ zx_status_t iwl_mvm_send_cmd(struct iwl_mvm* mvm, struct iwl_host_cmd* cmd) {
       iwl_mvm_ref(mvm, IWL_MVM_REF_SENDING_CMD);
     }
   }
-  ret = iwl_trans_send_cmd(mvm->trans, cmd);
+  if ((cmd->flags & CMD_PIPELINED) && !(cmd->flags & CMD_ASYNC) && mvm->hcmd_batch_depth > 0 &&
+      thrd_equal(mvm->hcmd_batch_owner, thrd_current())) {
+    ret = iwl_trans_send_cmd_batched(mvm->trans, &mvm->hcmd_batch, cmd);
+  } else {
+    ret = iwl_trans_send_cmd(mvm->trans, cmd);
+  }
 
-  if (!(cmd->flags & (CMD_ASYNC | CMD_SEND_IN_IDLE))) {
+  if (!(flags & (CMD_ASYNC | CMD_SEND_IN_IDLE))) {
     iwl_mvm_unref(mvm, IWL_MVM_REF_SENDING_CMD);
   }
 
@@ -183,6 +193,55 @@ zx_status_t iwl_mvm_send_cmd_pdu_status(struct iwl_mvm* mvm, uint32_t id, uint16
   return iwl_mvm_send_cmd_status(mvm, &cmd, status);
 }
 
+/*
+ * Open a command batch for the calling thread. Until the matching iwl_mvm_hcmd_batch_end(), the
+ * CMD_PIPELINED commands it sends are queued to the firmware without waiting for their response,
+ * so that a flow sending many commands pays for one round trip instead of one per command. The
+ * other commands are sent as usual, and complete after the pipelined commands queued before them.
+ *
+ * Batches nest. A batch of another thread waits until the current one is closed.
+ * Must be called without mvm->mutex held.
+ */
+void iwl_mvm_hcmd_batch_begin(struct iwl_mvm* mvm) {
+  mtx_lock(&mvm->mutex);
+  while (mvm->hcmd_batch_depth > 0 && !thrd_equal(mvm->hcmd_batch_owner, thrd_current())) {
+    cnd_wait(&mvm->hcmd_batch_cnd, &mvm->mutex);
+  }
+  if (mvm->hcmd_batch_depth++ == 0) {
+    mvm->hcmd_batch_owner = thrd_current();
+  }
+  mtx_unlock(&mvm->mutex);
+}
+
+/*
+ * Close the command batch opened by iwl_mvm_hcmd_batch_begin(). The outermost call waits for all
+ * the pipelined commands to complete, and returns the first error they reported.
+ */
+zx_status_t iwl_mvm_hcmd_batch_end(struct iwl_mvm* mvm) {
+  zx_status_t ret = ZX_OK;
+
+  mtx_lock(&mvm->mutex);
+  ZX_ASSERT(mvm->hcmd_batch_depth > 0 && thrd_equal(mvm->hcmd_batch_owner, thrd_current()));
+  if (mvm->hcmd_batch_depth > 1) {
+    mvm->hcmd_batch_depth--;
+    mtx_unlock(&mvm->mutex);
+    return ZX_OK;
+  }
+  mtx_unlock(&mvm->mutex);
+
+  ret = iwl_hcmd_batch_wait(mvm->trans, &mvm->hcmd_batch);
+  if (ret != ZX_OK) {
+    IWL_ERR(mvm, "pipelined host command failed: %s\n", zx_status_get_string(ret));
+  }
+
+  mtx_lock(&mvm->mutex);
+  mvm->hcmd_batch_depth = 0;
+  cnd_broadcast(&mvm->hcmd_batch_cnd);
+  mtx_unlock(&mvm->mutex);
+
+  return ret;
+}
+
 //
 // mac80211_idx is actually an iwlwifi thing. It has different meanings in 2.4 GHz and 5 GHz, which
 // is confusing:
@@ -121,6 +121,31 @@ struct isr_statistics {
   uint32_t unhandled;
 };
 
+/*
+ * Number of staging buffers used to load the firmware. The CPU copies the next chunk of a section
+ * into one of them while the FH DMA reads the current chunk from the other.
+ */
+#define IWL_PCIE_FW_STAGING_BUFS 2
+
+/**
+ * struct iwl_pcie_fw_load_stats - timing of the last firmware image load
+ *
+ * @nic_init: time spent in iwl_pcie_nic_init() before loading the sections
+ * @copy: time spent copying the chunks into the staging buffers
+ * @dma_wait: time spent waiting for the FH DMA of the chunks
+ * @total: time spent loading all the sections of the image
+ * @bytes: number of bytes loaded
+ * @chunks: number of chunks loaded
+ */
+struct iwl_pcie_fw_load_stats {
+  zx_duration_t nic_init;
+  zx_duration_t copy;
+  zx_duration_t dma_wait;
+  zx_duration_t total;
+  size_t bytes;
+  size_t chunks;
+};
+
 #define IWL_RX_TD_TYPE_MSK 0xff000000
 #define IWL_RX_TD_SIZE_MSK 0x00ffffff
 #define IWL_RX_TD_SIZE_2K BIT(11)
@@ -187,6 +212,9 @@ struct iwl_rx_completion_desc {
  * @need_update: flag to indicate we need to update read/write index
  * @lock:
  * @queue: actual rx queue. Not used for multi-rx queue.
+ * @trans_pcie: pointer back to transport (for the RX thread)
+ * @rx_thread: thread that processes this RSS queue, or NULL if the queue is processed on the
+ *  interrupt thread (queue 0 always is, and so are the others unless rx_queue_threads is set).
  *
  * NOTE:  rx_free is used as a FIFO for iwl_rx_mem_buffers
  */
@@ -222,6 +250,8 @@ struct iwl_rxq {
   struct napi_struct napi;  // TODO(43218): replace with something like mvmvif so that when
                             //              packet is received we know where to dispatch.
   struct iwl_rx_mem_buffer* queue[RX_QUEUE_SIZE];
+  struct iwl_trans_pcie* trans_pcie;
+  struct iwl_irq_thread* rx_thread;
 };
 
 struct iwl_dma_ptr {
@@ -268,11 +298,20 @@ struct iwl_cmd_meta {
   struct iwl_host_cmd* source;
   uint32_t flags;
   uint32_t tbs;
+  /* when the command or frame was queued, for the latency statistics */
+  zx_time_t enqueue_time;
+  /* only for ASYNC commands, called when the response arrives */
+  iwl_hcmd_complete_t complete;
+  void* complete_ctx;
 };
 
 #define TFD_TX_CMD_SLOTS 256
 #define TFD_CMD_SLOTS 32
 
+// The size of each buffer in the per-TXQ data slab.  Frames whose header and payload do not fit
+// fall back to a dedicated allocation.
+#define IWL_TX_SLAB_DATA_BUF_SIZE 2048
+
 /*
  * The FH will write back to the first TB only, so we need to copy some data
  * into the buffer regardless of whether it should be mapped or not.
@@ -321,6 +360,15 @@ typedef void(iwlwifi_timer_callback_t)(void* data);
  * @id: queue id
  * @low_mark: low watermark, resume queue if free space more than this
  * @high_mark: high watermark, stop queue if free space less than this
+ * @cmd_pool: slab for the TX commands (data queues only, allocated while the
+ *  queue is enabled)
+ * @data_pool: slab for the frame payloads (data queues only, allocated while
+ *  the queue is enabled)
+ * @slab_exhausted: number of times a slab was empty and a buffer had to be
+ *  allocated on the TX path
+ * @batch_len: number of TFDs filled since the write pointer was last
+ *  published to the device (see iwl_pcie_txq_batch_add())
+ * @batch_timer: publishes a partial batch once the batching deadline passes
  *
  * A Tx queue consists of circular buffer of BDs (a.k.a. TFDs, transmit frame
  * descriptors) and required locking structures.
@@ -361,6 +409,13 @@ struct iwl_txq {
   uint32_t id;
   int low_mark;
   int high_mark;
+
+  struct iwl_iobuf_pool* cmd_pool;
+  struct iwl_iobuf_pool* data_pool;
+  size_t slab_exhausted;
+
+  int batch_len;
+  struct iwl_irq_timer* batch_timer;
 };
 
 static inline dma_addr_t iwl_pcie_get_first_tb_dma(struct iwl_txq* txq, int idx) {
@@ -472,6 +527,9 @@ struct cont_rec {
  * @mmio: PCI memory mapped IO
  * @ucode_write_complete: indicates that the ucode has been copied.
  * @ucode_write_waitq: wait queue for uCode load
+ * @fw_staging: buffers the firmware chunks are copied to for the FH DMA. They
+ *  are allocated with the transport and reused for every firmware load.
+ * @fw_load_stats: timing of the last firmware load
  * @cmd_queue - command queue number
  * @def_rx_queue - default rx queue number
  * @rx_buf_size: Rx buffer size
@@ -479,6 +537,11 @@ struct cont_rec {
  * @scd_set_active: should the transport configure the SCD for HCMD queue
  * @sw_csum_tx: if true, then the transport will compute the csum of the TXed
  *  frame.
+ * @tx_batch_size: max number of data frames queued before the write pointer
+ *  is published to the device. 0 or 1 rings the doorbell for every frame.
+ * @tx_batch_timeout: max time a queued data frame waits for its doorbell
+ * @rx_queue_threads: if true, the RSS RX queues get their own threads when
+ *  they are allocated, see iwl_pcie_rx_alloc().
  * @rx_page_order: page order for receive buffer size
  * @reg_lock: protect hw register access
  * @mutex: to protect stop_device / start_fw / start_hw
@@ -551,6 +614,8 @@ struct iwl_trans_pcie {
 
   bool ucode_write_complete;
   sync_completion_t ucode_write_waitq;
+  struct iwl_iobuf* fw_staging[IWL_PCIE_FW_STAGING_BUFS];
+  struct iwl_pcie_fw_load_stats fw_load_stats;
   sync_completion_t wait_command_queue;
 #if 0   // NEEDS_PORTING
     wait_queue_head_t d0i3_waitq;
@@ -572,6 +637,9 @@ struct iwl_trans_pcie {
   bool scd_set_active;
   bool sw_csum_tx;
   bool pcie_dbg_dumped_once;
+  int tx_batch_size;
+  zx_duration_t tx_batch_timeout;
+  bool rx_queue_threads;
   uint32_t rx_page_order;
 
   /*protect hw register */
@@ -645,6 +713,7 @@ irqreturn_t iwl_pcie_irq_rx_msix_handler(int irq, void* dev_id);
 #endif  // NEEDS_PORTING
 int iwl_pcie_rx_stop(struct iwl_trans* trans);
 void iwl_pcie_rx_free(struct iwl_trans* trans);
+void iwl_pcie_rx_sync_threads(struct iwl_trans* trans);
 int iwl_pcie_dummy_napi_poll(struct napi_struct* napi, int budget);
 
 /*****************************************************
@@ -658,6 +727,16 @@ void iwl_pcie_disable_ict(struct iwl_trans* trans);
 // Exposed for tests only.
 uint32_t iwl_pcie_int_cause_ict(struct iwl_trans* trans);
 
+/*****************************************************
+ * Firmware load
+ ******************************************************/
+zx_status_t iwl_pcie_alloc_fw_staging(struct iwl_trans* trans);
+void iwl_pcie_free_fw_staging(struct iwl_trans* trans);
+
+// Exposed for tests only.
+zx_status_t iwl_pcie_load_section(struct iwl_trans* trans, uint8_t section_num,
+                                  const struct fw_desc* section);
+
 /*****************************************************
  * TX / HCMD
  ******************************************************/
@@ -674,6 +753,7 @@ void iwl_trans_pcie_log_scd_error(struct iwl_trans* trans, struct iwl_txq* txq);
 zx_status_t iwl_trans_pcie_tx(struct iwl_trans* trans, struct ieee80211_mac_packet* pkt,
                               const struct iwl_device_cmd* dev_cmd, int txq_id);
 void iwl_pcie_txq_check_wrptrs(struct iwl_trans* trans);
+void iwl_pcie_txq_batch_flush(struct iwl_trans* trans, struct iwl_txq* txq);
 zx_status_t iwl_trans_pcie_send_hcmd(struct iwl_trans* trans, struct iwl_host_cmd* cmd);
 zx_status_t iwl_pcie_cmdq_reclaim(struct iwl_trans* trans, int txq_id, uint32_t idx);
 void iwl_pcie_gen2_txq_inc_wr_ptr(struct iwl_trans* trans, struct iwl_txq* txq);
@@ -35,7 +35,9 @@
  *****************************************************************************/
 #include <lib/ddk/io-buffer.h>
 #include <lib/sync/condition.h>
+#include <stdio.h>
 #include <zircon/assert.h>
+#include <zircon/status.h>
 #include <zircon/time.h>
 
 #if 0  // NEEDS_PORTING
@@ -181,19 +183,26 @@ static inline __le32 iwl_pcie_dma_addr2rbd_ptr(dma_addr_t dma_addr) {
  * iwl_pcie_rx_stop - stops the Rx DMA
  */
 int iwl_pcie_rx_stop(struct iwl_trans* trans) {
+  int ret;
+
   if (trans->cfg->device_family >= IWL_DEVICE_FAMILY_22560) {
     /* TODO: remove this for 22560 once fw does it */
     iwl_write_prph(trans, RFH_RXF_DMA_CFG_GEN3, 0);
-    return iwl_poll_prph_bit(trans, RFH_GEN_STATUS_GEN3, RXF_DMA_IDLE, RXF_DMA_IDLE, ZX_MSEC(1),
-                             NULL);
+    ret = iwl_poll_prph_bit(trans, RFH_GEN_STATUS_GEN3, RXF_DMA_IDLE, RXF_DMA_IDLE, ZX_MSEC(1),
+                            NULL);
   } else if (trans->cfg->mq_rx_supported) {
     iwl_write_prph(trans, RFH_RXF_DMA_CFG, 0);
-    return iwl_poll_prph_bit(trans, RFH_GEN_STATUS, RXF_DMA_IDLE, RXF_DMA_IDLE, ZX_MSEC(1), NULL);
+    ret = iwl_poll_prph_bit(trans, RFH_GEN_STATUS, RXF_DMA_IDLE, RXF_DMA_IDLE, ZX_MSEC(1), NULL);
   } else {
     iwl_write_direct32(trans, FH_MEM_RCSR_CHNL0_CONFIG_REG, 0);
-    return iwl_poll_direct_bit(trans, FH_MEM_RSSR_RX_STATUS_REG, FH_RSSR_CHNL0_RX_STATUS_CHNL_IDLE,
-                               ZX_MSEC(1), NULL);
+    ret = iwl_poll_direct_bit(trans, FH_MEM_RSSR_RX_STATUS_REG, FH_RSSR_CHNL0_RX_STATUS_CHNL_IDLE,
+                              ZX_MSEC(1), NULL);
   }
+
+  /* Let the RX threads finish with whatever the device delivered before it stopped. */
+  iwl_pcie_rx_sync_threads(trans);
+
+  return ret;
 }
 
 /*
@@ -510,6 +519,46 @@ err:
   return status;
 }
 
+static void iwl_pcie_rx_thread(void* data);
+
+/*
+ * iwl_pcie_rx_release_threads - join and free the RX threads that were created
+ */
+static void iwl_pcie_rx_release_threads(struct iwl_trans* trans) {
+  struct iwl_trans_pcie* trans_pcie = IWL_TRANS_GET_PCIE_TRANS(trans);
+
+  for (int i = 0; i < trans->num_rx_queues; i++) {
+    struct iwl_rxq* rxq = &trans_pcie->rxq[i];
+
+    if (rxq->rx_thread) {
+      iwl_irq_thread_release_sync(rxq->rx_thread);
+      rxq->rx_thread = NULL;
+    }
+  }
+}
+
+/*
+ * iwl_pcie_rx_sync_threads - wait for the RX threads to be done with the work they were woken for
+ *
+ * The threads stay alive; this only guarantees that none of them is still touching an RB that was
+ * handed to it before the call.
+ */
+void iwl_pcie_rx_sync_threads(struct iwl_trans* trans) {
+  struct iwl_trans_pcie* trans_pcie = IWL_TRANS_GET_PCIE_TRANS(trans);
+
+  if (!trans_pcie->rxq) {
+    return;
+  }
+
+  for (int i = 0; i < trans->num_rx_queues; i++) {
+    struct iwl_rxq* rxq = &trans_pcie->rxq[i];
+
+    if (rxq->rx_thread) {
+      iwl_irq_thread_sync(rxq->rx_thread);
+    }
+  }
+}
+
 zx_status_t iwl_pcie_rx_alloc(struct iwl_trans* trans) {
   struct iwl_trans_pcie* trans_pcie = IWL_TRANS_GET_PCIE_TRANS(trans);
 
@@ -527,8 +576,29 @@ zx_status_t iwl_pcie_rx_alloc(struct iwl_trans* trans) {
 
     zx_status_t status = iwl_pcie_alloc_rxq_dma(trans, rxq);
     if (status != ZX_OK) {
+      iwl_pcie_rx_release_threads(trans);
       return status;
     }
+    rxq->trans_pcie = trans_pcie;
+
+    /*
+     * Each RSS queue gets its own thread, so that the queues are processed in parallel rather than
+     * serialized behind the interrupt thread.
+     */
+    if (i > 0 && trans_pcie->rx_queue_threads) {
+      char name[ZX_MAX_NAME_LEN];
+      char role[64];
+      snprintf(name, sizeof(name), "iwlwifi-rx-worker-%d", i);
+      snprintf(role, sizeof(role), "fuchsia.devices.wlan.drivers.iwlwifi.rx.%d", i);
+      status = iwl_irq_thread_create(trans->dev, name, role, iwl_pcie_rx_thread, rxq,
+                                     &rxq->rx_thread);
+      if (status != ZX_OK) {
+        IWL_ERR(trans, "Failed to create RX thread for queue %d: %s\n", i,
+                zx_status_get_string(status));
+        iwl_pcie_rx_release_threads(trans);
+        return status;
+      }
+    }
   }
   return ZX_OK;
 }
@@ -702,6 +772,9 @@ zx_status_t _iwl_pcie_rx_init(struct iwl_trans* trans) {
   }
   def_rxq = trans_pcie->rxq;
 
+  /* On a re-init, the RX threads may still be handling RBs of the previous run. */
+  iwl_pcie_rx_sync_threads(trans);
+
   /* free all first - we might be reconfigured for a different size */
   iwl_pcie_free_rbs_pool(trans);
 
@@ -815,6 +888,9 @@ void iwl_pcie_rx_free(struct iwl_trans* trans) {
     return;
   }
 
+  /* Stop the RX threads first, as they may still be touching the RBs. */
+  iwl_pcie_rx_release_threads(trans);
+
   iwl_pcie_free_rbs_pool(trans);
 
   for (int i = 0; i < trans->num_rx_queues; i++) {
@@ -993,6 +1069,7 @@ static void iwl_pcie_rx_handle(struct iwl_trans* trans, int queue) {
   struct iwl_trans_pcie* trans_pcie = IWL_TRANS_GET_PCIE_TRANS(trans);
   struct iwl_rxq* rxq = &trans_pcie->rxq[queue];
   uint32_t r, i;
+  uint32_t count = 0;
 
   mtx_lock(&rxq->lock);
   /* uCode's read index (stored in shared DRAM) indicates the last Rx
@@ -1019,6 +1096,7 @@ static void iwl_pcie_rx_handle(struct iwl_trans* trans, int queue) {
     }
 
     iwl_pcie_rx_handle_rb(trans, rxq, rxb, i);
+    count++;
 
     i = (i + 1) & (rxq->queue_size - 1);
   }
@@ -1034,6 +1112,8 @@ static void iwl_pcie_rx_handle(struct iwl_trans* trans, int queue) {
 #endif  // NEEDS_PORTING
   mtx_unlock(&rxq->lock);
 
+  iwl_stats_hist_add(IWL_STATS_HIST_RX_BATCH, count);
+
 #if 0   // NEEDS_PORTING
   if (rxq->napi.poll) {
     napi_gro_flush(&rxq->napi, false);
@@ -1043,6 +1123,28 @@ static void iwl_pcie_rx_handle(struct iwl_trans* trans, int queue) {
   iwl_pcie_rxq_restock(trans, rxq);
 }
 
+/*
+ * iwl_pcie_rx_thread - RX thread entry function for an RSS queue
+ */
+static void iwl_pcie_rx_thread(void* data) {
+  struct iwl_rxq* rxq = data;
+
+  iwl_pcie_rx_handle(iwl_trans_pcie_get_trans(rxq->trans_pcie), rxq->id);
+}
+
+/*
+ * iwl_pcie_rx_schedule - process an RX queue, on its own thread if it has one
+ */
+static void iwl_pcie_rx_schedule(struct iwl_trans* trans, int queue) {
+  struct iwl_trans_pcie* trans_pcie = IWL_TRANS_GET_PCIE_TRANS(trans);
+  struct iwl_rxq* rxq = &trans_pcie->rxq[queue];
+
+  if (rxq->rx_thread && iwl_irq_thread_wake(rxq->rx_thread) == ZX_OK) {
+    return;
+  }
+  iwl_pcie_rx_handle(trans, queue);
+}
+
 #if 0   // NEEDS_PORTING
 static struct iwl_trans_pcie* iwl_pcie_get_trans_pcie(struct msix_entry* entry) {
   uint8_t queue = entry->entry;
@@ -1069,7 +1171,7 @@ irqreturn_t iwl_pcie_irq_rx_msix_handler(int irq, void* dev_id) {
   lock_map_acquire(&trans->sync_cmd_lockdep_map);
 
   local_bh_disable();
-  iwl_pcie_rx_handle(trans, entry->entry);
+  iwl_pcie_rx_schedule(trans, entry->entry);
   local_bh_enable();
 
   iwl_pcie_clear_irq(trans, entry);
@@ -1442,6 +1544,10 @@ zx_status_t iwl_pcie_isr(struct iwl_trans* trans) {
     isr_stats->rx++;
 
     iwl_pcie_rx_handle(trans, 0);
+    /* Without MSI-X there is a single interrupt for all the RX queues. */
+    for (int i = 1; i < trans->num_rx_queues; i++) {
+      iwl_pcie_rx_schedule(trans, i);
+    }
   }
 
   /* This "Tx" DMA channel is used only for loading uCode */
@@ -1601,7 +1707,7 @@ irqreturn_t iwl_pcie_irq_msix_handler(int irq, void* dev_id) {
 
   if ((trans_pcie->shared_vec_mask & IWL_SHARED_IRQ_FIRST_RSS) && inta_fh & MSIX_FH_INT_CAUSES_Q1) {
     local_bh_disable();
-    iwl_pcie_rx_handle(trans, 1);
+    iwl_pcie_rx_schedule(trans, 1);
     local_bh_enable();
   }
 
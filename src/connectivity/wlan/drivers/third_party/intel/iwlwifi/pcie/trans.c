@@ -651,11 +651,11 @@ static void iwl_pcie_load_firmware_chunk_fh(struct iwl_trans* trans, uint32_t ds
                   FH_TCSR_TX_CONFIG_REG_VAL_CIRQ_HOST_ENDTFD);
 }
 
-static zx_status_t iwl_pcie_load_firmware_chunk(struct iwl_trans* trans, uint32_t dst_addr,
-                                                zx_paddr_t phy_addr, uint32_t byte_cnt) {
+// Start the FH DMA of a firmware chunk. iwl_pcie_wait_firmware_chunk() waits for its completion.
+static zx_status_t iwl_pcie_start_firmware_chunk(struct iwl_trans* trans, uint32_t dst_addr,
+                                                 zx_paddr_t phy_addr, uint32_t byte_cnt) {
   struct iwl_trans_pcie* trans_pcie = IWL_TRANS_GET_PCIE_TRANS(trans);
   unsigned long flags;
-  int ret;
 
   trans_pcie->ucode_write_complete = false;
 
@@ -666,7 +666,16 @@ static zx_status_t iwl_pcie_load_firmware_chunk(struct iwl_trans* trans, uint32_
   iwl_pcie_load_firmware_chunk_fh(trans, dst_addr, phy_addr, byte_cnt);
   iwl_trans_release_nic_access(trans, &flags);
 
+  return ZX_OK;
+}
+
+static zx_status_t iwl_pcie_wait_firmware_chunk(struct iwl_trans* trans) {
+  struct iwl_trans_pcie* trans_pcie = IWL_TRANS_GET_PCIE_TRANS(trans);
+  zx_time_t start = zx_clock_get_monotonic();
+  zx_status_t ret;
+
   ret = sync_completion_wait(&trans_pcie->ucode_write_waitq, ZX_SEC(5));
+  trans_pcie->fw_load_stats.dma_wait += zx_clock_get_monotonic() - start;
   if (ret != ZX_OK) {
     IWL_ERR(trans, "Failed to load firmware chunk!\n");
     iwl_trans_pcie_dump_regs(trans);
@@ -677,46 +686,90 @@ static zx_status_t iwl_pcie_load_firmware_chunk(struct iwl_trans* trans, uint32_
   return ZX_OK;
 }
 
-static zx_status_t iwl_pcie_load_section(struct iwl_trans* trans, uint8_t section_num,
-                                         const struct fw_desc* section) {
+// Copy a firmware chunk to a staging buffer, for the hardware to fetch.
+static zx_status_t iwl_pcie_stage_firmware_chunk(struct iwl_trans* trans, struct iwl_iobuf* buf,
+                                                 const void* data, uint32_t len) {
+  struct iwl_trans_pcie* trans_pcie = IWL_TRANS_GET_PCIE_TRANS(trans);
+  zx_time_t start = zx_clock_get_monotonic();
+  zx_status_t ret;
+
+  memcpy(iwl_iobuf_virtual(buf), data, len);
+  ret = iwl_iobuf_cache_flush(buf, 0, len);
+  trans_pcie->fw_load_stats.copy += zx_clock_get_monotonic() - start;
+
+  return ret;
+}
+
+zx_status_t iwl_pcie_alloc_fw_staging(struct iwl_trans* trans) {
+  struct iwl_trans_pcie* trans_pcie = IWL_TRANS_GET_PCIE_TRANS(trans);
+  zx_status_t ret;
+
+  for (size_t i = 0; i < ARRAY_SIZE(trans_pcie->fw_staging); i++) {
+    if (trans_pcie->fw_staging[i]) {
+      continue;
+    }
+    ret = iwl_iobuf_allocate_contiguous(&trans_pcie->pci_dev->dev, FH_MEM_TB_MAX_LENGTH,
+                                        &trans_pcie->fw_staging[i]);
+    if (ret != ZX_OK) {
+      IWL_ERR(trans, "Failed to allocate the firmware staging buffers: %s\n",
+              zx_status_get_string(ret));
+      iwl_pcie_free_fw_staging(trans);
+      return ret;
+    }
+  }
+
+  return ZX_OK;
+}
+
+void iwl_pcie_free_fw_staging(struct iwl_trans* trans) {
+  struct iwl_trans_pcie* trans_pcie = IWL_TRANS_GET_PCIE_TRANS(trans);
+
+  for (size_t i = 0; i < ARRAY_SIZE(trans_pcie->fw_staging); i++) {
+    if (trans_pcie->fw_staging[i]) {
+      iwl_iobuf_release(trans_pcie->fw_staging[i]);
+      trans_pcie->fw_staging[i] = NULL;
+    }
+  }
+}
+
+zx_status_t iwl_pcie_load_section(struct iwl_trans* trans, uint8_t section_num,
+                                  const struct fw_desc* section) {
   struct iwl_trans_pcie* trans_pcie = IWL_TRANS_GET_PCIE_TRANS(trans);
-  zx_handle_t vmo;
+  struct iwl_pcie_fw_load_stats* stats = &trans_pcie->fw_load_stats;
+  const uint8_t* data = section->data;
   uint32_t offset, chunk_sz = min_t(uint32_t, FH_MEM_TB_MAX_LENGTH, section->len);
+  size_t cur = 0;
   zx_status_t ret = ZX_OK;
 
   IWL_DEBUG_FW(trans, "[%d] uCode section being loaded...\n", section_num);
 
   // The way the ucode download process works is that:
   //
-  //   1. The driver copies the ucode to a uncached VMO space.
+  //   1. The driver copies a chunk of the ucode to a pinned staging buffer.
   //   2. Tell the hardware DMA where to copy (from p_addr).
   //   3. The hardware copies to its own internal memory.
   //   4. Then hardware notifies the driver that the copy is done.
   //
-
-  // Allocate a VMO space.
-  size_t vmo_size = ROUND_UP(chunk_sz, ZX_PAGE_SIZE);
-  ret =
-      zx_vmo_create_contiguous(trans_pcie->pci_dev->dev.bti, vmo_size, /*alignment_log2*/ 0, &vmo);
-  if (ret != ZX_OK) {
-    goto out;
+  // The staging buffers are allocated once with the transport, and reused for every section and
+  // every firmware load. While the hardware copies a chunk from one of them, the driver copies the
+  // next chunk to the other one.
+  //
+  if (WARN_ON(!trans_pcie->fw_staging[0])) {
+    return ZX_ERR_BAD_STATE;
   }
 
-  // Map the virtual address to physical address.
-  zx_handle_t pmt;  // Pinned Memory Token -- for unpin.
-  zx_paddr_t p_addr;
-  ret = zx_bti_pin(trans_pcie->pci_dev->dev.bti, ZX_BTI_PERM_READ | ZX_BTI_CONTIGUOUS, vmo,
-                   /*offset*/ 0, vmo_size, &p_addr, /* addrs_count */ 1, &pmt);
+  ret = iwl_pcie_stage_firmware_chunk(trans, trans_pcie->fw_staging[cur], data, chunk_sz);
   if (ret != ZX_OK) {
-    goto out;
+    return ret;
   }
 
   for (offset = 0; offset < section->len; offset += chunk_sz) {
-    uint32_t copy_size, dst_addr;
+    uint32_t copy_size, dst_addr, next_offset;
     bool extended_addr = false;
 
     copy_size = min_t(uint32_t, chunk_sz, section->len - offset);
     dst_addr = section->offset + offset;
+    next_offset = offset + chunk_sz;
 
     if (dst_addr >= IWL_FW_MEM_EXTENDED_START && dst_addr <= IWL_FW_MEM_EXTENDED_END) {
       extended_addr = true;
@@ -726,20 +779,30 @@ static zx_status_t iwl_pcie_load_section(struct iwl_trans* trans, uint8_t sectio
       iwl_set_bits_prph(trans, LMPM_CHICK, LMPM_CHICK_EXTENDED_ADDR_SPACE);
     }
 
-    // Copy data to VMO for hardware to fetch.
-    ret = zx_vmo_write(vmo, section->data + offset, 0, copy_size);
-    if (ret != ZX_OK) {
-      goto ext_clear;
+    // Tell hardware to fetch.
+    ret = iwl_pcie_start_firmware_chunk(trans, dst_addr,
+                                        iwl_iobuf_physical(trans_pcie->fw_staging[cur]), copy_size);
+    if (ret == ZX_OK) {
+      // Stage the next chunk while the hardware fetches this one. Whatever happens, wait for the
+      // fetch before touching the buffer it reads from.
+      cur = (cur + 1) % ARRAY_SIZE(trans_pcie->fw_staging);
+      if (next_offset < section->len) {
+        ret = iwl_pcie_stage_firmware_chunk(trans, trans_pcie->fw_staging[cur], data + next_offset,
+                                            min_t(uint32_t, chunk_sz, section->len - next_offset));
+      }
+      zx_status_t wait_ret = iwl_pcie_wait_firmware_chunk(trans);
+      if (ret == ZX_OK) {
+        ret = wait_ret;
+      }
     }
 
-    // Tell hardware to fetch.
-    ret = iwl_pcie_load_firmware_chunk(trans, dst_addr, p_addr, copy_size);
     if (ret != ZX_OK) {
       IWL_ERR(trans, "Could not load the [%d] uCode section\n", section_num);
-      goto ext_clear;
+    } else {
+      stats->bytes += copy_size;
+      stats->chunks++;
     }
 
-  ext_clear:
     if (extended_addr) {
       iwl_clear_bits_prph(trans, LMPM_CHICK, LMPM_CHICK_EXTENDED_ADDR_SPACE);
     }
@@ -750,13 +813,6 @@ static zx_status_t iwl_pcie_load_section(struct iwl_trans* trans, uint8_t sectio
     }
   }
 
-  zx_status_t unpin_ret = zx_pmt_unpin(pmt);
-  if (unpin_ret != ZX_OK) {
-    IWL_ERR(trans, "Could not unpin PMT: %s\n", zx_status_get_string(unpin_ret));
-  }
-
-out:
-  zx_handle_close(vmo);
   return ret;
 }
 
@@ -1307,6 +1363,8 @@ void iwl_pcie_synchronize_irqs(struct iwl_trans* trans) {
 static zx_status_t iwl_trans_pcie_start_fw(struct iwl_trans* trans, const struct fw_img* fw,
                                            bool run_in_rfkill) {
   struct iwl_trans_pcie* trans_pcie = IWL_TRANS_GET_PCIE_TRANS(trans);
+  struct iwl_pcie_fw_load_stats* stats = &trans_pcie->fw_load_stats;
+  zx_time_t start;
   bool hw_rfkill;
   zx_status_t ret;
 
@@ -1355,7 +1413,10 @@ static zx_status_t iwl_trans_pcie_start_fw(struct iwl_trans* trans, const struct
   /* clear (again), then enable host interrupts */
   iwl_write32(trans, CSR_INT, 0xFFFFFFFF);
 
+  memset(stats, 0, sizeof(*stats));
+  start = zx_clock_get_monotonic();
   ret = iwl_pcie_nic_init(trans);
+  stats->nic_init = zx_clock_get_monotonic() - start;
   if (ret != ZX_OK) {
     IWL_ERR(trans, "Unable to init nic: %s\n", zx_status_get_string(ret));
     goto out;
@@ -1375,11 +1436,20 @@ static zx_status_t iwl_trans_pcie_start_fw(struct iwl_trans* trans, const struct
   iwl_write32(trans, CSR_UCODE_DRV_GP1_CLR, CSR_UCODE_SW_BIT_RFKILL);
 
   /* Load the given image to the HW */
+  start = zx_clock_get_monotonic();
   if (trans->cfg->device_family >= IWL_DEVICE_FAMILY_8000) {
     ret = iwl_pcie_load_given_ucode_8000(trans, fw);
   } else {
     ret = iwl_pcie_load_given_ucode(trans, fw);
   }
+  stats->total = zx_clock_get_monotonic() - start;
+  if (ret == ZX_OK) {
+    IWL_INFO(trans,
+             "Loaded %zu bytes of firmware in %zu chunks: %ld us (nic init %ld us, copy %ld us, "
+             "DMA wait %ld us)\n",
+             stats->bytes, stats->chunks, stats->total / 1000, stats->nic_init / 1000,
+             stats->copy / 1000, stats->dma_wait / 1000);
+  }
 
   /* re-check RF-Kill state since we may have missed the interrupt */
   hw_rfkill = iwl_pcie_check_hw_rf_kill(trans);
@@ -1811,6 +1881,9 @@ static void iwl_trans_pcie_configure(struct iwl_trans* trans,
   trans_pcie->bc_table_dword = trans_cfg->bc_table_dword;
   trans_pcie->scd_set_active = trans_cfg->scd_set_active;
   trans_pcie->sw_csum_tx = trans_cfg->sw_csum_tx;
+  trans_pcie->tx_batch_size = trans_cfg->tx_batch_size;
+  trans_pcie->tx_batch_timeout = trans_cfg->tx_batch_timeout;
+  trans_pcie->rx_queue_threads = trans_cfg->rx_queue_threads;
 
   trans_pcie->page_offs = trans_cfg->cb_data_offs;
   trans_pcie->dev_cmd_offs = trans_cfg->cb_data_offs + sizeof(void*);
@@ -1861,7 +1934,11 @@ void iwl_trans_pcie_free(struct iwl_trans* trans) {
 
 #if 0   // NEEDS_PORTING
     }
+#endif  // NEEDS_PORTING
 
+  iwl_pcie_free_fw_staging(trans);
+
+#if 0   // NEEDS_PORTING
     iwl_pcie_free_fw_monitor(trans);
 
     for_each_possible_cpu(i) {
@@ -3409,6 +3486,11 @@ struct iwl_trans* iwl_trans_pcie_alloc(struct iwl_pci_dev* pdev,
     init_waitqueue_head(&trans_pcie->d0i3_waitq);
 #endif  // NEEDS_PORTING
 
+  status = iwl_pcie_alloc_fw_staging(trans);
+  if (status != ZX_OK) {
+    goto out_no_pci;
+  }
+
   if (trans_pcie->msix_enabled) {
     IWL_ERR(trans, "MSIX is not supported\n");
 #if 0   // NEEDS_PORTING
@@ -3418,7 +3500,7 @@ struct iwl_trans* iwl_trans_pcie_alloc(struct iwl_pci_dev* pdev,
   } else {
     status = iwl_pcie_alloc_ict(trans);
     if (status != ZX_OK) {
-      goto out_no_pci;
+      goto out_free_fw_staging;
     }
 
     int ret =
@@ -3446,6 +3528,8 @@ struct iwl_trans* iwl_trans_pcie_alloc(struct iwl_pci_dev* pdev,
 
 out_free_ict:
   iwl_pcie_free_ict(trans);
+out_free_fw_staging:
+  iwl_pcie_free_fw_staging(trans);
 out_no_pci:
 #if 0   // NEEDS_PORTING
     free_percpu(trans_pcie->tso_hdr_page);
@@ -53,6 +53,7 @@
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/pcie/internal.h"
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/ieee80211.h"
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/stats.h"
+#include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/time.h"
 
 #define IWL_TX_CRC_SIZE 4
 #define IWL_TX_DELIMITER_SIZE 4
@@ -155,6 +156,87 @@ void iwl_pcie_free_dma_ptr(struct iwl_trans* trans, struct iwl_dma_ptr* ptr) {
   ptr->io_buf = NULL;
 }
 
+// Get a DMA buffer of at least 'size' bytes for a data frame on 'txq'.
+//
+// The buffer is taken from 'pool' if it fits. Otherwise, or if the pool is exhausted, a dedicated
+// buffer is allocated. Either way the buffer is given back with iwl_iobuf_release().
+//
+static zx_status_t iwl_pcie_txq_get_buf(struct iwl_trans* trans, struct iwl_txq* txq,
+                                        struct iwl_iobuf_pool* pool, size_t size,
+                                        struct iwl_iobuf** out_iobuf) {
+  iwl_assert_lock_held(&txq->lock);
+
+  if (pool && size <= iwl_iobuf_pool_buf_size(pool)) {
+    if (iwl_iobuf_pool_acquire(pool, out_iobuf) == ZX_OK) {
+      return ZX_OK;
+    }
+    txq->slab_exhausted++;
+    iwl_stats_inc(IWL_STATS_CNT_TX_SLAB_EXHAUSTED);
+    IWL_DEBUG_TX(trans, "Q %d slab exhausted (%zu times)\n", txq->id, txq->slab_exhausted);
+  }
+
+  struct iwl_trans_pcie* trans_pcie = IWL_TRANS_GET_PCIE_TRANS(trans);
+  return iwl_iobuf_allocate_contiguous(&trans_pcie->pci_dev->dev, size, out_iobuf);
+}
+
+// Data queues carve the per-frame TX command and payload buffers out of pre-allocated slabs, so
+// that iwl_trans_pcie_tx() and iwl_trans_pcie_reclaim() do not need to allocate and pin memory.
+//
+// The slabs are sized by the number of slots of the queue, and are only allocated while the queue
+// is enabled: most of the data queues are never used, and allocating the slabs for all of them up
+// front would pin several megabytes of memory.
+//
+// A failure is not fatal: iwl_pcie_txq_get_buf() falls back to dedicated allocations.
+static zx_status_t iwl_pcie_txq_alloc_slabs(struct iwl_trans* trans, struct iwl_txq* txq) {
+  struct iwl_trans_pcie* trans_pcie = IWL_TRANS_GET_PCIE_TRANS(trans);
+  zx_status_t status;
+
+  if (!txq->cmd_pool) {
+    status = iwl_iobuf_pool_create(&trans_pcie->pci_dev->dev, TB1_MAX_SIZE, txq->n_window,
+                                   &txq->cmd_pool);
+    if (status != ZX_OK) {
+      return status;
+    }
+  }
+  if (!txq->data_pool) {
+    status = iwl_iobuf_pool_create(&trans_pcie->pci_dev->dev, IWL_TX_SLAB_DATA_BUF_SIZE,
+                                   txq->n_window, &txq->data_pool);
+    if (status != ZX_OK) {
+      return status;
+    }
+  }
+
+  return ZX_OK;
+}
+
+// All the buffers taken from the slabs must have been given back, see iwl_pcie_txq_unmap().
+static void iwl_pcie_txq_free_slabs(struct iwl_txq* txq) {
+  if (txq->data_pool) {
+    iwl_iobuf_pool_destroy(txq->data_pool);
+    txq->data_pool = NULL;
+  }
+  if (txq->cmd_pool) {
+    iwl_iobuf_pool_destroy(txq->cmd_pool);
+    txq->cmd_pool = NULL;
+  }
+}
+
+// Give back the command and payload buffers of the data frame in txq->entries[idx].
+static void iwl_pcie_txq_put_bufs(struct iwl_txq* txq, int idx) {
+  struct iwl_pcie_txq_entry* entry = &txq->entries[idx];
+
+  iwl_assert_lock_held(&txq->lock);
+
+  if (entry->cmd) {
+    iwl_iobuf_release(entry->cmd);
+    entry->cmd = NULL;
+  }
+  if (entry->dup_io_buf) {
+    iwl_iobuf_release(entry->dup_io_buf);
+    entry->dup_io_buf = NULL;
+  }
+}
+
 static void iwl_pcie_txq_stuck_timer(void* data) {
   struct iwl_txq* txq = data;
 
@@ -320,6 +402,63 @@ void iwl_pcie_txq_check_wrptrs(struct iwl_trans* trans) {
   }
 }
 
+/*
+ * iwl_pcie_txq_batch_flush_locked - Publish the TFDs queued since the last doorbell
+ */
+static void iwl_pcie_txq_batch_flush_locked(struct iwl_trans* trans, struct iwl_txq* txq) {
+  iwl_assert_lock_held(&txq->lock);
+
+  if (!txq->batch_len) {
+    return;
+  }
+
+  txq->batch_len = 0;
+  if (txq->batch_timer) {
+    iwl_irq_timer_stop(txq->batch_timer);
+  }
+  iwl_pcie_txq_inc_wr_ptr(trans, txq);
+}
+
+void iwl_pcie_txq_batch_flush(struct iwl_trans* trans, struct iwl_txq* txq) {
+  mtx_lock(&txq->lock);
+  iwl_pcie_txq_batch_flush_locked(trans, txq);
+  mtx_unlock(&txq->lock);
+}
+
+static void iwl_pcie_txq_batch_timer(void* data) {
+  struct iwl_txq* txq = data;
+
+  iwl_pcie_txq_batch_flush(iwl_trans_pcie_get_trans(txq->trans_pcie), txq);
+}
+
+/*
+ * iwl_pcie_txq_batch_add - Account for a newly filled TFD
+ *
+ * The write pointer is only published to the device once 'tx_batch_size' TFDs are pending, when
+ * the queue is about to be stopped, or when 'batch_timer' fires, whichever comes first. This
+ * replaces one MMIO doorbell write per frame with one per batch.
+ *
+ * A frame put on an idle queue is published right away: the device has nothing else to work on,
+ * so holding the frame back would only add the batching deadline to its latency. Batching thus
+ * only kicks in while the device is busy with earlier frames.
+ */
+static void iwl_pcie_txq_batch_add(struct iwl_trans* trans, struct iwl_txq* txq) {
+  struct iwl_trans_pcie* trans_pcie = IWL_TRANS_GET_PCIE_TRANS(trans);
+
+  iwl_assert_lock_held(&txq->lock);
+
+  txq->batch_len++;
+  bool was_idle =
+      txq->batch_len == 1 &&
+      ((txq->write_ptr - txq->read_ptr) & (trans->cfg->base_params->max_tfd_queue_size - 1)) == 1;
+  if (!txq->batch_timer || was_idle || txq->batch_len >= trans_pcie->tx_batch_size ||
+      iwl_queue_space(trans, txq) < txq->high_mark) {
+    iwl_pcie_txq_batch_flush_locked(trans, txq);
+  } else if (txq->batch_len == 1) {
+    iwl_irq_timer_start(txq->batch_timer, trans_pcie->tx_batch_timeout);
+  }
+}
+
 static inline void iwl_pcie_tfd_set_tb(struct iwl_trans* trans, void* tfd, uint8_t idx,
                                        zx_paddr_t addr, uint16_t len) {
   struct iwl_tfd* tfd_fh = (void*)tfd;
@@ -489,6 +628,18 @@ zx_status_t iwl_pcie_txq_alloc(struct iwl_trans* trans, struct iwl_txq* txq, uin
     goto err_free_tfds;
   }
 
+  // The TX slabs of data queues are only allocated when the queue is enabled, see
+  // iwl_pcie_txq_alloc_slabs().
+  if (!cmd_queue) {
+    status = iwl_irq_timer_create(trans->dev, iwl_pcie_txq_batch_timer, txq, &txq->batch_timer);
+    if (status != ZX_OK) {
+      // Without the timer, iwl_pcie_txq_batch_add() publishes every frame on its own.
+      IWL_WARN(trans, "cannot create the TX batch timer, batching is off: %s\n",
+               zx_status_get_string(status));
+      txq->batch_timer = NULL;
+    }
+  }
+
   return ZX_OK;
 
 err_free_tfds:
@@ -512,6 +663,7 @@ zx_status_t iwl_pcie_txq_init(struct iwl_trans* trans, struct iwl_txq* txq, uint
   uint32_t tfd_queue_max_size = trans->cfg->base_params->max_tfd_queue_size;
 
   txq->need_update = false;
+  txq->batch_len = 0;
 
   // max_tfd_queue_size must be power-of-two size, otherwise iwl_queue_inc_wrap and
   // iwl_queue_dec_wrap are broken.
@@ -593,6 +745,14 @@ void iwl_pcie_txq_unmap(struct iwl_trans* trans, int txq_id) {
 #if 0   // NEEDS_PORTING
             iwl_pcie_free_tso_page(trans_pcie, skb);
 #endif  // NEEDS_PORTING
+      iwl_pcie_txq_put_bufs(txq, iwl_pcie_get_cmd_index(txq, txq->read_ptr));
+    } else {
+      // The response of this command will never arrive.
+      struct iwl_cmd_meta* meta = &txq->entries[iwl_pcie_get_cmd_index(txq, txq->read_ptr)].meta;
+      if (meta->complete) {
+        meta->complete(meta->complete_ctx, ZX_ERR_CANCELED, NULL);
+        meta->complete = NULL;
+      }
     }
     iwl_pcie_txq_free_tfd(trans, txq);
     txq->read_ptr = iwl_queue_inc_wrap(trans, txq->read_ptr);
@@ -608,6 +768,7 @@ void iwl_pcie_txq_unmap(struct iwl_trans* trans, int txq_id) {
       mtx_unlock(&trans_pcie->reg_lock);
     }
   }
+  txq->batch_len = 0;
 
   mtx_unlock(&txq->lock);
 
@@ -646,6 +807,9 @@ static void iwl_pcie_txq_free(struct iwl_trans* trans, int txq_id) {
     }
   }
 
+  /* De-alloc the TX slabs. All buffers were returned in iwl_pcie_txq_unmap(). */
+  iwl_pcie_txq_free_slabs(txq);
+
   /* De-alloc circular buffer of TFDs */
   iwl_iobuf_release(txq->tfds);
   txq->tfds = NULL;
@@ -658,6 +822,8 @@ static void iwl_pcie_txq_free(struct iwl_trans* trans, int txq_id) {
 
   iwl_irq_timer_release_sync(txq->stuck_timer);
   txq->stuck_timer = NULL;
+  iwl_irq_timer_release_sync(txq->batch_timer);
+  txq->batch_timer = NULL;
 
   /* 0-fill queue descriptor structure */
   memset(txq, 0, sizeof(*txq));
@@ -1032,6 +1198,7 @@ void iwl_trans_pcie_reclaim(struct iwl_trans* trans, int txq_id, int ssn) {
     if (WARN_ON(!skb_queue_empty(skbs))) { goto out; }
 #endif  // NEEDS_PORTING
 
+  zx_time_t now = iwl_time_now(trans->dev);
   for (; read_ptr != tfd_num; txq->read_ptr = iwl_queue_inc_wrap(trans, txq->read_ptr),
                               read_ptr = iwl_pcie_get_cmd_index(txq, txq->read_ptr)) {
 #if 0   // NEEDS_PORTING
@@ -1039,12 +1206,9 @@ void iwl_trans_pcie_reclaim(struct iwl_trans* trans, int txq_id, int ssn) {
 #endif  // NEEDS_PORTING
 
     ZX_ASSERT(txq->entries[read_ptr].cmd);
-    iwl_iobuf_release(txq->entries[read_ptr].cmd);
-    txq->entries[read_ptr].cmd = NULL;
-    if (txq->entries[read_ptr].dup_io_buf) {
-      iwl_iobuf_release(txq->entries[read_ptr].dup_io_buf);
-      txq->entries[read_ptr].dup_io_buf = NULL;
-    }
+    iwl_stats_hist_add(IWL_STATS_HIST_TX_LATENCY_US,
+                       zx_time_sub_time(now, txq->entries[read_ptr].meta.enqueue_time) / ZX_USEC(1));
+    iwl_pcie_txq_put_bufs(txq, read_ptr);
 
     iwl_pcie_txq_free_tfd(trans, txq);
   }
@@ -1236,6 +1400,14 @@ bool iwl_trans_pcie_txq_enable(struct iwl_trans* trans, int txq_id, uint16_t ssn
 
   txq->wd_timeout = wdg_timeout;
 
+  if (txq_id != trans_pcie->cmd_queue) {
+    zx_status_t status = iwl_pcie_txq_alloc_slabs(trans, txq);
+    if (status != ZX_OK) {
+      IWL_WARN(trans, "cannot allocate the TX slabs of queue %d: %s\n", txq_id,
+               zx_status_get_string(status));
+    }
+  }
+
   if (cfg) {
     fifo = cfg->fifo;
 
@@ -1370,6 +1542,7 @@ void iwl_trans_pcie_txq_disable(struct iwl_trans* trans, int txq_id, bool config
   }
 
   iwl_pcie_txq_unmap(trans, txq_id);
+  iwl_pcie_txq_free_slabs(trans_pcie->txq[txq_id]);
   trans_pcie->txq[txq_id]->ampdu = false;
 
   IWL_DEBUG_TX_QUEUES(trans, "Deactivate queue %d\n", txq_id);
@@ -1560,9 +1733,12 @@ static zx_status_t iwl_pcie_enqueue_hcmd(struct iwl_trans* trans, struct iwl_hos
   out_meta = &txq->entries[cmd_idx].meta;
 
   memset(out_meta, 0, sizeof(*out_meta)); /* re-initialize to NULL */
+  out_meta->enqueue_time = iwl_time_now(trans->dev);
   if (cmd->flags & CMD_WANT_SKB) {
     out_meta->source = cmd;
   }
+  out_meta->complete = cmd->complete;
+  out_meta->complete_ctx = cmd->complete_ctx;
 
   /* set up the header */
   uint32_t cmd_pos;  // Pointer used with 'out_cmd' to indicate the location for 'next copy data'.
@@ -1773,6 +1949,9 @@ void iwl_pcie_hcmd_complete(struct iwl_trans* trans, struct iwl_rx_cmd_buffer* r
 
   iwl_pcie_tfd_unmap(trans, meta, txq, index);
 
+  iwl_stats_hist_add(IWL_STATS_HIST_HCMD_RTT_US,
+                     zx_time_sub_time(iwl_time_now(trans->dev), meta->enqueue_time) / ZX_USEC(1));
+
   /* Input error checking is done when commands are added to queue. */
   if (meta->flags & CMD_WANT_SKB) {
 #if 0   // NEEDS_PORTING
@@ -1786,6 +1965,11 @@ void iwl_pcie_hcmd_complete(struct iwl_trans* trans, struct iwl_rx_cmd_buffer* r
     iwl_op_mode_async_cb(trans->op_mode, cmd);
   }
 
+  if (meta->complete) {
+    meta->complete(meta->complete_ctx, ZX_OK, pkt);
+    meta->complete = NULL;
+  }
+
   iwl_pcie_cmdq_reclaim(trans, txq_id, index);
 
   if (!(meta->flags & CMD_ASYNC)) {
@@ -1995,12 +2179,10 @@ static zx_status_t iwl_fill_data_tbs(struct iwl_trans* trans, struct ieee80211_m
   uint16_t head_tb_len = pkt->headroom_used_size + pkt->body_size;
 
   if (head_tb_len > 0) {
-    // Allocate the dup_io_buf
+    // Get the dup_io_buf
     struct iwl_iobuf* dup_io_buf = txq->entries[cmd_idx].dup_io_buf;
     ZX_ASSERT(!dup_io_buf);
-    struct iwl_trans_pcie* trans_pcie = IWL_TRANS_GET_PCIE_TRANS(trans);
-    zx_status_t ret =
-        iwl_iobuf_allocate_contiguous(&trans_pcie->pci_dev->dev, head_tb_len, &dup_io_buf);
+    zx_status_t ret = iwl_pcie_txq_get_buf(trans, txq, txq->data_pool, head_tb_len, &dup_io_buf);
     if (ret != ZX_OK) {
       IWL_ERR(trans, "%s(): io_buffer_init() failed: %s\n", __func__, zx_status_get_string(ret));
       return ret;
@@ -2280,8 +2462,8 @@ zx_status_t iwl_trans_pcie_tx(struct iwl_trans* trans, struct ieee80211_mac_pack
   // First copy 'dev_cmd' to 'out_cmd'. This is easier to copy the whole cmd to tb0 and tb1
   // respectively.
   ZX_ASSERT(!txq->entries[cmd_idx].cmd);
-  zx_status_t status = iwl_iobuf_allocate_contiguous(&trans_pcie->pci_dev->dev, TB1_MAX_SIZE,
-                                                     &txq->entries[cmd_idx].cmd);
+  zx_status_t status =
+      iwl_pcie_txq_get_buf(trans, txq, txq->cmd_pool, TB1_MAX_SIZE, &txq->entries[cmd_idx].cmd);
   if (status != ZX_OK) {
     IWL_ERR(trans, "pcie TX io_buffer_init() failed: %s\n", zx_status_get_string(status));
     ret = status;
@@ -2306,6 +2488,7 @@ zx_status_t iwl_trans_pcie_tx(struct iwl_trans* trans, struct ieee80211_mac_pack
 
   struct iwl_cmd_meta* out_meta = &txq->entries[cmd_idx].meta;
   out_meta->flags = 0;
+  out_meta->enqueue_time = iwl_time_now(trans->dev);
 
   /////////////////////////////////////////////////////////////////////////////////////////////////
   // (tb0) start the TFD with the minimum copy bytes.
@@ -2351,6 +2534,7 @@ zx_status_t iwl_trans_pcie_tx(struct iwl_trans* trans, struct ieee80211_mac_pack
   // (tb2) the 802.11 payload
   //
   if ((ret = iwl_fill_data_tbs(trans, pkt, txq, cmd_idx, &num_tbs, out_meta)) != ZX_OK) {
+    iwl_pcie_txq_put_bufs(txq, cmd_idx);
     goto unlock;
   }
 #else   // NEEDS_PORTING
@@ -2416,9 +2600,12 @@ zx_status_t iwl_trans_pcie_tx(struct iwl_trans* trans, struct ieee80211_mac_pack
 
   /* Tell device the write index *just past* this latest filled TFD */
   txq->write_ptr = iwl_queue_inc_wrap(trans, txq->write_ptr);
+  iwl_stats_hist_add(IWL_STATS_HIST_TXQ_OCCUPANCY,
+                     (txq->write_ptr - txq->read_ptr) &
+                         (trans->cfg->base_params->max_tfd_queue_size - 1));
 
 #if 1  // NEEDS_PORTING
-  iwl_pcie_txq_inc_wr_ptr(trans, txq);
+  iwl_pcie_txq_batch_add(trans, txq);
   /*
    * At this point the frame is "transmitted" successfully
    * and we will get a TX status notification eventually.
@@ -9,6 +9,21 @@
 #include <wlan/common/channel.h>
 #include <wlan/common/ieee80211.h>
 
+namespace {
+
+// Frame Control field bits (IEEE 802.11-2016 9.2.4.1), in host order.
+constexpr uint16_t kIeee80211FcTypeMask = 0x000c;
+constexpr uint16_t kIeee80211FcTypeCtl = 0x0004;
+constexpr uint16_t kIeee80211FcSubtypeMask = 0x00f0;
+constexpr uint16_t kIeee80211FcSubtypeNodata = 0x0040;
+constexpr uint16_t kIeee80211FcMoreFrags = 0x0400;
+constexpr uint16_t kIeee80211FcRetry = 0x0800;
+constexpr uint16_t kIeee80211FcCtlBackReq = 0x0084;
+constexpr uint16_t kIeee80211FcDataQosNullfunc = 0x00c8;
+constexpr uint16_t kIeee80211FcMgmtAction = 0x00d0;
+
+}  // namespace
+
 size_t ieee80211_get_header_len(const struct ieee80211_frame_header* fw) {
   return ieee80211_hdrlen(fw);
 }
@@ -53,3 +68,35 @@ uint8_t ieee80211_get_tid(const struct ieee80211_frame_header* fh) {
   const uint8_t* qos_ctl = reinterpret_cast<const uint8_t*>(fh) + ieee80211_get_qos_ctrl_offset(fh);
   return qos_ctl[0] & 0xF;
 }
+
+bool ieee80211_has_retry(const struct ieee80211_frame_header* fh) {
+  return fh->frame_ctrl & kIeee80211FcRetry;
+}
+
+bool ieee80211_has_morefrags(const struct ieee80211_frame_header* fh) {
+  return fh->frame_ctrl & kIeee80211FcMoreFrags;
+}
+
+bool ieee80211_is_ctl(const struct ieee80211_frame_header* fh) {
+  return (fh->frame_ctrl & kIeee80211FcTypeMask) == kIeee80211FcTypeCtl;
+}
+
+bool ieee80211_is_back_req(const struct ieee80211_frame_header* fh) {
+  return (fh->frame_ctrl & (kIeee80211FcTypeMask | kIeee80211FcSubtypeMask)) ==
+         kIeee80211FcCtlBackReq;
+}
+
+bool ieee80211_is_qos_nullfunc(const struct ieee80211_frame_header* fh) {
+  return (fh->frame_ctrl & (kIeee80211FcTypeMask | kIeee80211FcSubtypeMask)) ==
+         kIeee80211FcDataQosNullfunc;
+}
+
+bool ieee80211_is_action(const struct ieee80211_frame_header* fh) {
+  return (fh->frame_ctrl & (kIeee80211FcTypeMask | kIeee80211FcSubtypeMask)) ==
+         kIeee80211FcMgmtAction;
+}
+
+bool ieee80211_is_data_present(const struct ieee80211_frame_header* fh) {
+  // The Null subtypes of data frames (including QoS Null) all have bit 6 of the subtype set.
+  return ieee80211_is_data(fh) && !(fh->frame_ctrl & kIeee80211FcSubtypeNodata);
+}
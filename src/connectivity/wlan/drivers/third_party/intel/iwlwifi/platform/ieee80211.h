@@ -45,6 +45,79 @@ extern "C" {
 #define IEEE80211_SCTL_SEQ_MASK 0xfff
 #define IEEE80211_SCTL_SEQ_OFFSET 4
 #define IEEE80211_SEQ_TO_SN(seq) (((seq) >> IEEE80211_SCTL_SEQ_OFFSET) & IEEE80211_SCTL_SEQ_MASK)
+#define IEEE80211_SN_TO_SEQ(sn) (((sn) & IEEE80211_SCTL_SEQ_MASK) << IEEE80211_SCTL_SEQ_OFFSET)
+#define IEEE80211_SCTL_FRAG_MASK 0xf
+
+// Sequence number arithmetic, modulo 2^12 (IEEE 802.11-2016 10.3.2.11).
+#define IEEE80211_SN_MODULO (IEEE80211_SCTL_SEQ_MASK + 1)
+
+static inline bool ieee80211_sn_less(uint16_t sn1, uint16_t sn2) {
+  return ((sn1 - sn2) & IEEE80211_SCTL_SEQ_MASK) > (IEEE80211_SN_MODULO >> 1);
+}
+
+static inline uint16_t ieee80211_sn_add(uint16_t sn1, uint16_t sn2) {
+  return (sn1 + sn2) & IEEE80211_SCTL_SEQ_MASK;
+}
+
+static inline uint16_t ieee80211_sn_inc(uint16_t sn) { return ieee80211_sn_add(sn, 1); }
+
+// The TID field in the BAR Control field of a Block Ack Request frame.
+#define IEEE80211_BAR_CTRL_TID_INFO_SHIFT 12
+
+// Block Ack Request frame (IEEE 802.11-2016 9.3.1.8), for the compressed and basic variants.
+struct ieee80211_bar {
+  uint16_t frame_ctrl;
+  uint16_t duration;
+  uint8_t ra[ETH_ALEN];
+  uint8_t ta[ETH_ALEN];
+  uint16_t control;
+  uint16_t start_seq_num;
+} __packed;
+
+// The maximum Block Ack buffer size of an HT station.
+#define IEEE80211_MAX_AMPDU_BUF_HT 64
+
+// Block Ack action frames (IEEE 802.11-2016 9.6.5), which follow the MAC header of an Action frame.
+#define IEEE80211_ACTION_CATEGORY_BACK 3
+#define IEEE80211_BACK_ACTION_ADDBA_REQ 0
+#define IEEE80211_BACK_ACTION_ADDBA_RESP 1
+#define IEEE80211_BACK_ACTION_DELBA 2
+
+// The Block Ack Parameter Set field of the ADDBA frames (IEEE 802.11-2016 9.4.1.14).
+#define IEEE80211_ADDBA_PARAM_TID_MASK 0x003c
+#define IEEE80211_ADDBA_PARAM_TID_SHIFT 2
+#define IEEE80211_ADDBA_PARAM_BUF_SIZE_MASK 0xffc0
+#define IEEE80211_ADDBA_PARAM_BUF_SIZE_SHIFT 6
+
+// The DELBA Parameter Set field (IEEE 802.11-2016 9.4.1.16).
+#define IEEE80211_DELBA_PARAM_INITIATOR_MASK 0x0800
+#define IEEE80211_DELBA_PARAM_TID_MASK 0xf000
+#define IEEE80211_DELBA_PARAM_TID_SHIFT 12
+
+#define IEEE80211_STATUS_SUCCESS 0
+
+struct ieee80211_back_action {
+  uint8_t category;
+  uint8_t action;
+  union {
+    struct {
+      uint8_t dialog_token;
+      uint16_t params;
+      uint16_t timeout;
+      uint16_t start_seq_num;
+    } __packed addba_req;
+    struct {
+      uint8_t dialog_token;
+      uint16_t status;
+      uint16_t params;
+      uint16_t timeout;
+    } __packed addba_resp;
+    struct {
+      uint16_t params;
+      uint16_t reason_code;
+    } __packed delba;
+  } u;
+} __packed;
 
 /* 802.11n HT capabilities masks (for cap_info) */
 #define IEEE80211_HT_CAP_LDPC_CODING 0x0001
@@ -302,6 +375,22 @@ bool ieee80211_is_data_qos(const struct ieee80211_frame_header* fh);
 
 uint8_t ieee80211_get_tid(const struct ieee80211_frame_header* fh);
 
+bool ieee80211_has_retry(const struct ieee80211_frame_header* fh);
+
+bool ieee80211_has_morefrags(const struct ieee80211_frame_header* fh);
+
+bool ieee80211_is_ctl(const struct ieee80211_frame_header* fh);
+
+bool ieee80211_is_back_req(const struct ieee80211_frame_header* fh);
+
+bool ieee80211_is_qos_nullfunc(const struct ieee80211_frame_header* fh);
+
+bool ieee80211_is_action(const struct ieee80211_frame_header* fh);
+
+// Returns true if the frame is a data frame which carries a frame body, i.e. not one of the Null
+// subtypes.
+bool ieee80211_is_data_present(const struct ieee80211_frame_header* fh);
+
 #if defined(__cplusplus)
 }  // extern "C"
 #endif  // defined(__cplusplus)
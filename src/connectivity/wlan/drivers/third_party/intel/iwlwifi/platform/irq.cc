@@ -4,10 +4,23 @@
 
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/irq.h"
 
+#include <lib/async-loop/cpp/loop.h>
+#include <lib/async-loop/default.h>
+#include <lib/async/cpp/task.h>
 #include <lib/async/dispatcher.h>
+#include <lib/async/task.h>
+#include <lib/async/time.h>
+#include <lib/ddk/debug.h>
+#include <lib/ddk/driver.h>
+#include <lib/sync/completion.h>
+#include <string.h>
+#include <threads.h>
+#include <zircon/status.h>
 
+#include <atomic>
 #include <memory>
 
+#include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/rcu-manager.h"
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/task-internal.h"
 
 // Internally, the IRQ timers are just tasks, dispatched on the IRQ dispatcher.
@@ -29,4 +42,98 @@ zx_status_t iwl_irq_timer_start(struct iwl_irq_timer* timer, zx_duration_t delay
 
 zx_status_t iwl_irq_timer_stop(struct iwl_irq_timer* timer) { return timer->Cancel(); }
 
+zx_status_t iwl_irq_timer_stop_sync(struct iwl_irq_timer* timer) { return timer->CancelSync(); }
+
 void iwl_irq_timer_release_sync(struct iwl_irq_timer* timer) { delete timer; }
+
+// IRQ threads each own an async loop running on their own thread.  A wakeup posts the embedded
+// async_task_t, and `queued_` ensures that at most one post is outstanding at any time.
+struct iwl_irq_thread : private async_task_t {
+ public:
+  explicit iwl_irq_thread(iwl_irq_timer_func func, void* data)
+      : async_task_t{},
+        loop_(&kAsyncLoopConfigNoAttachToCurrentThread),
+        func_(func),
+        data_(data),
+        queued_(false) {
+    this->handler = [](async_dispatcher_t* dispatcher, async_task_t* task, zx_status_t status) {
+      auto thread = static_cast<iwl_irq_thread*>(task);
+      // Clear `queued_` before running, so that a wakeup that arrives while `func_` is executing
+      // will post the task again and the new work is not lost.
+      thread->queued_.store(false, std::memory_order_release);
+      if (status == ZX_OK) {
+        (*thread->func_)(thread->data_);
+      }
+    };
+  }
+
+  zx_status_t Start(struct device* dev, const char* name, const char* role) {
+    zx_status_t status = ZX_OK;
+    thrd_t thrd = {};
+    if ((status = loop_.StartThread(name, &thrd)) != ZX_OK) {
+      return status;
+    }
+    if (role != nullptr && dev->zxdev != nullptr) {
+      if ((status = device_set_profile_by_role(dev->zxdev, thrd_get_zx_handle(thrd), role,
+                                               strlen(role))) != ZX_OK) {
+        zxlogf(WARNING, "Failed to apply role %s to thread %s: %s", role, name,
+               zx_status_get_string(status));
+      }
+    }
+    if (dev->rcu_manager != nullptr) {
+      wlan::iwlwifi::RcuManager* rcu_manager = dev->rcu_manager;
+      ::async::PostTask(loop_.dispatcher(), [rcu_manager]() { rcu_manager->InitForThread(); });
+    }
+    return ZX_OK;
+  }
+
+  zx_status_t Wake() {
+    if (queued_.exchange(true, std::memory_order_acq_rel)) {
+      return ZX_OK;
+    }
+    this->deadline = async_now(loop_.dispatcher());
+    zx_status_t status = async_post_task(loop_.dispatcher(), this);
+    if (status != ZX_OK) {
+      queued_.store(false, std::memory_order_release);
+    }
+    return status;
+  }
+
+  // The loop runs its tasks in order, so once a task posted now has run, everything queued before
+  // it has run too.
+  void Sync() {
+    sync_completion_t done;
+    if (::async::PostTask(loop_.dispatcher(), [&done]() { sync_completion_signal(&done); }) !=
+        ZX_OK) {
+      return;
+    }
+    sync_completion_wait(&done, ZX_TIME_INFINITE);
+  }
+
+  // Shutting down the loop joins the thread, and runs any pending task with ZX_ERR_CANCELED.
+  ~iwl_irq_thread() { loop_.Shutdown(); }
+
+ private:
+  ::async::Loop loop_;
+  iwl_irq_timer_func const func_ = nullptr;
+  void* const data_ = nullptr;
+  std::atomic<bool> queued_;
+};
+
+zx_status_t iwl_irq_thread_create(struct device* dev, const char* name, const char* role,
+                                  iwl_irq_timer_func func, void* data,
+                                  struct iwl_irq_thread** out_thread) {
+  zx_status_t status = ZX_OK;
+  auto thread = std::make_unique<iwl_irq_thread>(func, data);
+  if ((status = thread->Start(dev, name, role)) != ZX_OK) {
+    return status;
+  }
+  *out_thread = thread.release();
+  return ZX_OK;
+}
+
+zx_status_t iwl_irq_thread_wake(struct iwl_irq_thread* thread) { return thread->Wake(); }
+
+void iwl_irq_thread_sync(struct iwl_irq_thread* thread) { thread->Sync(); }
+
+void iwl_irq_thread_release_sync(struct iwl_irq_thread* thread) { delete thread; }
@@ -8,6 +8,9 @@
 // This file defines the IRQ timer interface, equivalent to timer_setup() and friends in Linux.
 // These are tasks that are run in Linux in interrupt context; as such these tasks are not allowed
 // to sleep, block, etc.
+//
+// It also defines the IRQ thread interface, equivalent to the `thread_fn` of
+// request_threaded_irq() in Linux, used to move interrupt work off the interrupt thread.
 
 #include <zircon/types.h>
 
@@ -25,7 +28,7 @@ zx_status_t iwl_irq_timer_create(struct device* dev, iwl_irq_timer_func func, vo
                                  struct iwl_irq_timer** out_timer);
 
 // Start a timer, to be run after `delay`.  If the timer is already started, it will be stopped
-// first.
+// first.  If its function is executing, the timer is started again once the function returns.
 zx_status_t iwl_irq_timer_start(struct iwl_irq_timer* timer, zx_duration_t delay);
 
 // Cancel the timer.  This call does not block: once this call returns, the timer is no longer
@@ -36,10 +39,37 @@ zx_status_t iwl_irq_timer_start(struct iwl_irq_timer* timer, zx_duration_t delay
 // * Other errors in other error cases.
 zx_status_t iwl_irq_timer_stop(struct iwl_irq_timer* timer);
 
-// Release (and deallocate) the timer, synchronously.  If the timer is running, it will be
-// cancelled.
+// Cancel the timer, synchronously.  Once this call returns, the timer is not queued and its
+// function is not executing.  Must not be called from the timer function itself.  Returns the same
+// values as iwl_irq_timer_stop().
+zx_status_t iwl_irq_timer_stop_sync(struct iwl_irq_timer* timer);
+
+// Release (and deallocate) the timer, synchronously.  If the timer is queued, it will be cancelled;
+// if its function is executing, this call blocks until it returns.
 void iwl_irq_timer_release_sync(struct iwl_irq_timer* timer);
 
+struct iwl_irq_thread;
+
+// Create a dedicated thread named `name` that runs `func` each time it is woken.  If `role` is not
+// NULL, the thread is placed in that scheduler role (which is how the product configuration pins it
+// to a CPU); failure to apply the role is not fatal.
+zx_status_t iwl_irq_thread_create(struct device* dev, const char* name, const char* role,
+                                  iwl_irq_timer_func func, void* data,
+                                  struct iwl_irq_thread** out_thread);
+
+// Wake the thread, to run its function.  Wakeups are coalesced: waking a thread whose function is
+// already pending is a no-op, while waking it during execution runs the function once more after.
+zx_status_t iwl_irq_thread_wake(struct iwl_irq_thread* thread);
+
+// Wait until a pending or executing run of the function has returned, the equivalent of
+// synchronize_irq().  A wakeup that arrives meanwhile may still run the function afterwards.  Must
+// not be called from the thread itself.
+void iwl_irq_thread_sync(struct iwl_irq_thread* thread);
+
+// Release (and deallocate) the thread, synchronously.  If the function is executing, this call
+// blocks until it returns; a pending wakeup is dropped.
+void iwl_irq_thread_release_sync(struct iwl_irq_thread* thread);
+
 #if defined(__cplusplus)
 }  // extern "C"
 #endif  // defined(__cplusplus)
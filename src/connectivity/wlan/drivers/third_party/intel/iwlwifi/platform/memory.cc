@@ -5,11 +5,31 @@
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/memory.h"
 
 #include <lib/ddk/io-buffer.h>
+#include <zircon/assert.h>
 
 #include <memory>
 
+// Buffers in an iwl_iobuf_pool are aligned to this size, so that cache flushes on one buffer do not
+// touch its neighbors.
+constexpr size_t kIwlIobufPoolAlignment = 64;
+
 struct iwl_iobuf {
   io_buffer_t io_buffer = {};
+
+  // If this iwl_iobuf is a buffer in an iwl_iobuf_pool, `pool` is set and `offset` is the offset of
+  // this buffer in the pool slab.  `io_buffer` is unused in this case.
+  struct iwl_iobuf_pool* pool = nullptr;
+  size_t offset = 0;
+  struct iwl_iobuf* next_free = nullptr;
+};
+
+struct iwl_iobuf_pool {
+  io_buffer_t io_buffer = {};
+  size_t buf_size = 0;
+  size_t buf_count = 0;
+  std::unique_ptr<struct iwl_iobuf[]> bufs;
+  struct iwl_iobuf* free_list = nullptr;
+  size_t free_count = 0;
 };
 
 zx_status_t iwl_iobuf_allocate_contiguous(struct device* dev, size_t size,
@@ -26,20 +46,97 @@ zx_status_t iwl_iobuf_allocate_contiguous(struct device* dev, size_t size,
 }
 
 size_t iwl_iobuf_size(const struct iwl_iobuf* iobuf) {
+  if (iobuf->pool != nullptr) {
+    return iobuf->pool->buf_size;
+  }
   return io_buffer_size(&iobuf->io_buffer, 0);
 }
 
-void* iwl_iobuf_virtual(const struct iwl_iobuf* iobuf) { return io_buffer_virt(&iobuf->io_buffer); }
+void* iwl_iobuf_virtual(const struct iwl_iobuf* iobuf) {
+  if (iobuf->pool != nullptr) {
+    return static_cast<char*>(io_buffer_virt(&iobuf->pool->io_buffer)) + iobuf->offset;
+  }
+  return io_buffer_virt(&iobuf->io_buffer);
+}
 
 dma_addr_t iwl_iobuf_physical(const struct iwl_iobuf* iobuf) {
+  if (iobuf->pool != nullptr) {
+    return io_buffer_phys(&iobuf->pool->io_buffer) + iobuf->offset;
+  }
   return io_buffer_phys(&iobuf->io_buffer);
 }
 
 zx_status_t iwl_iobuf_cache_flush(struct iwl_iobuf* iobuf, size_t offset, size_t size) {
+  if (iobuf->pool != nullptr) {
+    return io_buffer_cache_flush(&iobuf->pool->io_buffer, iobuf->offset + offset, size);
+  }
   return io_buffer_cache_flush(&iobuf->io_buffer, offset, size);
 }
 
 void iwl_iobuf_release(struct iwl_iobuf* iobuf) {
+  if (iobuf->pool != nullptr) {
+    struct iwl_iobuf_pool* pool = iobuf->pool;
+    ZX_DEBUG_ASSERT(pool->free_count < pool->buf_count);
+    iobuf->next_free = pool->free_list;
+    pool->free_list = iobuf;
+    ++pool->free_count;
+    return;
+  }
+
   io_buffer_release(&iobuf->io_buffer);
   delete iobuf;
 }
+
+zx_status_t iwl_iobuf_pool_create(struct device* dev, size_t buf_size, size_t buf_count,
+                                  struct iwl_iobuf_pool** out_pool) {
+  if (buf_size == 0 || buf_count == 0) {
+    return ZX_ERR_INVALID_ARGS;
+  }
+
+  zx_status_t status = ZX_OK;
+  auto pool = std::make_unique<struct iwl_iobuf_pool>();
+  pool->buf_size = (buf_size + kIwlIobufPoolAlignment - 1) / kIwlIobufPoolAlignment *
+                   kIwlIobufPoolAlignment;
+  pool->buf_count = buf_count;
+  pool->bufs = std::make_unique<struct iwl_iobuf[]>(buf_count);
+  if ((status = io_buffer_init(&pool->io_buffer, dev->bti, pool->buf_size * buf_count,
+                               IO_BUFFER_RW | IO_BUFFER_CONTIG)) != ZX_OK) {
+    return status;
+  }
+
+  // Build the free list so that buffers are handed out in slab order.
+  for (size_t i = buf_count; i > 0; --i) {
+    struct iwl_iobuf* iobuf = &pool->bufs[i - 1];
+    iobuf->pool = pool.get();
+    iobuf->offset = (i - 1) * pool->buf_size;
+    iobuf->next_free = pool->free_list;
+    pool->free_list = iobuf;
+  }
+  pool->free_count = buf_count;
+
+  *out_pool = pool.release();
+  return ZX_OK;
+}
+
+size_t iwl_iobuf_pool_buf_size(const struct iwl_iobuf_pool* pool) { return pool->buf_size; }
+
+size_t iwl_iobuf_pool_available(const struct iwl_iobuf_pool* pool) { return pool->free_count; }
+
+zx_status_t iwl_iobuf_pool_acquire(struct iwl_iobuf_pool* pool, struct iwl_iobuf** out_iobuf) {
+  struct iwl_iobuf* iobuf = pool->free_list;
+  if (iobuf == nullptr) {
+    return ZX_ERR_NO_RESOURCES;
+  }
+
+  pool->free_list = iobuf->next_free;
+  iobuf->next_free = nullptr;
+  --pool->free_count;
+  *out_iobuf = iobuf;
+  return ZX_OK;
+}
+
+void iwl_iobuf_pool_destroy(struct iwl_iobuf_pool* pool) {
+  ZX_DEBUG_ASSERT(pool->free_count == pool->buf_count);
+  io_buffer_release(&pool->io_buffer);
+  delete pool;
+}
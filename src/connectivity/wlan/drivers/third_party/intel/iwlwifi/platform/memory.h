@@ -35,9 +35,34 @@ dma_addr_t iwl_iobuf_physical(const struct iwl_iobuf* iobuf);
 // Perform a cache flush on a range of an iwl_iobuf.
 zx_status_t iwl_iobuf_cache_flush(struct iwl_iobuf* iobuf, size_t offset, size_t size);
 
-// Release an iwl_iobuf.
+// Release an iwl_iobuf.  If the iwl_iobuf was acquired from an iwl_iobuf_pool, it is returned to
+// that pool instead.
 void iwl_iobuf_release(struct iwl_iobuf* iobuf);
 
+// A pool of fixed-size device-visible memory buffers, carved out of a single physically contiguous
+// slab that is allocated and pinned once at creation time.  Acquiring and releasing buffers from
+// the pool does not allocate memory or touch the BTI.
+//
+// The pool is not thread-safe: the caller is responsible for serializing access to it.
+struct iwl_iobuf_pool;
+
+// Create a pool of `buf_count` buffers, each at least `buf_size` bytes.
+zx_status_t iwl_iobuf_pool_create(struct device* dev, size_t buf_size, size_t buf_count,
+                                  struct iwl_iobuf_pool** out_pool);
+
+// Get the size of each buffer in an iwl_iobuf_pool.
+size_t iwl_iobuf_pool_buf_size(const struct iwl_iobuf_pool* pool);
+
+// Get the number of buffers currently available in an iwl_iobuf_pool.
+size_t iwl_iobuf_pool_available(const struct iwl_iobuf_pool* pool);
+
+// Acquire a buffer from an iwl_iobuf_pool.  Returns ZX_ERR_NO_RESOURCES if the pool is exhausted.
+// The buffer is returned to the pool by iwl_iobuf_release().
+zx_status_t iwl_iobuf_pool_acquire(struct iwl_iobuf_pool* pool, struct iwl_iobuf** out_iobuf);
+
+// Destroy an iwl_iobuf_pool.  All buffers acquired from the pool must have been released.
+void iwl_iobuf_pool_destroy(struct iwl_iobuf_pool* pool);
+
 #if defined(__cplusplus)
 }  // extern "C"
 #endif  // defined(__cplusplus)
@@ -274,6 +274,17 @@ static zx_status_t mac_ensure_phyctxt_valid(struct iwl_mvm_vif* mvmvif) {
   return ZX_OK;
 }
 
+// Run 'flow' with the CMD_PIPELINED host commands it sends batched, so that the firmware round
+// trips of a connection step overlap instead of adding up. Returns the first error of the flow, or
+// else of the batched commands.
+template <typename Flow>
+static zx_status_t with_hcmd_batch(struct iwl_mvm* mvm, Flow flow) {
+  iwl_mvm_hcmd_batch_begin(mvm);
+  zx_status_t ret = flow();
+  zx_status_t batch_ret = iwl_mvm_hcmd_batch_end(mvm);
+  return ret != ZX_OK ? ret : batch_ret;
+}
+
 static zx_status_t remove_chanctx(struct iwl_mvm_vif* mvmvif) {
   zx_status_t ret;
 
@@ -308,9 +319,7 @@ out:
   return ret;
 }
 
-// This is called right after SSID scan. The MLME tells this function the channel to tune in.
-// This function configures the PHY context and binds the MAC to that PHY context.
-zx_status_t mac_set_channel(struct iwl_mvm_vif* mvmvif, const wlan_channel_t* channel) {
+static zx_status_t set_channel(struct iwl_mvm_vif* mvmvif, const wlan_channel_t* channel) {
   zx_status_t ret;
 
   IWL_INFO(mvmvif, "mac_set_channel(primary:%d, bandwidth:'%s', secondary:%d)\n", channel->primary,
@@ -358,8 +367,13 @@ zx_status_t mac_set_channel(struct iwl_mvm_vif* mvmvif, const wlan_channel_t* ch
   return ret;
 }
 
-// This is called after mac_set_channel(). The MAC (mvmvif) will be configured as a CLIENT role.
-zx_status_t mac_configure_bss(struct iwl_mvm_vif* mvmvif, const bss_config_t* config) {
+// This is called right after SSID scan. The MLME tells this function the channel to tune in.
+// This function configures the PHY context and binds the MAC to that PHY context.
+zx_status_t mac_set_channel(struct iwl_mvm_vif* mvmvif, const wlan_channel_t* channel) {
+  return with_hcmd_batch(mvmvif->mvm, [&]() { return set_channel(mvmvif, channel); });
+}
+
+static zx_status_t configure_bss(struct iwl_mvm_vif* mvmvif, const bss_config_t* config) {
   zx_status_t ret = ZX_OK;
 
   IWL_INFO(mvmvif, "mac_configure_bss(bssid=%02x:%02x:%02x:%02x:%02x:%02x, type=%d, remote=%d)\n",
@@ -392,6 +406,11 @@ zx_status_t mac_configure_bss(struct iwl_mvm_vif* mvmvif, const bss_config_t* co
   return ZX_OK;
 }
 
+// This is called after mac_set_channel(). The MAC (mvmvif) will be configured as a CLIENT role.
+zx_status_t mac_configure_bss(struct iwl_mvm_vif* mvmvif, const bss_config_t* config) {
+  return with_hcmd_batch(mvmvif->mvm, [&]() { return configure_bss(mvmvif, config); });
+}
+
 // This function is to revert what mac_configure_bss() does.
 zx_status_t mac_unconfigure_bss(struct iwl_mvm_vif* mvmvif) {
   zx_status_t ret = ZX_OK;
@@ -401,6 +420,8 @@ zx_status_t mac_unconfigure_bss(struct iwl_mvm_vif* mvmvif) {
     auto lock = std::lock_guard(mvmvif->mvm->mutex);
     memset(mvmvif->bss_conf.bssid, 0, ETH_ALEN);
     memset(mvmvif->bssid, 0, ETH_ALEN);
+    // The WMM parameters of the BSS are no longer valid.
+    mvmvif->bss_conf.qos = false;
     // This will take the cleared BSSID from bss_conf and update the firmware.
     ret = iwl_mvm_mac_ctxt_changed(mvmvif, false, NULL);
     if (ret != ZX_OK) {
@@ -422,12 +443,8 @@ zx_status_t mac_configure_beacon(void* ctx, const wlan_tx_packet_t* packet_templ
   return ZX_ERR_NOT_SUPPORTED;
 }
 
-// Set the association result to the firmware.
-//
-// The current mac context is set by mac_configure_bss() with default values.
-//   TODO(fxbug.dev/36684): supports VHT (802.11ac)
-//
-zx_status_t mac_configure_assoc(struct iwl_mvm_vif* mvmvif, const wlan_assoc_ctx_t* assoc_ctx) {
+static zx_status_t configure_assoc(struct iwl_mvm_vif* mvmvif,
+                                   const wlan_assoc_ctx_t* assoc_ctx) {
   zx_status_t ret = ZX_OK;
   IWL_INFO(ctx, "Associating ...\n");
 
@@ -499,6 +516,15 @@ zx_status_t mac_configure_assoc(struct iwl_mvm_vif* mvmvif, const wlan_assoc_ctx
   return ZX_OK;
 }
 
+// Set the association result to the firmware.
+//
+// The current mac context is set by mac_configure_bss() with default values.
+//   TODO(fxbug.dev/36684): supports VHT (802.11ac)
+//
+zx_status_t mac_configure_assoc(struct iwl_mvm_vif* mvmvif, const wlan_assoc_ctx_t* assoc_ctx) {
+  return with_hcmd_batch(mvmvif->mvm, [&]() { return configure_assoc(mvmvif, assoc_ctx); });
+}
+
 zx_status_t mac_clear_assoc(struct iwl_mvm_vif* mvmvif,
                             const uint8_t peer_addr[fuchsia_wlan_ieee80211::wire::kMacAddrLen]) {
   IWL_INFO(ctx, "Disassociating ...\n");
@@ -522,6 +548,67 @@ zx_status_t mac_clear_assoc(struct iwl_mvm_vif* mvmvif,
   return remove_chanctx(mvmvif);
 }
 
+// Convert the EDCA parameters of one AC, as advertised by the AP in its WMM Parameter element.
+//
+// IEEE Std 802.11-2016, 9.4.2.28: the contention window is encoded as an exponent (CW = 2^ECW - 1)
+// and the TXOP limit is in units of 32 us. The TXOP limit is kept in those units here, like
+// mac80211 does: the firmware takes it in us, and iwl_mvm_mac_ctxt_cmd_common() converts it.
+static struct ieee80211_tx_queue_params wmm_ac_to_queue_params(
+    const wlan_wmm_ac_params_t* ac_params) {
+  return {
+      .txop = ac_params->txop_limit,
+      .cw_min = static_cast<uint16_t>((1 << ac_params->ecw_min) - 1),
+      .cw_max = static_cast<uint16_t>((1 << ac_params->ecw_max) - 1),
+      .aifs = ac_params->aifsn,
+  };
+}
+
+// Update the EDCA parameters, as advertised by the AP in its WMM Parameter element. `params` holds
+// all four ACs, which are all stored so that the MAC context update for `ac` does not push zeroed
+// parameters for the others.
+zx_status_t mac_update_wmm_params(struct iwl_mvm_vif* mvmvif, wlan_ac_t ac,
+                                  const wlan_wmm_params_t* params) {
+  uint16_t mvm_ac;
+
+  switch (ac) {
+    case WLAN_AC_BACKGROUND:
+      mvm_ac = IEEE80211_AC_BK;
+      break;
+    case WLAN_AC_BEST_EFFORT:
+      mvm_ac = IEEE80211_AC_BE;
+      break;
+    case WLAN_AC_VIDEO:
+      mvm_ac = IEEE80211_AC_VI;
+      break;
+    case WLAN_AC_VOICE:
+      mvm_ac = IEEE80211_AC_VO;
+      break;
+    default:
+      IWL_ERR(mvmvif, "invalid AC requested: %d\n", ac);
+      return ZX_ERR_INVALID_ARGS;
+  }
+
+  struct ieee80211_tx_queue_params queue_params[IEEE80211_AC_MAX] = {};
+  queue_params[IEEE80211_AC_VO] = wmm_ac_to_queue_params(&params->ac_vo_params);
+  queue_params[IEEE80211_AC_VI] = wmm_ac_to_queue_params(&params->ac_vi_params);
+  queue_params[IEEE80211_AC_BE] = wmm_ac_to_queue_params(&params->ac_be_params);
+  queue_params[IEEE80211_AC_BK] = wmm_ac_to_queue_params(&params->ac_bk_params);
+
+  auto lock = std::lock_guard(mvmvif->mvm->mutex);
+  // Store the other ACs first: iwl_mvm_mac_conf_tx() pushes them all in one MAC context update.
+  for (uint16_t i = 0; i < IEEE80211_AC_MAX; i++) {
+    if (i != mvm_ac) {
+      mvmvif->queue_params[i] = queue_params[i];
+    }
+  }
+  zx_status_t ret = iwl_mvm_mac_conf_tx(mvmvif, mvm_ac, &queue_params[mvm_ac]);
+  if (ret != ZX_OK) {
+    IWL_ERR(mvmvif, "cannot update WMM params: %s\n", zx_status_get_string(ret));
+  }
+
+  return ret;
+}
+
 zx_status_t mac_start_passive_scan(void* ctx,
                                    const wlan_softmac_passive_scan_args_t* passive_scan_args,
                                    uint64_t* out_scan_id) {
@@ -62,6 +62,8 @@ zx_status_t mac_configure_beacon(void* ctx, const wlan_tx_packet_t* packet_templ
 zx_status_t mac_configure_assoc(struct iwl_mvm_vif* mvmvif, const wlan_assoc_ctx_t* assoc_ctx);
 zx_status_t mac_clear_assoc(struct iwl_mvm_vif* mvmvif,
                             const uint8_t peer_addr[fuchsia_wlan_ieee80211_MAC_ADDR_LEN]);
+zx_status_t mac_update_wmm_params(struct iwl_mvm_vif* mvmvif, wlan_ac_t ac,
+                                  const wlan_wmm_params_t* params);
 zx_status_t mac_start_passive_scan(void* ctx,
                                    const wlan_softmac_passive_scan_args_t* passive_scan_args,
                                    uint64_t* out_scan_id);
@@ -3,15 +3,76 @@
 #include <lib/async/cpp/task.h>
 #include <lib/stdcompat/atomic.h>
 #include <zircon/assert.h>
+#include <zircon/syscalls.h>
+#include <zircon/time.h>
 
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
 #include <limits>
+#include <memory>
+#include <thread>
+#include <unordered_map>
 
 namespace wlan::iwlwifi {
+namespace {
+
+// Guards RcuManager::readers_ and RcuManager::Reader::manager, for all instances.
+std::mutex registry_mutex;
+
+// Source of the RcuManager IDs.  0 is never handed out.
+std::atomic<uint64_t> next_manager_id = 1;
+
+// Sync() spins this many times waiting for readers before it starts sleeping.
+constexpr int kSyncSpinCount = 64;
+constexpr zx_duration_t kSyncMaxSleep = ZX_MSEC(1);
+
+// ProcessCallbacks() polls for the end of a grace period with this exponential backoff.
+constexpr zx_duration_t kCallbackPollMinDelay = ZX_USEC(10);
+constexpr zx_duration_t kCallbackPollMaxDelay = ZX_MSEC(1);
+
+}  // namespace
+
+// The reader state of one thread for one manager.
+struct RcuManager::Reader {
+  // The epoch observed on entry to the outermost read-side section, or 0 outside of one.
+  std::atomic<uint64_t> epoch = 0;
+  int nesting = 0;
+  // The manager this reader is registered with, or nullptr once that manager is gone.
+  RcuManager* manager = nullptr;
+};
+
+// The reader states of one thread, keyed by manager ID.
+struct RcuManager::ThreadReaders {
+  ~ThreadReaders() {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    for (auto& [id, reader] : readers) {
+      UnregisterLocked(reader.get());
+    }
+  }
+
+  static void UnregisterLocked(Reader* reader) {
+    if (reader->manager != nullptr) {
+      auto& readers = reader->manager->readers_;
+      readers.erase(std::remove(readers.begin(), readers.end(), reader), readers.end());
+      reader->manager = nullptr;
+    }
+  }
+
+  std::unordered_map<uint64_t, std::unique_ptr<Reader>> readers;
+
+  // The last reader looked up, so that a thread that only uses one manager skips the map.
+  uint64_t last_id = 0;
+  Reader* last = nullptr;
+};
 
 // static
-thread_local int RcuManager::read_lock_count_ = 0;
+thread_local RcuManager::ThreadReaders RcuManager::thread_readers_;
 
-RcuManager::RcuManager(async_dispatcher_t* dispatcher) : dispatcher_(dispatcher) {}
+RcuManager::RcuManager(async_dispatcher_t* dispatcher)
+    : dispatcher_(dispatcher),
+      id_(next_manager_id.fetch_add(1, std::memory_order_relaxed)),
+      poll_delay_(kCallbackPollMinDelay) {}
 
 RcuManager::~RcuManager() {
   zx_status_t status = ZX_OK;
@@ -28,47 +89,166 @@ RcuManager::~RcuManager() {
     }
     count = call_count_ref.load(std::memory_order_acquire);
   }
+
+  // Detach the threads still registered with this instance.  Their reader states are freed when
+  // the threads exit.
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  for (Reader* reader : readers_) {
+    reader->manager = nullptr;
+  }
+  readers_.clear();
 }
 
-void RcuManager::InitForThread() { read_lock_count_ = 0; }
+RcuManager::Reader* RcuManager::FindReader() {
+  ThreadReaders& thread_readers = thread_readers_;
+  if (thread_readers.last_id == id_) {
+    return thread_readers.last;
+  }
+  auto it = thread_readers.readers.find(id_);
+  if (it == thread_readers.readers.end()) {
+    return nullptr;
+  }
+  thread_readers.last_id = id_;
+  thread_readers.last = it->second.get();
+  return thread_readers.last;
+}
+
+RcuManager::Reader& RcuManager::GetReader() {
+  Reader* reader = FindReader();
+  if (reader != nullptr) {
+    return *reader;
+  }
+
+  ThreadReaders& thread_readers = thread_readers_;
+  auto new_reader = std::make_unique<Reader>();
+  reader = new_reader.get();
+  {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    // Drop the states left behind by managers that have been destroyed in the meantime.
+    for (auto it = thread_readers.readers.begin(); it != thread_readers.readers.end();) {
+      it = (it->second->manager == nullptr) ? thread_readers.readers.erase(it) : std::next(it);
+    }
+    readers_.push_back(reader);
+    reader->manager = this;
+  }
+  thread_readers.readers.emplace(id_, std::move(new_reader));
+  thread_readers.last_id = id_;
+  thread_readers.last = reader;
+  return *reader;
+}
+
+void RcuManager::InitForThread() {
+  Reader& reader = GetReader();
+  reader.nesting = 0;
+  reader.epoch.store(0, std::memory_order_relaxed);
+}
 
 void RcuManager::ReadLock() {
-  if (++read_lock_count_ == 1) {
-    rwlock_.lock_shared();
+  // Threads that skipped InitForThread() are registered on their first read-side lock.
+  Reader& reader = GetReader();
+  if (reader.nesting++ == 0) {
+    reader.epoch.store(epoch_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    // Order the epoch store before the loads in the read-side section.  This pairs with the fence
+    // in StartGracePeriod().
+    std::atomic_thread_fence(std::memory_order_seq_cst);
   }
 }
 
 void RcuManager::ReadUnlock() {
-  ZX_DEBUG_ASSERT(read_lock_count_ > 0);
-  if (--read_lock_count_ == 0) {
-    rwlock_.unlock_shared();
+  Reader& reader = GetReader();
+  ZX_DEBUG_ASSERT(reader.nesting > 0);
+  if (--reader.nesting == 0) {
+    reader.epoch.store(0, std::memory_order_release);
+  }
+}
+
+uint64_t RcuManager::StartGracePeriod() {
+  // Order the writer's updates before the scan of the reader epochs.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  return epoch_.fetch_add(1, std::memory_order_seq_cst) + 1;
+}
+
+bool RcuManager::GracePeriodElapsed(uint64_t epoch) {
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  for (const Reader* reader : readers_) {
+    const uint64_t reader_epoch = reader->epoch.load(std::memory_order_acquire);
+    if (reader_epoch != 0 && reader_epoch < epoch) {
+      return false;
+    }
   }
+  return true;
 }
 
 void RcuManager::Sync() {
-  // Sync only has to ensure that there are no more outstanding reader locks.
-  rwlock_.lock();
-  rwlock_.unlock();
+  // Waiting for a grace period inside a read-side section would wait for ourselves.
+  ZX_DEBUG_ASSERT(FindReader() == nullptr || FindReader()->nesting == 0);
+
+  const uint64_t epoch = StartGracePeriod();
+  zx_duration_t sleep = ZX_USEC(1);
+  for (int i = 0; !GracePeriodElapsed(epoch); ++i) {
+    // Read-side sections are short, so spin for a while before backing off.
+    if (i < kSyncSpinCount) {
+      std::this_thread::yield();
+    } else {
+      zx_nanosleep(zx_deadline_after(sleep));
+      sleep = std::min(sleep * 2, kSyncMaxSleep);
+    }
+  }
 }
 
 void RcuManager::CallSync(void (*func)(void*), void* data) {
-  // Post the task to the worker dispatcher.  This has the advantages of:
+  // Queue the call for the worker dispatcher.  This has the advantages of:
   // * Not immediately blocking the current thread.
-  // * The worker dispatcher is often another thread that uses RCUs.  By posting the task to this
-  //   thread, we ensure that it cannot also be locking for RCU at the same time, thus reducing
-  //   contention.
+  // * Batching: all calls queued while a grace period is pending share the next grace period.
   cpp20::atomic_ref<zx_futex_t> call_count_ref(call_count_);
   call_count_ref.fetch_add(1, std::memory_order_release);
-  ::async::PostTask(dispatcher_, [this, func, data]() {
-    Sync();
-    func(data);
-
-    // Signal waiters that may be waiting for all calls to complete.
-    cpp20::atomic_ref<zx_futex_t> call_count_ref(call_count_);
-    if (call_count_ref.fetch_sub(1, std::memory_order_release) == 1) {
-      zx_futex_wake(&call_count_, std::numeric_limits<uint32_t>::max());
+
+  std::lock_guard<std::mutex> lock(callback_mutex_);
+  pending_callbacks_.push_back({func, data});
+  if (!callback_task_posted_) {
+    callback_task_posted_ = true;
+    ::async::PostTask(dispatcher_, [this]() { ProcessCallbacks(); });
+  }
+}
+
+void RcuManager::ProcessCallbacks() {
+  if (waiting_callbacks_.empty()) {
+    {
+      std::lock_guard<std::mutex> lock(callback_mutex_);
+      waiting_callbacks_.swap(pending_callbacks_);
+    }
+    waiting_epoch_ = StartGracePeriod();
+  }
+
+  if (!GracePeriodElapsed(waiting_epoch_)) {
+    // Poll again later, without blocking the other tasks on the dispatcher.  Most grace periods end
+    // within the first few polls; the backoff keeps a long read-side section from costing a CPU.
+    ::async::PostDelayedTask(dispatcher_, [this]() { ProcessCallbacks(); }, poll_delay_);
+    poll_delay_ = std::min(poll_delay_ * 2, kCallbackPollMaxDelay);
+    return;
+  }
+  poll_delay_ = kCallbackPollMinDelay;
+
+  const zx_futex_t count = static_cast<zx_futex_t>(waiting_callbacks_.size());
+  for (const Callback& callback : waiting_callbacks_) {
+    callback.func(callback.data);
+  }
+  waiting_callbacks_.clear();
+
+  {
+    std::lock_guard<std::mutex> lock(callback_mutex_);
+    if (pending_callbacks_.empty()) {
+      callback_task_posted_ = false;
+    } else {
+      ::async::PostTask(dispatcher_, [this]() { ProcessCallbacks(); });
     }
-  });
+  }
+
+  // Signal waiters that may be waiting for all calls to complete.
+  cpp20::atomic_ref<zx_futex_t> call_count_ref(call_count_);
+  if (call_count_ref.fetch_sub(count, std::memory_order_release) == count) {
+    zx_futex_wake(&call_count_, std::numeric_limits<uint32_t>::max());
+  }
 }
 
 void RcuManager::FreeSync(void* alloc) { CallSync(&free, alloc); }
@@ -6,13 +6,25 @@
 #define SRC_CONNECTIVITY_WLAN_DRIVERS_THIRD_PARTY_INTEL_IWLWIFI_PLATFORM_RCU_MANAGER_H_
 
 #include <lib/async/dispatcher.h>
+#include <zircon/compiler.h>
 #include <zircon/types.h>
 
-#include <shared_mutex>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
 
 namespace wlan::iwlwifi {
 
 // This class manages RCU-based synchronization for a set of threads.
+//
+// Grace periods are tracked with a per-manager epoch.  A reader publishes the epoch it observed on
+// entry to its outermost read-side section in a slot private to the thread and the manager, and
+// clears it on exit; it touches no shared writable state.  A writer starts a grace period by
+// advancing the epoch, and the grace period has elapsed once no thread is still in a section that
+// started in an earlier epoch.
+// Callbacks passed to CallSync() are batched, so that all callbacks queued while one grace period
+// is pending share the next one.
 class RcuManager {
  public:
   explicit RcuManager(async_dispatcher_t* dispatcher);
@@ -38,9 +50,50 @@ class RcuManager {
   void FreeSync(void* alloc);
 
  private:
+  struct Reader;
+  struct ThreadReaders;
+  struct Callback {
+    void (*func)(void*);
+    void* data;
+  };
+
+  // Returns the reader state of the current thread for this manager, registering it on first use.
+  Reader& GetReader();
+
+  // Returns the reader state of the current thread for this manager, or nullptr if it has none.
+  Reader* FindReader();
+
+  // Start a new grace period, and return its epoch.
+  uint64_t StartGracePeriod();
+
+  // Returns true if no reader is in a section that started before the grace period `epoch`.
+  bool GracePeriodElapsed(uint64_t epoch);
+
+  // Dispatcher task that waits, without blocking, for a grace period to pass, then runs the batch
+  // of callbacks that were waiting for it.
+  void ProcessCallbacks();
+
   async_dispatcher_t* dispatcher_ = nullptr;
-  std::shared_mutex rwlock_;
-  static thread_local int read_lock_count_;
+  std::atomic<uint64_t> epoch_ = 1;
+
+  // Never reused, so that the per-thread state left behind by a destroyed manager cannot be
+  // mistaken for that of a new manager allocated at the same address.
+  const uint64_t id_;
+  static thread_local ThreadReaders thread_readers_;
+
+  // The threads that have entered a read-side section of this manager, guarded by a lock shared by
+  // all RcuManager instances so that an exiting thread can safely unregister itself.
+  std::vector<Reader*> readers_;
+
+  std::mutex callback_mutex_;
+  std::vector<Callback> pending_callbacks_ __TA_GUARDED(callback_mutex_);
+  bool callback_task_posted_ __TA_GUARDED(callback_mutex_) = false;
+
+  // Only accessed from the dispatcher task.
+  std::vector<Callback> waiting_callbacks_;
+  uint64_t waiting_epoch_ = 0;
+  zx_duration_t poll_delay_;
+
   zx_futex_t call_count_ = 0;
 };
 
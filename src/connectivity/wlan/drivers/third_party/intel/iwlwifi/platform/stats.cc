@@ -7,96 +7,267 @@
 #include <lib/async/dispatcher.h>
 #include <lib/async/task.h>
 #include <lib/async/time.h>  // for async_now()
+#include <lib/inspect/cpp/vmo/types.h>
 #include <zircon/time.h>
 
+#include <atomic>
+#include <iterator>
+#include <memory>
 #include <mutex>
 
 #include <wlan/common/ieee80211.h>
 
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/compiler.h"
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/debug.h"
+#include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/driver-inspector.h"
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/kernel.h"
 
 #define IWL_STATS_INTERVAL ZX_SEC(20)
 
+// The counters and histograms are sharded, so that the datapath threads do not contend on a lock
+// or a cache line when they update them.  Each thread is assigned a shard on first use; readers sum
+// over all shards.
+#define IWL_STATS_SHARDS 16
+#define IWL_STATS_CACHE_LINE_SIZE 64
+
 static const char* descs[] = {
-    "ints", "fw_cmd", "be", "bc", "mc", "uni", "from_mlme", "data->fw", "cmd->fw",
+    "ints", "fw_cmd", "be", "bc", "mc", "uni", "from_mlme", "data->fw", "cmd->fw", "slab_ex",
+};
+
+// The names used in the Inspect tree.
+static const char* counter_names[] = {
+    "ints_from_fw", "cmd_from_fw", "beacon_to_mlme", "bcast_to_mlme", "mcast_to_mlme",
+    "unicast_to_mlme", "data_from_mlme", "data_to_fw", "cmd_to_fw", "tx_slab_exhausted",
+};
+static const char* hist_names[] = {
+    "tx_latency_us",
+    "rx_batch",
+    "txq_occupancy",
+    "hcmd_rtt_us",
+};
+static_assert(std::size(descs) == IWL_STATS_CNT_MAX);
+static_assert(std::size(counter_names) == IWL_STATS_CNT_MAX);
+static_assert(std::size(hist_names) == IWL_STATS_HIST_MAX);
+
+struct alignas(IWL_STATS_CACHE_LINE_SIZE) iwl_stats_shard {
+  std::atomic<size_t> counters[IWL_STATS_CNT_MAX];
+  std::atomic<size_t> hists[IWL_STATS_HIST_MAX][IWL_STATS_HIST_BUCKETS];
+};
+static struct iwl_stats_shard stats_shards[IWL_STATS_SHARDS];
+
+// The Inspect nodes, and the histogram counts last inserted into them.
+struct iwl_stats_inspect {
+  ::inspect::Node node;
+  ::inspect::IntProperty last_rssi_dbm;
+  ::inspect::UintProperty last_data_rate;
+  ::inspect::UintProperty counters[IWL_STATS_CNT_MAX];
+  ::inspect::ExponentialUintHistogram hists[IWL_STATS_HIST_MAX];
+  size_t published[IWL_STATS_HIST_MAX][IWL_STATS_HIST_BUCKETS];
 };
 
 struct iwl_stats_data {
   async_dispatcher_t* dispatcher;
   async_task_t task;
 
-  int8_t last_rssi_dbm;
-  uint32_t last_data_rate;
+  std::atomic<int8_t> last_rssi_dbm;
+  std::atomic<uint32_t> last_data_rate;
 
-  size_t counters[IWL_STATS_CNT_MAX];
+  struct driver_inspector* inspector;
+  std::unique_ptr<struct iwl_stats_inspect> inspect;
 };
 static struct iwl_stats_data stats_data;
+
+// Protects the reporting task and the Inspect nodes.  Not taken on the datapath.
 static std::mutex mutex_lock;
 
+static struct iwl_stats_shard* iwl_stats_get_shard() {
+  static std::atomic<size_t> next_shard;
+  thread_local struct iwl_stats_shard* shard =
+      &stats_shards[next_shard.fetch_add(1, std::memory_order_relaxed) % IWL_STATS_SHARDS];
+  return shard;
+}
+
+static size_t iwl_stats_hist_bucket(uint64_t value) {
+  if (value == 0) {
+    return 0;
+  }
+  const size_t bucket = 64 - __builtin_clzll(value);
+  return bucket < IWL_STATS_HIST_BUCKETS ? bucket : IWL_STATS_HIST_BUCKETS - 1;
+}
+
+static size_t iwl_stats_sum_counter(enum iwl_stats_counter_index index) {
+  size_t sum = 0;
+  for (auto& shard : stats_shards) {
+    sum += shard.counters[index].load(std::memory_order_relaxed);
+  }
+  return sum;
+}
+
+static size_t iwl_stats_sum_hist(enum iwl_stats_histogram_index index, size_t bucket) {
+  size_t sum = 0;
+  for (auto& shard : stats_shards) {
+    sum += shard.hists[index][bucket].load(std::memory_order_relaxed);
+  }
+  return sum;
+}
+
 static void iwl_stats_schedule_next(zx_duration_t interval) {
   async_cancel_task(stats_data.dispatcher, &stats_data.task);
   stats_data.task.deadline = interval + async_now(stats_data.dispatcher);
   async_post_task(stats_data.dispatcher, &stats_data.task);
 }
 
+static std::unique_ptr<struct iwl_stats_inspect> iwl_stats_create_inspect(::inspect::Node& parent) {
+  auto inspect = std::make_unique<struct iwl_stats_inspect>();
+  inspect->node = parent.CreateChild("stats");
+  inspect->last_rssi_dbm = inspect->node.CreateInt("last_rssi_dbm", 0);
+  inspect->last_data_rate = inspect->node.CreateUint("last_data_rate", 0);
+  for (size_t i = 0; i < IWL_STATS_CNT_MAX; ++i) {
+    inspect->counters[i] = inspect->node.CreateUint(counter_names[i], 0);
+  }
+  // Inspect buckets are [0, 1), [1, 2), [2, 4), ..., plus an overflow bucket, which matches ours.
+  for (size_t i = 0; i < IWL_STATS_HIST_MAX; ++i) {
+    inspect->hists[i] = inspect->node.CreateExponentialUintHistogram(
+        hist_names[i], /*floor*/ 0, /*initial_step*/ 1, /*step_multiplier*/ 2,
+        /*buckets*/ IWL_STATS_HIST_BUCKETS - 1);
+  }
+  return inspect;
+}
+
+// Copy the current values into the Inspect tree.
+static void iwl_stats_update_inspect(struct iwl_stats_inspect* inspect) {
+  inspect->last_rssi_dbm.Set(stats_data.last_rssi_dbm.load(std::memory_order_relaxed));
+  inspect->last_data_rate.Set(stats_data.last_data_rate.load(std::memory_order_relaxed));
+  for (size_t i = 0; i < IWL_STATS_CNT_MAX; ++i) {
+    inspect->counters[i].Set(iwl_stats_sum_counter(static_cast<enum iwl_stats_counter_index>(i)));
+  }
+  for (size_t i = 0; i < IWL_STATS_HIST_MAX; ++i) {
+    for (size_t bucket = 0; bucket < IWL_STATS_HIST_BUCKETS; ++bucket) {
+      const size_t count =
+          iwl_stats_sum_hist(static_cast<enum iwl_stats_histogram_index>(i), bucket);
+      if (count > inspect->published[i][bucket]) {
+        const uint64_t value = bucket == 0 ? 0 : 1ull << (bucket - 1);
+        inspect->hists[i].Insert(value, count - inspect->published[i][bucket]);
+        inspect->published[i][bucket] = count;
+      }
+    }
+  }
+}
+
 void iwl_stats_report_wk(async_dispatcher_t* dispatcher, async_task_t* task, zx_status_t status) {
+  if (status != ZX_OK) {
+    return;
+  }
+
   const std::lock_guard<std::mutex> lock(mutex_lock);
 
+  size_t counters[IWL_STATS_CNT_MAX];
+  for (size_t i = 0; i < IWL_STATS_CNT_MAX; ++i) {
+    counters[i] = iwl_stats_sum_counter(static_cast<enum iwl_stats_counter_index>(i));
+  }
+
   // TODO(fxb/101542): better debug info for bug triage.
   // clang-format off
   zxlogf(INFO,
-      "rssi:%d rate:%u [%s:%zu %s:%zu (%s:%zu,%s:%zu,%s:%zu,%s:%zu)] [%s:%zu %s:%zu %s:%zu]",
-      stats_data.last_rssi_dbm, stats_data.last_data_rate,
-      descs[IWL_STATS_CNT_INTS_FROM_FW], stats_data.counters[IWL_STATS_CNT_INTS_FROM_FW],
-      descs[IWL_STATS_CNT_CMD_FROM_FW], stats_data.counters[IWL_STATS_CNT_CMD_FROM_FW],
-      descs[IWL_STATS_CNT_BCAST_TO_MLME], stats_data.counters[IWL_STATS_CNT_BCAST_TO_MLME],
-      descs[IWL_STATS_CNT_MCAST_TO_MLME], stats_data.counters[IWL_STATS_CNT_MCAST_TO_MLME],
-      descs[IWL_STATS_CNT_UNICAST_TO_MLME], stats_data.counters[IWL_STATS_CNT_UNICAST_TO_MLME],
-      descs[IWL_STATS_CNT_BEACON_TO_MLME], stats_data.counters[IWL_STATS_CNT_BEACON_TO_MLME],
-      descs[IWL_STATS_CNT_DATA_FROM_MLME], stats_data.counters[IWL_STATS_CNT_DATA_FROM_MLME],
-      descs[IWL_STATS_CNT_DATA_TO_FW], stats_data.counters[IWL_STATS_CNT_DATA_TO_FW],
-      descs[IWL_STATS_CNT_CMD_TO_FW], stats_data.counters[IWL_STATS_CNT_CMD_TO_FW]);
+      "rssi:%d rate:%u [%s:%zu %s:%zu (%s:%zu,%s:%zu,%s:%zu,%s:%zu)] [%s:%zu %s:%zu %s:%zu %s:%zu]",
+      stats_data.last_rssi_dbm.load(), stats_data.last_data_rate.load(),
+      descs[IWL_STATS_CNT_INTS_FROM_FW], counters[IWL_STATS_CNT_INTS_FROM_FW],
+      descs[IWL_STATS_CNT_CMD_FROM_FW], counters[IWL_STATS_CNT_CMD_FROM_FW],
+      descs[IWL_STATS_CNT_BCAST_TO_MLME], counters[IWL_STATS_CNT_BCAST_TO_MLME],
+      descs[IWL_STATS_CNT_MCAST_TO_MLME], counters[IWL_STATS_CNT_MCAST_TO_MLME],
+      descs[IWL_STATS_CNT_UNICAST_TO_MLME], counters[IWL_STATS_CNT_UNICAST_TO_MLME],
+      descs[IWL_STATS_CNT_BEACON_TO_MLME], counters[IWL_STATS_CNT_BEACON_TO_MLME],
+      descs[IWL_STATS_CNT_DATA_FROM_MLME], counters[IWL_STATS_CNT_DATA_FROM_MLME],
+      descs[IWL_STATS_CNT_DATA_TO_FW], counters[IWL_STATS_CNT_DATA_TO_FW],
+      descs[IWL_STATS_CNT_CMD_TO_FW], counters[IWL_STATS_CNT_CMD_TO_FW],
+      descs[IWL_STATS_CNT_TX_SLAB_EXHAUSTED], counters[IWL_STATS_CNT_TX_SLAB_EXHAUSTED]);
   // clang-format on
 
+  if (stats_data.inspect) {
+    iwl_stats_update_inspect(stats_data.inspect.get());
+  }
+
   iwl_stats_schedule_next(IWL_STATS_INTERVAL);
 }
 
 void iwl_stats_init(async_dispatcher_t* dispatcher) {
   const std::lock_guard<std::mutex> lock(mutex_lock);
 
-  memset(&stats_data, 0, sizeof(stats_data));
+  // The driver may be re-initialized on the same dispatcher while the previous report is queued.
+  if (stats_data.dispatcher == dispatcher) {
+    async_cancel_task(stats_data.dispatcher, &stats_data.task);
+  }
+
+  for (auto& shard : stats_shards) {
+    for (auto& counter : shard.counters) {
+      counter.store(0, std::memory_order_relaxed);
+    }
+    for (auto& hist : shard.hists) {
+      for (auto& bucket : hist) {
+        bucket.store(0, std::memory_order_relaxed);
+      }
+    }
+  }
+  stats_data.last_rssi_dbm.store(0, std::memory_order_relaxed);
+  stats_data.last_data_rate.store(0, std::memory_order_relaxed);
+
+  // The Inspect histograms can only be inserted into, so recreate them to reset them.
+  if (stats_data.inspector) {
+    stats_data.inspect.reset();
+    stats_data.inspect = iwl_stats_create_inspect(stats_data.inspector->GetRoot());
+  }
 
   stats_data.dispatcher = dispatcher;
+  stats_data.task = {};
   stats_data.task.handler = &iwl_stats_report_wk;
 }
 
+void iwl_stats_publish(struct driver_inspector* inspector) {
+  const std::lock_guard<std::mutex> lock(mutex_lock);
+
+  stats_data.inspect.reset();
+  stats_data.inspector = inspector;
+  if (inspector == nullptr) {
+    return;
+  }
+  stats_data.inspect = iwl_stats_create_inspect(inspector->GetRoot());
+  iwl_stats_update_inspect(stats_data.inspect.get());
+}
+
 void iwl_stats_start_reporting(void) { iwl_stats_schedule_next(ZX_SEC(0)); }
 
 void iwl_stats_update_last_rssi(int8_t rssi_dbm) {
-  const std::lock_guard<std::mutex> lock(mutex_lock);
-
-  stats_data.last_rssi_dbm = rssi_dbm;
+  stats_data.last_rssi_dbm.store(rssi_dbm, std::memory_order_relaxed);
 }
 
 void iwl_stats_update_date_rate(uint32_t data_rate) {
-  const std::lock_guard<std::mutex> lock(mutex_lock);
-  stats_data.last_data_rate = data_rate;
+  stats_data.last_data_rate.store(data_rate, std::memory_order_relaxed);
 }
 
 size_t iwl_stats_read(enum iwl_stats_counter_index index) {
   ZX_ASSERT(index < IWL_STATS_CNT_MAX);
 
-  const std::lock_guard<std::mutex> lock(mutex_lock);
-  return stats_data.counters[index];
+  return iwl_stats_sum_counter(index);
+}
+
+size_t iwl_stats_read_hist(enum iwl_stats_histogram_index index, size_t bucket) {
+  ZX_ASSERT(index < IWL_STATS_HIST_MAX);
+  ZX_ASSERT(bucket < IWL_STATS_HIST_BUCKETS);
+
+  return iwl_stats_sum_hist(index, bucket);
 }
 
 void iwl_stats_inc(enum iwl_stats_counter_index index) {
   ZX_ASSERT(index < IWL_STATS_CNT_MAX);
 
-  const std::lock_guard<std::mutex> lock(mutex_lock);
-  stats_data.counters[index]++;
+  iwl_stats_get_shard()->counters[index].fetch_add(1, std::memory_order_relaxed);
+}
+
+void iwl_stats_hist_add(enum iwl_stats_histogram_index index, uint64_t value) {
+  ZX_ASSERT(index < IWL_STATS_HIST_MAX);
+
+  iwl_stats_get_shard()->hists[index][iwl_stats_hist_bucket(value)].fetch_add(
+      1, std::memory_order_relaxed);
 }
 
 void iwl_stats_analyze_rx(const wlan_rx_packet_t* pkt) {
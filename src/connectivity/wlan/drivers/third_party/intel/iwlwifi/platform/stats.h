@@ -28,12 +28,32 @@ enum iwl_stats_counter_index {
   IWL_STATS_CNT_DATA_FROM_MLME,    // Data from the MLME
   IWL_STATS_CNT_DATA_TO_FW,        // Data sent to the firmware
   IWL_STATS_CNT_CMD_TO_FW,         // Host commands sent to the firmware
+  IWL_STATS_CNT_TX_SLAB_EXHAUSTED, // TX buffers allocated because the TXQ slab was empty
   IWL_STATS_CNT_MAX,               // Always at the end of list.
 };
 
+enum iwl_stats_histogram_index {
+  IWL_STATS_HIST_TX_LATENCY_US = 0,  // TX frame enqueue to reclaim latency, in usec
+  IWL_STATS_HIST_RX_BATCH,           // RBs handled per RX queue interrupt
+  IWL_STATS_HIST_TXQ_OCCUPANCY,      // TFDs in use on a data TXQ after an enqueue
+  IWL_STATS_HIST_HCMD_RTT_US,        // Host command enqueue to completion latency, in usec
+  IWL_STATS_HIST_MAX,                // Always at the end of list.
+};
+
+// The histograms are log2-bucketed: bucket 0 counts the value 0, bucket n counts the values in
+// [2^(n-1), 2^n), and the last bucket counts everything larger.
+#define IWL_STATS_HIST_BUCKETS 24
+
+struct driver_inspector;
+
 // Initialize the feature.
 void iwl_stats_init(async_dispatcher_t* dispatcher);
 
+// Publish the statistics under the "stats" node of the Inspect tree, replacing any previous
+// publication.  The Inspect values are refreshed by the periodical task.  A NULL `inspector`
+// removes the publication.
+void iwl_stats_publish(struct driver_inspector* inspector);
+
 // Start the periodical task to print the statistics data to the log.
 void iwl_stats_start_reporting(void);
 
@@ -43,10 +63,14 @@ void iwl_stats_update_date_rate(uint32_t data_rate);
 
 // For testing.
 size_t iwl_stats_read(enum iwl_stats_counter_index index);
+size_t iwl_stats_read_hist(enum iwl_stats_histogram_index index, size_t bucket);
 
 // Increase one for a counter.
 void iwl_stats_inc(enum iwl_stats_counter_index index);
 
+// Record one sample in a histogram.
+void iwl_stats_hist_add(enum iwl_stats_histogram_index index, uint64_t value);
+
 // Analyze the WiFi packet and increase the corresponding counter.
 void iwl_stats_analyze_rx(const wlan_rx_packet_t* pkt);
 
@@ -18,6 +18,7 @@ enum TaskState : zx_futex_t {
   kIdle = 1,
   kQueued = 2,
   kExecuting = 3,
+  kExecutingPosted = 4,  // Posted again while executing, to be queued once the function returns.
 };
 
 }  // namespace
@@ -32,6 +33,24 @@ TaskInternal::TaskInternal(async_dispatcher_t* dispatcher, FuncType func, void*
     if (status == ZX_OK) {
       state_ref.store(TaskState::kExecuting, std::memory_order_release);
       (*task_internal->func_)(task_internal->data_);
+
+      // A Post() made while the function was executing is honored now, so that its work is not
+      // lost.  Cancel() may drop that post concurrently, hence the loop.
+      zx_futex_t expected = TaskState::kExecuting;
+      while (!state_ref.compare_exchange_strong(expected, TaskState::kIdle,
+                                                std::memory_order_acq_rel)) {
+        ZX_DEBUG_ASSERT(expected == TaskState::kExecutingPosted);
+        if (state_ref.compare_exchange_strong(expected, TaskState::kQueued,
+                                              std::memory_order_acq_rel)) {
+          task_internal->deadline =
+              async_now(dispatcher) +
+              task_internal->posted_delay_.load(std::memory_order_relaxed);
+          if (async_post_task(dispatcher, task_internal) == ZX_OK) {
+            return;
+          }
+          break;
+        }
+      }
     }
 
     state_ref.store(TaskState::kIdle, std::memory_order_release);
@@ -47,8 +66,9 @@ TaskInternal::~TaskInternal() {
 zx_status_t TaskInternal::Post(zx_duration_t delay) {
   zx_status_t status = ZX_OK;
 
-  // The async_dpsatcher interface does not allow tasks to be multiply posted.
-  if ((status = CancelSync()) != ZX_OK) {
+  // The async_dpsatcher interface does not allow tasks to be multiply posted.  This does not wait
+  // for an execution in progress, so that the task function can post its own task.
+  if ((status = Cancel()) != ZX_OK) {
     if (status != ZX_ERR_NOT_FOUND) {
       return status;
     }
@@ -57,9 +77,20 @@ zx_status_t TaskInternal::Post(zx_duration_t delay) {
   zx_futex_t expected = TaskState::kIdle;
   zx_futex_t desired = TaskState::kQueued;
   cpp20::atomic_ref<zx_futex_t> state_ref(state_);
-  if (!state_ref.compare_exchange_strong(expected, desired, std::memory_order_acq_rel)) {
-    // Post() is being called simultaneously from multiple threads, so we just early-return the
-    // calls after the first.
+  while (!state_ref.compare_exchange_strong(expected, desired, std::memory_order_acq_rel)) {
+    if (expected == TaskState::kExecuting) {
+      // The task is executing: have the handler post it again once the function returns.  If the
+      // function returns first, the task is idle again and we post it from here instead.
+      posted_delay_.store(delay, std::memory_order_relaxed);
+      if (state_ref.compare_exchange_strong(expected, TaskState::kExecutingPosted,
+                                            std::memory_order_acq_rel) ||
+          expected != TaskState::kIdle) {
+        return ZX_OK;
+      }
+      continue;
+    }
+    // Otherwise Post() is being called simultaneously from multiple threads, so we just
+    // early-return the calls after the first.
     return ZX_OK;
   }
 
@@ -94,12 +125,19 @@ zx_status_t TaskInternal::Wait() {
 }
 
 zx_status_t TaskInternal::Cancel() {
+  cpp20::atomic_ref<zx_futex_t> state_ref(state_);
   zx_status_t status = async_cancel_task(dispatcher_, this);
   if (status != ZX_OK) {
+    // The task may be executing, with a pending post to drop.
+    zx_futex_t expected = TaskState::kExecutingPosted;
+    if (status == ZX_ERR_NOT_FOUND &&
+        state_ref.compare_exchange_strong(expected, TaskState::kExecuting,
+                                          std::memory_order_acq_rel)) {
+      return ZX_OK;
+    }
     return status;
   }
 
-  cpp20::atomic_ref<zx_futex_t> state_ref(state_);
   ZX_DEBUG_ASSERT(state_ref.load() == TaskState::kQueued);
   state_ref.store(TaskState::kIdle, std::memory_order_release);
   zx_futex_wake(&state_, std::numeric_limits<uint32_t>::max());
@@ -111,11 +149,14 @@ zx_status_t TaskInternal::CancelSync() {
   // Cancel the task.
   zx_status_t status = ZX_OK;
   if ((status = Cancel()) != ZX_OK) {
-    return status;
+    if (status != ZX_ERR_NOT_FOUND) {
+      return status;
+    }
   }
 
-  // Now wait for completion.
-  return Wait();
+  // The task may have been dequeued already, and be executing: wait for it to return.
+  zx_status_t wait_status = Wait();
+  return wait_status != ZX_OK ? wait_status : status;
 }
 
 }  // namespace wlan::iwlwifi
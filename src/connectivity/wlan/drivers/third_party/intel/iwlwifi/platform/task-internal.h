@@ -11,6 +11,8 @@
 #include <zircon/time.h>
 #include <zircon/types.h>
 
+#include <atomic>
+
 namespace wlan::iwlwifi {
 
 // Internal implementation of a task that runs on an async_dispatcher_t.
@@ -20,22 +22,24 @@ class TaskInternal : private async_task_t {
   // Create the task.
   explicit TaskInternal(async_dispatcher_t* dispatcher, FuncType func, void* data);
 
-  // Delete the task.  The task will be cancelled synchronously before deletion.
+  // Delete the task.  The task will be cancelled synchronously before deletion, see CancelSync().
   ~TaskInternal();
 
-  // Post the task, to be run after `delay`.
+  // Post the task, to be run after `delay`.  If the task is executing, it is posted again once it
+  // returns; posts made during one execution are coalesced into one.
   zx_status_t Post(zx_duration_t delay);
 
   // Wait for the task to complete.  If the task has not been posted, return immediately.
   zx_status_t Wait();
 
   // Cancel the task, non-blocking.  May return:
-  // * ZX_OK if the task was cancelled.
+  // * ZX_OK if the task was cancelled, or if the post made while it is executing was dropped.
   // * ZX_ERR_NOT_FOUND if the task was not queued and thus not cancelled.
   // * Other errors in other error cases.
   zx_status_t Cancel();
 
-  // Cancel the task, blocking.
+  // Cancel the task, blocking: once this call returns, the task is neither queued nor executing.
+  // Returns the same values as Cancel().  Must not be called from the task function itself.
   zx_status_t CancelSync();
 
  private:
@@ -43,6 +47,8 @@ class TaskInternal : private async_task_t {
   FuncType const func_ = nullptr;
   void* const data_ = nullptr;
   zx_futex_t state_ = 0;
+  // The delay of a Post() made while the task is executing.
+  std::atomic<zx_duration_t> posted_delay_{0};
 };
 
 }  // namespace wlan::iwlwifi
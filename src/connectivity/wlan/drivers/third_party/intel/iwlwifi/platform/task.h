@@ -25,7 +25,7 @@ zx_status_t iwl_task_create(struct device* dev, iwl_task_func func, void* data,
                             struct iwl_task** out_task);
 
 // Post the task to the work queue dispatcher, to be run after `delay`.  If the task is already
-// posted, it will be cancelled first.
+// posted, it will be cancelled first.  If it is executing, it will be posted again once it returns.
 zx_status_t iwl_task_post(struct iwl_task* task, zx_duration_t delay);
 
 // Wait for the task to complete.  If the task has not been posted, it will return immediately.
@@ -46,8 +46,8 @@ zx_status_t iwl_task_cancel(struct iwl_task* task);
 // * Other errors in other error cases.
 zx_status_t iwl_task_cancel_sync(struct iwl_task* task);
 
-// Release (and deallocate) the task, synchronously.  If the task is running, it will be
-// synchronously.
+// Release (and deallocate) the task, synchronously.  If the task is queued, it will be cancelled;
+// if it is running, this call blocks until it returns.
 void iwl_task_release_sync(struct iwl_task* task);
 
 #if defined(__cplusplus)
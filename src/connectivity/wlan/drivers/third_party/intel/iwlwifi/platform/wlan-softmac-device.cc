@@ -87,7 +87,9 @@ zx_status_t WlanSoftmacDevice::WlanSoftmacQueueTx(const wlan_tx_packet_t* packet
                                                   bool* out_enqueue_pending) {
   iwl_stats_inc(IWL_STATS_CNT_DATA_FROM_MLME);
 
-  // Delayed transmission is never used right now.
+  // Delayed transmission is never used right now: a frame is either handed to the transport (which
+  // may hold back its doorbell for a short while, see iwl_pcie_txq_batch_add()) or rejected. A full
+  // hardware queue is reported as ZX_ERR_SHOULD_WAIT.
   *out_enqueue_pending = false;
 
   if (ap_mvm_sta_ == nullptr) {
@@ -250,9 +252,8 @@ zx_status_t WlanSoftmacDevice::WlanSoftmacStartActiveScan(
 
 zx_status_t WlanSoftmacDevice::WlanSoftmacUpdateWmmParams(wlan_ac_t ac,
                                                           const wlan_wmm_params_t* params) {
-  IWL_ERR(this, "%s() needs porting\n", __func__);
   CHECK_DELETE_IN_PROGRESS_WITH_ERRCODE(mvmvif_);
-  return ZX_ERR_NOT_SUPPORTED;
+  return mac_update_wmm_params(mvmvif_, ac, params);
 }
 
 void WlanSoftmacDevice::DdkInit(ddk::InitTxn txn) {
@@ -0,0 +1,611 @@
+// Copyright 2022 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Throughput benchmark for the datapath: synthetic frames go through the real MVM and PCIe
+// transport code, on top of the simulated firmware and a fake DMA engine.
+//
+// Every iteration is one frame. A TX frame goes through iwl_mvm_tx_skb() into iwl_trans_pcie_tx(),
+// and is completed by iwl_trans_pcie_reclaim() in batches, as the TX responses would. An RX frame
+// is written into the next RX buffer as the firmware would DMA it, and an ICT interrupt at the end
+// of every batch hands it to iwl_pcie_rx_handle_rb(), iwl_mvm_rx_mpdu_mq() and
+// iwl_mvm_create_packet().
+//
+// perftest reports the time per frame. With --counters-out=<file>, the frames per second, and the
+// allocations and mutex acquisitions per frame on the benchmark thread, are written to <file> in
+// the same JSON format. Without arguments it runs as a quick unit test.
+
+#include <lib/async-loop/cpp/loop.h>
+#include <lib/async-loop/default.h>
+#include <lib/fake-bti/bti.h>
+#include <stdio.h>
+#include <string.h>
+#include <threads.h>
+#include <zircon/assert.h>
+#include <zircon/status.h>
+#include <zircon/syscalls.h>
+
+#include <iterator>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <perftest/perftest.h>
+#include <perftest/results.h>
+
+extern "C" {
+#include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/fw/api/commands.h"
+#include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/fw/api/rx.h"
+#include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/fw/img.h"
+#include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/iwl-csr.h"
+#include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/mvm/mvm.h"
+}
+#include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/pcie/internal.h"
+#include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/align.h"
+#include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/ieee80211.h"
+#include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/memory.h"
+#include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/test/sim-trans.h"
+#include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/test/tlv-fw-builder.h"
+#include "src/devices/testing/mock-ddk/mock-device.h"
+
+namespace {
+
+// The allocations and mutex acquisitions made on the calling thread. The calls of the driver (and
+// of this file) are redirected to the wrappers below at link time, see the "datapath_benchmark"
+// target.
+thread_local uint64_t thread_allocs = 0;
+thread_local uint64_t thread_locks = 0;
+
+}  // namespace
+
+extern "C" {
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t nmemb, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+int __real_mtx_lock(mtx_t* mtx);
+int __real_mtx_trylock(mtx_t* mtx);
+
+void* __wrap_malloc(size_t size) {
+  ++thread_allocs;
+  return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t nmemb, size_t size) {
+  ++thread_allocs;
+  return __real_calloc(nmemb, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+  ++thread_allocs;
+  return __real_realloc(ptr, size);
+}
+
+int __wrap_mtx_lock(mtx_t* mtx) __TA_NO_THREAD_SAFETY_ANALYSIS {
+  ++thread_locks;
+  return __real_mtx_lock(mtx);
+}
+
+int __wrap_mtx_trylock(mtx_t* mtx) __TA_NO_THREAD_SAFETY_ANALYSIS {
+  ++thread_locks;
+  return __real_mtx_trylock(mtx);
+}
+
+}  // extern "C"
+
+// The C++ allocations do not go through the wrapped malloc(), since operator new lives in the C++
+// runtime library.
+void* operator new(size_t size) {
+  ++thread_allocs;
+  void* ptr = __real_malloc(size ? size : 1);
+  ZX_ASSERT(ptr);
+  return ptr;
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+
+namespace wlan::testing {
+namespace {
+
+// The data queue that all the frames of the station are sent on.
+constexpr int kTxQueue = IWL_MVM_DQA_MIN_DATA_QUEUE;
+
+// The number of frames completed by one TX response, and delivered by one RX interrupt.
+constexpr size_t kTxBatch = 32;
+constexpr size_t kRxBatch = 32;
+
+constexpr uint8_t kChannel = 11;
+constexpr uint8_t kApAddr[ETH_ALEN] = {0x02, 0x03, 0x04, 0x05, 0x06, 0x07};
+constexpr uint8_t kOwnAddr[ETH_ALEN] = {0x11, 0x22, 0x33, 0x44, 0x55, 0x66};
+
+constexpr uint16_t kFcData = 0x0008;
+constexpr uint16_t kFcQosData = 0x0088;
+constexpr uint16_t kFcToDs = 0x0100;
+constexpr uint16_t kFcFromDs = 0x0200;
+constexpr uint16_t kFcProtected = 0x4000;
+
+enum class Direction { kTx, kRx };
+
+struct FrameConfig {
+  std::string name;
+  Direction direction;
+  // A QoS data frame has a 26-byte MAC header, which the firmware pads to 4 bytes on RX.
+  bool qos;
+  // The frame is protected, with a CCMP header between the MAC header and the body.
+  bool ccmp;
+  // The size of the MAC header and body, as exchanged with MLME.
+  size_t size;
+};
+
+// What one benchmark case measured, over all of its frames.
+struct CaseCounts {
+  uint64_t frames = 0;
+  uint64_t allocs = 0;
+  uint64_t locks = 0;
+  zx_duration_t elapsed = 0;
+};
+
+// The counts of every case that ran, by name.
+std::map<std::string, CaseCounts> case_counts;
+
+// Snapshots the counters of the calling thread, to attribute the difference to a benchmark case.
+class CountScope {
+ public:
+  CountScope()
+      : allocs_(thread_allocs), locks_(thread_locks), start_(zx_clock_get_monotonic()) {}
+
+  void Record(const std::string& name, uint64_t frames) const {
+    CaseCounts& counts = case_counts[name];
+    counts.frames += frames;
+    counts.allocs += thread_allocs - allocs_;
+    counts.locks += thread_locks - locks_;
+    counts.elapsed += zx_clock_get_monotonic() - start_;
+  }
+
+ private:
+  uint64_t allocs_;
+  uint64_t locks_;
+  zx_time_t start_;
+};
+
+void CheckOk(zx_status_t status, const char* what) {
+  ZX_ASSERT_MSG(status == ZX_OK, "%s failed: %s", what, zx_status_get_string(status));
+}
+
+// Build the MAC header and body of a data frame from 'from' to 'to', as exchanged with MLME.
+std::vector<uint8_t> BuildFrame(const FrameConfig& config, const uint8_t* to, const uint8_t* from,
+                                uint16_t ds_bits) {
+  std::vector<uint8_t> frame(config.size, 0xa5);
+  auto hdr = reinterpret_cast<struct ieee80211_frame_header*>(frame.data());
+  hdr->frame_ctrl =
+      (config.qos ? kFcQosData : kFcData) | ds_bits | (config.ccmp ? kFcProtected : 0);
+  const size_t header_len = ieee80211_get_header_len(hdr);
+  ZX_ASSERT(config.size > header_len);
+  memset(frame.data() + sizeof(hdr->frame_ctrl), 0, header_len - sizeof(hdr->frame_ctrl));
+  memcpy(hdr->addr1, to, ETH_ALEN);
+  memcpy(hdr->addr2, from, ETH_ALEN);
+  memcpy(hdr->addr3, kApAddr, ETH_ALEN);
+  return frame;
+}
+
+// The driver of a client associated to an AP, with the MVM running on the simulated firmware and
+// the PCIe transport running on fake registers and DMA. The MVM's TX goes to the PCIe transport,
+// and the PCIe transport's RX goes to the MVM.
+class Datapath {
+ public:
+  Datapath();
+  ~Datapath();
+
+  bool Tx(perftest::RepeatState* state, const FrameConfig& config);
+  bool Rx(perftest::RepeatState* state, const FrameConfig& config);
+
+ private:
+  void InitPcie();
+  void InitStation();
+
+  static zx_status_t ForwardTx(struct iwl_trans* trans, struct ieee80211_mac_packet* pkt,
+                               const struct iwl_device_cmd* dev_cmd, int txq_id) {
+    auto datapath = reinterpret_cast<Datapath*>(IWL_TRANS_GET_SIM_TRANS(trans)->test);
+    return iwl_trans_pcie_tx(datapath->pcie_trans_, pkt, dev_cmd, txq_id);
+  }
+
+  // Write an RX packet into the 'index'-th buffer of the RX ring, as the firmware would DMA it.
+  void DmaRxPacket(uint32_t index, const std::vector<uint8_t>& rx_packet);
+
+  // Tell the driver that the firmware has filled the next 'count' RX buffers.
+  void RaiseRxInterrupt(uint32_t count);
+
+  // The simulated firmware, which the MVM is started on.
+  std::shared_ptr<MockDevice> fake_parent_;
+  SimTransport sim_trans_;
+  struct iwl_trans_ops* sim_ops_ = nullptr;
+  struct iwl_trans_ops forward_ops_ = {};
+  struct iwl_mvm* mvm_ = nullptr;
+
+  // The PCIe transport, with no-op register accesses.
+  std::unique_ptr<::async::Loop> task_loop_;
+  std::unique_ptr<::async::Loop> irq_loop_;
+  struct iwl_pci_dev pci_dev_ = {};
+  struct iwl_base_params base_params_ = {};
+  struct iwl_cfg cfg_ = {};
+  struct iwl_trans_ops pcie_ops_ = {};
+  struct iwl_trans* pcie_trans_ = nullptr;
+
+  // The interface and the AP station, as iwl_mvm_mac_add_interface() and iwl_mvm_add_sta() would
+  // have set them up.
+  struct iwl_mvm_vif* mvmvif_ = nullptr;
+  wlan_softmac_ifc_protocol_ops_t ifc_ops_ = {};
+  struct iwl_mvm_sta sta_ = {};
+  struct ieee80211_key_conf* key_conf_ = nullptr;
+
+  // The number of frames passed to MLME.
+  size_t received_ = 0;
+};
+
+Datapath::Datapath() : fake_parent_(MockDevice::FakeRootParent()), sim_trans_(fake_parent_.get()) {
+  // A firmware supporting the multi-queue RX API, which iwl_mvm_rx_mpdu_mq() is part of.
+  TlvFwBuilder fw_builder;
+  const uint32_t dummy_ucode = 0;
+  fw_builder.AddValue(IWL_UCODE_TLV_SEC_INIT, &dummy_ucode, sizeof(dummy_ucode));
+  fw_builder.AddValue(IWL_UCODE_TLV_INST, &dummy_ucode, sizeof(dummy_ucode));
+  fw_builder.AddValue(IWL_UCODE_TLV_DATA, &dummy_ucode, sizeof(dummy_ucode));
+  fw_builder.AddValue(IWL_UCODE_TLV_INIT, &dummy_ucode, sizeof(dummy_ucode));
+  fw_builder.AddValue(IWL_UCODE_TLV_INIT_DATA, &dummy_ucode, sizeof(dummy_ucode));
+  const struct iwl_ucode_capa ucode_capa = {
+      .api_index = cpu_to_le32(IWL_UCODE_TLV_CAPA_MULTI_QUEUE_RX_SUPPORT / 32),
+      .api_capa = cpu_to_le32(BIT(IWL_UCODE_TLV_CAPA_MULTI_QUEUE_RX_SUPPORT % 32)),
+  };
+  fw_builder.AddValue(IWL_UCODE_TLV_ENABLED_CAPABILITIES, &ucode_capa, sizeof(ucode_capa));
+  const uint32_t ucode_phy_sku =
+      cpu_to_le32((3 << FW_PHY_CFG_TX_CHAIN_POS) |  // Tx antenna 1 and 0.
+                  (6 << FW_PHY_CFG_RX_CHAIN_POS));  // Rx antenna 2 and 1.
+  fw_builder.AddValue(IWL_UCODE_TLV_PHY_SKU, &ucode_phy_sku, sizeof(ucode_phy_sku));
+  fake_parent_->SetFirmware(fw_builder.GetBinary());
+
+  CheckOk(sim_trans_.Init(), "SimTransport::Init()");
+  mvm_ = iwl_trans_get_mvm(sim_trans_.iwl_trans());
+  ZX_ASSERT(iwl_mvm_has_new_rx_api(mvm_));
+
+  InitPcie();
+  InitStation();
+
+  // Route the MVM's TX to the PCIe transport, and the PCIe transport's RX to the MVM.
+  struct iwl_trans* sim_trans = sim_trans_.iwl_trans();
+  sim_ops_ = sim_trans->ops;
+  forward_ops_ = *sim_ops_;
+  forward_ops_.tx = ForwardTx;
+  sim_trans->ops = &forward_ops_;
+  IWL_TRANS_GET_SIM_TRANS(sim_trans)->test = this;
+  pcie_trans_->op_mode = sim_trans->op_mode;
+}
+
+Datapath::~Datapath() {
+  struct iwl_trans* sim_trans = sim_trans_.iwl_trans();
+  sim_trans->ops = sim_ops_;
+  IWL_TRANS_GET_SIM_TRANS(sim_trans)->test = nullptr;
+  pcie_trans_->op_mode = nullptr;
+
+  mvm_->fw_id_to_mac_id[0] = nullptr;
+  mvm_->mvmvif[0] = nullptr;
+  mvm_->vif_count--;
+  for (size_t i = 0; i < std::size(sta_.txq); ++i) {
+    free(sta_.txq[i]);
+  }
+  free(sta_.dup_data);
+  free(key_conf_);
+  free(mvmvif_);
+
+  iwl_pcie_rx_free(pcie_trans_);
+  iwl_pcie_tx_free(pcie_trans_);
+  iwl_pcie_free_ict(pcie_trans_);
+  iwl_trans_free(pcie_trans_);
+  zx_handle_close(pci_dev_.dev.bti);
+}
+
+void Datapath::InitPcie() {
+  task_loop_ = std::make_unique<::async::Loop>(&kAsyncLoopConfigNoAttachToCurrentThread);
+  CheckOk(task_loop_->StartThread("iwlwifi-benchmark-task-worker", nullptr), "StartThread()");
+  irq_loop_ = std::make_unique<::async::Loop>(&kAsyncLoopConfigNoAttachToCurrentThread);
+  CheckOk(irq_loop_->StartThread("iwlwifi-benchmark-irq-worker", nullptr), "StartThread()");
+  pci_dev_.dev.task_dispatcher = task_loop_->dispatcher();
+  pci_dev_.dev.irq_dispatcher = irq_loop_->dispatcher();
+  CheckOk(fake_bti_create(&pci_dev_.dev.bti), "fake_bti_create()");
+
+  pcie_ops_.write8 = [](struct iwl_trans* trans, uint32_t ofs, uint8_t val) {};
+  pcie_ops_.write32 = [](struct iwl_trans* trans, uint32_t ofs, uint32_t val) {};
+  pcie_ops_.read32 = [](struct iwl_trans* trans, uint32_t ofs) -> uint32_t { return 0; };
+  pcie_ops_.read_prph = [](struct iwl_trans* trans, uint32_t ofs) -> uint32_t { return 0; };
+  pcie_ops_.write_prph = [](struct iwl_trans* trans, uint32_t ofs, uint32_t val) {};
+  pcie_ops_.read_mem = [](struct iwl_trans* trans, uint32_t addr, void* buf,
+                          size_t dwords) -> zx_status_t { return ZX_ERR_NOT_SUPPORTED; };
+  pcie_ops_.write_mem = [](struct iwl_trans* trans, uint32_t addr, const void* buf,
+                           size_t dwords) -> zx_status_t { return ZX_ERR_NOT_SUPPORTED; };
+  pcie_ops_.grab_nic_access = [](struct iwl_trans* trans, unsigned long* flags) { return true; };
+  pcie_ops_.release_nic_access = [](struct iwl_trans* trans, unsigned long* flags) {};
+  pcie_ops_.ref = [](struct iwl_trans* trans) {};
+  pcie_ops_.unref = [](struct iwl_trans* trans) {};
+
+  base_params_.num_of_queues = 31;
+  base_params_.max_tfd_queue_size = 256;
+  cfg_.base_params = &base_params_;
+  pcie_trans_ = iwl_trans_alloc(sizeof(struct iwl_trans_pcie), &pci_dev_.dev, &cfg_, &pcie_ops_);
+  ZX_ASSERT(pcie_trans_);
+  struct iwl_trans_pcie* trans_pcie = IWL_TRANS_GET_PCIE_TRANS(pcie_trans_);
+  trans_pcie->pci_dev = &pci_dev_;
+  trans_pcie->tfd_size = sizeof(struct iwl_tfh_tfd);
+  trans_pcie->rx_buf_size = IWL_AMSDU_4K;
+  trans_pcie->use_ict = true;
+  trans_pcie->inta_mask = CSR_INI_SET_MASK;
+  pcie_trans_->num_rx_queues = 1;
+  set_bit(STATUS_DEVICE_ENABLED, &pcie_trans_->status);
+
+  CheckOk(iwl_pcie_alloc_ict(pcie_trans_), "iwl_pcie_alloc_ict()");
+  CheckOk(iwl_pcie_rx_init(pcie_trans_), "iwl_pcie_rx_init()");
+  CheckOk(iwl_pcie_tx_init(pcie_trans_), "iwl_pcie_tx_init()");
+  iwl_trans_txq_scd_cfg scd_cfg = {};
+  const bool failed =
+      iwl_trans_pcie_txq_enable(pcie_trans_, kTxQueue, /*ssn*/ 0, &scd_cfg, /*wdg_timeout*/ 0);
+  ZX_ASSERT(!failed);
+}
+
+void Datapath::InitStation() {
+  mvmvif_ = reinterpret_cast<struct iwl_mvm_vif*>(calloc(1, sizeof(struct iwl_mvm_vif)));
+  ZX_ASSERT(mvmvif_);
+  mvmvif_->mvm = mvm_;
+  mvmvif_->mac_role = WLAN_MAC_ROLE_CLIENT;
+  ifc_ops_.recv = [](void* ctx, const wlan_rx_packet_t* packet) {
+    ++*reinterpret_cast<size_t*>(ctx);
+  };
+  mvmvif_->ifc.ops = &ifc_ops_;
+  mvmvif_->ifc.ctx = &received_;
+  mvm_->mvmvif[0] = mvmvif_;
+  mvm_->vif_count++;
+
+  sta_.sta_id = 0;
+  sta_.mvmvif = mvmvif_;
+  memcpy(sta_.addr, kApAddr, sizeof(sta_.addr));
+  for (size_t i = 0; i < std::size(sta_.tid_data); ++i) {
+    sta_.tid_data[i].txq_id = kTxQueue;
+  }
+  for (size_t i = 0; i < std::size(sta_.txq); ++i) {
+    sta_.txq[i] = reinterpret_cast<struct iwl_mvm_txq*>(calloc(1, sizeof(struct iwl_mvm_txq)));
+    ZX_ASSERT(sta_.txq[i]);
+  }
+  for (size_t i = 0; i < std::size(sta_.tid_to_baid); ++i) {
+    sta_.tid_to_baid[i] = IWL_RX_REORDER_DATA_INVALID_BAID;
+  }
+  sta_.dup_data = reinterpret_cast<struct iwl_mvm_rxq_dup_data*>(
+      calloc(mvm_->trans->num_rx_queues, sizeof(struct iwl_mvm_rxq_dup_data)));
+  ZX_ASSERT(sta_.dup_data);
+  for (int q = 0; q < mvm_->trans->num_rx_queues; ++q) {
+    memset(sta_.dup_data[q].last_seq, 0xff, sizeof(sta_.dup_data[q].last_seq));
+  }
+  mvm_->fw_id_to_mac_id[0] = &sta_;
+
+  key_conf_ = reinterpret_cast<struct ieee80211_key_conf*>(
+      calloc(1, sizeof(struct ieee80211_key_conf) + 16));
+  ZX_ASSERT(key_conf_);
+  key_conf_->cipher = CIPHER_SUITE_TYPE_CCMP_128;
+  key_conf_->key_type = 1;
+  key_conf_->keylen = 16;
+}
+
+bool Datapath::Tx(perftest::RepeatState* state, const FrameConfig& config)
+    __TA_NO_THREAD_SAFETY_ANALYSIS {
+  std::vector<uint8_t> frame = BuildFrame(config, kApAddr, kOwnAddr, kFcToDs);
+  struct ieee80211_mac_packet pkt = {};
+  pkt.common_header = reinterpret_cast<struct ieee80211_frame_header*>(frame.data());
+  pkt.header_size = ieee80211_get_header_len(pkt.common_header);
+  pkt.body = frame.data() + pkt.header_size;
+  pkt.body_size = frame.size() - pkt.header_size;
+  if (config.ccmp) {
+    pkt.info.control.hw_key = key_conf_;
+  }
+
+  struct iwl_txq* txq = IWL_TRANS_GET_PCIE_TRANS(pcie_trans_)->txq[kTxQueue];
+  bool ok = true;
+  uint64_t frames = 0;
+
+  mtx_lock(&mvm_->mutex);
+  CountScope scope;
+  while (state->KeepRunning()) {
+    // iwl_mvm_tx_skb() inserts the CCMP header into the headroom of the packet.
+    pkt.headroom_used_size = 0;
+    zx_status_t status = iwl_mvm_tx_skb(mvm_, &pkt, &sta_);
+    if (status != ZX_OK) {
+      fprintf(stderr, "iwl_mvm_tx_skb() failed: %s\n", zx_status_get_string(status));
+      ok = false;
+      break;
+    }
+    if (++frames % kTxBatch == 0) {
+      iwl_trans_pcie_reclaim(pcie_trans_, kTxQueue, txq->write_ptr);
+    }
+  }
+  iwl_trans_pcie_reclaim(pcie_trans_, kTxQueue, txq->write_ptr);
+  scope.Record(config.name, frames);
+  mtx_unlock(&mvm_->mutex);
+
+  return ok;
+}
+
+bool Datapath::Rx(perftest::RepeatState* state, const FrameConfig& config) {
+  // The RX packet the firmware sends for the frame: the MPDU descriptor, then the MAC header, the
+  // padding to 4 bytes, the CCMP header and the body.
+  std::vector<uint8_t> frame = BuildFrame(config, kOwnAddr, kApAddr, kFcFromDs);
+  const size_t header_len =
+      ieee80211_get_header_len(reinterpret_cast<struct ieee80211_frame_header*>(frame.data()));
+  const size_t pad_len = header_len % 4 ? 4 - header_len % 4 : 0;
+  const size_t crypt_len = config.ccmp ? fuchsia_wlan_ieee80211_CCMP_HDR_LEN : 0;
+  const size_t mpdu_len = frame.size() + pad_len + crypt_len;
+
+  std::vector<uint8_t> rx_packet(sizeof(struct iwl_rx_packet) + IWL_RX_DESC_SIZE_V1 + mpdu_len);
+  auto pkt = reinterpret_cast<struct iwl_rx_packet*>(rx_packet.data());
+  pkt->len_n_flags = cpu_to_le32(rx_packet.size() - sizeof(pkt->len_n_flags));
+  pkt->hdr.cmd = REPLY_RX_MPDU_CMD;
+  pkt->hdr.group_id = LEGACY_GROUP;
+  pkt->hdr.sequence = SEQ_RX_FRAME;
+
+  auto desc = reinterpret_cast<struct iwl_rx_mpdu_desc*>(pkt->data);
+  desc->mpdu_len = cpu_to_le16(mpdu_len);
+  desc->mac_flags2 = pad_len ? IWL_RX_MPDU_MFLG2_PAD : 0;
+  desc->status = IWL_RX_MPDU_STATUS_CRC_OK | IWL_RX_MPDU_STATUS_OVERRUN_OK |
+                 IWL_RX_MPDU_STATUS_SRC_STA_FOUND;
+  if (config.ccmp) {
+    desc->status |= IWL_RX_MPDU_STATUS_SEC_CCM | IWL_RX_MPDU_STATUS_MIC_OK;
+  }
+  desc->sta_id_flags = 0;  // sta_id
+  desc->reorder_data = IWL_RX_REORDER_DATA_INVALID_BAID << IWL_RX_MPDU_REORDER_BAID_SHIFT;
+  desc->v1.channel = kChannel;
+  desc->v1.energy_a = 0x7f;
+  desc->v1.energy_b = 0x28;
+  desc->v1.rate_n_flags = 0x820a;
+
+  uint8_t* mpdu = pkt->data + IWL_RX_DESC_SIZE_V1;
+  memcpy(mpdu, frame.data(), header_len);
+  memcpy(mpdu + header_len + pad_len + crypt_len, frame.data() + header_len,
+         frame.size() - header_len);
+  auto hdr = reinterpret_cast<struct ieee80211_frame_header*>(mpdu);
+
+  struct iwl_rxq* rxq = &IWL_TRANS_GET_PCIE_TRANS(pcie_trans_)->rxq[0];
+  uint32_t pending = 0;
+  size_t frames = 0;
+  received_ = 0;
+
+  CountScope scope;
+  while (state->KeepRunning()) {
+    hdr->seq_ctrl = static_cast<uint16_t>(IEEE80211_SN_TO_SEQ(frames));
+    DmaRxPacket((rxq->read + pending) & (rxq->queue_size - 1), rx_packet);
+    ++frames;
+    if (++pending == kRxBatch) {
+      RaiseRxInterrupt(pending);
+      pending = 0;
+    }
+  }
+  if (pending) {
+    RaiseRxInterrupt(pending);
+  }
+  scope.Record(config.name, frames);
+
+  if (received_ != frames) {
+    fprintf(stderr, "%zu of %zu RX frames passed to MLME\n", received_, frames);
+    return false;
+  }
+  return true;
+}
+
+void Datapath::DmaRxPacket(uint32_t index, const std::vector<uint8_t>& rx_packet) {
+  struct iwl_rx_mem_buffer* rxb = IWL_TRANS_GET_PCIE_TRANS(pcie_trans_)->rxq[0].queue[index];
+  ZX_ASSERT(rxb);
+  uint8_t* buf = static_cast<uint8_t*>(iwl_iobuf_virtual(rxb->io_buf));
+  memcpy(buf, rx_packet.data(), rx_packet.size());
+
+  // Mark the end of the packets in this buffer.
+  const size_t end = IWL_ALIGN(rx_packet.size(), FH_RSCSR_FRAME_ALIGN);
+  if (end + sizeof(uint32_t) <= iwl_iobuf_size(rxb->io_buf)) {
+    *reinterpret_cast<uint32_t*>(buf + end) = cpu_to_le32(FH_RSCSR_FRAME_INVALID);
+  }
+}
+
+void Datapath::RaiseRxInterrupt(uint32_t count) {
+  struct iwl_trans_pcie* trans_pcie = IWL_TRANS_GET_PCIE_TRANS(pcie_trans_);
+  struct iwl_rxq* rxq = &trans_pcie->rxq[0];
+  auto rb_status = static_cast<struct iwl_rb_status*>(iwl_iobuf_virtual(rxq->rb_status));
+  rb_status->closed_rb_num = cpu_to_le16((rxq->read + count) & (rxq->queue_size - 1));
+
+  uint32_t* ict_table = static_cast<uint32_t*>(iwl_iobuf_virtual(trans_pcie->ict_tbl));
+  trans_pcie->ict_index = 0;
+  ict_table[0] = static_cast<uint32_t>(CSR_INT_BIT_FH_RX) >> 16;
+  ict_table[1] = 0;
+  CheckOk(iwl_pcie_isr(pcie_trans_), "iwl_pcie_isr()");
+}
+
+// Set up in main(), as the cases share it.
+Datapath* datapath = nullptr;
+
+bool DatapathBenchmark(perftest::RepeatState* state, FrameConfig config) {
+  return config.direction == Direction::kTx ? datapath->Tx(state, config)
+                                            : datapath->Rx(state, config);
+}
+
+void RegisterTests() {
+  for (Direction direction : {Direction::kTx, Direction::kRx}) {
+    for (bool qos : {false, true}) {
+      for (bool ccmp : {false, true}) {
+        for (size_t size : {64, 512, 1500}) {
+          std::string name = std::string("Datapath/") +
+                             (direction == Direction::kTx ? "Tx/" : "Rx/") +
+                             (qos ? "QosData/" : "Data/") + (ccmp ? "Ccmp/" : "Open/") +
+                             std::to_string(size);
+          perftest::RegisterTest(name.c_str(), DatapathBenchmark,
+                                 FrameConfig{
+                                     .name = name,
+                                     .direction = direction,
+                                     .qos = qos,
+                                     .ccmp = ccmp,
+                                     .size = size,
+                                 });
+        }
+      }
+    }
+  }
+}
+PERFTEST_CTOR(RegisterTests)
+
+constexpr char kTestSuite[] = "fuchsia.wlan.iwlwifi.datapath";
+
+// Print the counts of every case, and write them to 'filename' if it is not empty.
+bool ReportCounts(const std::string& filename) {
+  perftest::ResultsSet results;
+  printf("\n%-36s %14s %14s %14s\n", "Case", "frames/s", "allocs/frame", "locks/frame");
+  for (const auto& [name, counts] : case_counts) {
+    if (!counts.frames || !counts.elapsed) {
+      continue;
+    }
+    const double frames = static_cast<double>(counts.frames);
+    const double frames_per_second = frames * ZX_SEC(1) / static_cast<double>(counts.elapsed);
+    const double allocs_per_frame = static_cast<double>(counts.allocs) / frames;
+    const double locks_per_frame = static_cast<double>(counts.locks) / frames;
+    printf("%-36s %14.0f %14.2f %14.2f\n", name.c_str(), frames_per_second, allocs_per_frame,
+           locks_per_frame);
+
+    results.AddTestCase(kTestSuite, (name + "/FramesPerSecond").c_str(), "frames/second")
+        ->AppendValue(frames_per_second);
+    results.AddTestCase(kTestSuite, (name + "/AllocsPerFrame").c_str(), "count_smallerIsBetter")
+        ->AppendValue(allocs_per_frame);
+    results.AddTestCase(kTestSuite, (name + "/LocksPerFrame").c_str(), "count_smallerIsBetter")
+        ->AppendValue(locks_per_frame);
+  }
+  return filename.empty() || results.WriteJSONFile(filename.c_str());
+}
+
+}  // namespace
+}  // namespace wlan::testing
+
+int main(int argc, char** argv) {
+  // Take --counters-out=<file> out of the arguments passed to perftest.
+  constexpr char kCountersOut[] = "--counters-out=";
+  std::string counters_out;
+  std::vector<char*> args;
+  for (int i = 0; i < argc; ++i) {
+    if (strncmp(argv[i], kCountersOut, strlen(kCountersOut)) == 0) {
+      counters_out = argv[i] + strlen(kCountersOut);
+    } else {
+      args.push_back(argv[i]);
+    }
+  }
+  args.push_back(nullptr);
+
+  auto datapath = std::make_unique<wlan::testing::Datapath>();
+  wlan::testing::datapath = datapath.get();
+  int ret = perftest::PerfTestMain(static_cast<int>(args.size() - 1), args.data(),
+                                   wlan::testing::kTestSuite);
+  wlan::testing::datapath = nullptr;
+  datapath.reset();
+
+  if (!wlan::testing::ReportCounts(counters_out)) {
+    fprintf(stderr, "Failed to write %s\n", counters_out.c_str());
+    return 1;
+  }
+  return ret;
+}
@@ -43,6 +43,7 @@ static std::string inspect_host_cmd_str(struct iwl_host_cmd* cmd) {
       // bit definition of 'enum CMD_MODE'
       "async",        "want_skb",        "send_in_rfkill", "high_prio",
       "send_in_idle", "make_trans_idle", "wake_up_trans",  "want_async_callback",
+      "pipelined",
   };
   const char* dataflags_defs[] = {
       // bit definition of 'enum iwl_hcmd_dataflag'
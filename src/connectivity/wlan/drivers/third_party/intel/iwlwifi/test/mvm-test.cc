@@ -3,10 +3,16 @@
 // found in the LICENSE file.
 
 #include <lib/mock-function/mock-function.h>
+#include <lib/sync/completion.h>
 #include <zircon/compiler.h>
+#include <zircon/syscalls.h>
 
+#include <chrono>
+#include <condition_variable>
 #include <iterator>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 #include <zxtest/zxtest.h>
 
@@ -16,6 +22,7 @@ extern "C" {
 }
 
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/ieee80211.h"
+#include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/irq.h"
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/memory.h"
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/stats.h"
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/test/fake-ucode-test.h"
@@ -989,6 +996,29 @@ TEST_F(PowerTest, PmHasNoEffect) {
 ///////////////////////////////////////////////////////////////////////////////
 //                               Txq Test
 //
+// A QoS data frame (or another frame with a QoS Control field, given in 'fc') for the given TID.
+class QosDataFrame {
+ public:
+  explicit QosDataFrame(uint8_t tid, uint16_t fc = 0x0088) {
+    frame_.hdr.frame_ctrl = fc;
+    frame_.qos_ctrl = tid;
+    pkt_.common_header = &frame_.hdr;
+    pkt_.header_size = sizeof(frame_.hdr) + sizeof(frame_.qos_ctrl);
+    pkt_.body = frame_.body;
+    pkt_.body_size = sizeof(frame_.body);
+  }
+
+  ieee80211_mac_packet* mac_pkt() { return &pkt_; }
+
+ private:
+  struct {
+    struct ieee80211_frame_header hdr;
+    uint16_t qos_ctrl;
+    uint8_t body[32];
+  } __packed frame_ = {};
+  ieee80211_mac_packet pkt_ = {};
+};
+
 class TxqTest : public MvmTest, public MockTrans {
  public:
   TxqTest()
@@ -1027,6 +1057,27 @@ class TxqTest : public MvmTest, public MockTrans {
                                WIDE_ID(dev_cmd->hdr.group_id, dev_cmd->hdr.cmd), txq_id);
   }
 
+  // Records what is handed to the transport for each frame.
+  struct SentFrame {
+    int txq_id;
+    uint8_t tid;
+    uint16_t sn;
+  };
+  std::vector<SentFrame> sent_;
+
+  static zx_status_t record_tx_wrapper(struct iwl_trans* trans, struct ieee80211_mac_packet* pkt,
+                                       const struct iwl_device_cmd* dev_cmd, int txq_id) {
+    auto test = GET_TEST(TxqTest, trans);
+    auto tx_cmd = reinterpret_cast<const struct iwl_tx_cmd*>(dev_cmd->payload);
+    auto hdr = reinterpret_cast<const struct ieee80211_frame_header*>(tx_cmd->hdr);
+    test->sent_.push_back({
+        .txq_id = txq_id,
+        .tid = tx_cmd->tid_tspec,
+        .sn = static_cast<uint16_t>(IEEE80211_SEQ_TO_SN(hdr->seq_ctrl)),
+    });
+    return ZX_OK;
+  }
+
  protected:
   struct iwl_mvm_sta sta_;
 };
@@ -1078,7 +1129,10 @@ TEST_F(TxqTest, TestAllocData) {
 }
 
 TEST_F(TxqTest, DataTxCmd) {
+  WlanPktBuilder builder;
+  std::shared_ptr<WlanPktBuilder::WlanPkt> wlan_pkt(builder.build());  // non-QoS data frame
   ieee80211_mac_packet pkt = {
+      .common_header = wlan_pkt->mac_pkt()->common_header,
       .body_size = 56,  // arbitrary value.
   };
   iwl_tx_cmd tx_cmd = {
@@ -1086,7 +1140,7 @@ TEST_F(TxqTest, DataTxCmd) {
   };
   iwl_mvm_set_tx_cmd(mvmvif_->mvm, &pkt, &tx_cmd, static_cast<uint8_t>(sta_.sta_id));
 
-  // Currently the function doesn't consider the QoS so that those values are just fixed value.
+  // Non-QoS frames use the MGMT TID and the sequence number is assigned by the firmware.
   EXPECT_EQ(TX_CMD_FLG_TSF | TX_CMD_FLG_SEQ_CTL | TX_CMD_FLG_BT_DIS | TX_CMD_FLG_ACK,
             tx_cmd.tx_flags);
 
@@ -1097,6 +1151,28 @@ TEST_F(TxqTest, DataTxCmd) {
   EXPECT_EQ(0, tx_cmd.sta_id);
 }
 
+TEST_F(TxqTest, QosDataTxCmd) {
+  QosDataFrame frame(6);
+  iwl_tx_cmd tx_cmd = {};
+  iwl_mvm_set_tx_cmd(mvmvif_->mvm, frame.mac_pkt(), &tx_cmd, static_cast<uint8_t>(sta_.sta_id));
+
+  // The TID comes from the QoS Control field and the driver assigns the sequence number.
+  EXPECT_EQ(6, tx_cmd.tid_tspec);
+  EXPECT_EQ(TX_CMD_FLG_BT_DIS | TX_CMD_FLG_ACK, tx_cmd.tx_flags);
+}
+
+TEST_F(TxqTest, TxTid) {
+  EXPECT_EQ(5, iwl_mvm_tx_get_tid(QosDataFrame(5).mac_pkt()->common_header));
+
+  // QoS Null frames and the TSPEC TIDs go to the MGMT TID.
+  EXPECT_EQ(IWL_MAX_TID_COUNT, iwl_mvm_tx_get_tid(QosDataFrame(5, 0x00c8).mac_pkt()->common_header));
+  EXPECT_EQ(IWL_MAX_TID_COUNT, iwl_mvm_tx_get_tid(QosDataFrame(9).mac_pkt()->common_header));
+
+  WlanPktBuilder builder;
+  std::shared_ptr<WlanPktBuilder::WlanPkt> wlan_pkt(builder.build());
+  EXPECT_EQ(IWL_MAX_TID_COUNT, iwl_mvm_tx_get_tid(wlan_pkt->mac_pkt()->common_header));
+}
+
 TEST_F(TxqTest, DataTxCmdRate) {
   iwl_tx_cmd tx_cmd = {};
   struct ieee80211_frame_header frame_hdr;
@@ -1169,6 +1245,73 @@ TEST_F(TxqTest, TxPkt) {
   unbindTx();
 }
 
+// A queue stopped by the transport pushes back on the caller until it is woken up again.
+TEST_F(TxqTest, TxPktStoppedQueue) {
+  WlanPktBuilder builder;
+  std::shared_ptr<WlanPktBuilder::WlanPkt> wlan_pkt(builder.build());
+
+  bindTx(tx_wrapper);
+  sta_.txq[fuchsia_wlan_ieee80211_TIDS_MAX]->stopped = true;
+  EXPECT_EQ(ZX_ERR_SHOULD_WAIT, iwl_mvm_tx_skb(mvm_, wlan_pkt->mac_pkt(), &sta_));
+
+  sta_.txq[fuchsia_wlan_ieee80211_TIDS_MAX]->stopped = false;
+  mock_tx_.ExpectCall(ZX_OK, wlan_pkt->len(), WIDE_ID(0, TX_CMD), 0);
+  EXPECT_EQ(ZX_OK, iwl_mvm_tx_skb(mvm_, wlan_pkt->mac_pkt(), &sta_));
+  mock_tx_.VerifyAndClear();
+  unbindTx();
+}
+
+// QoS data frames are sent on a queue of their own TID, with a sequence number counted per TID. The
+// queue is allocated off the TX path: until then, the frames go on the station's default queue.
+TEST_F(TxqTest, TxQosPktPerTidQueue) {
+  for (size_t tid = 0; tid < IWL_MAX_TID_COUNT; ++tid) {
+    sta_.tid_data[tid].txq_id = IWL_MVM_INVALID_QUEUE;
+  }
+  const uint16_t default_queue = sta_.tid_data[IWL_MAX_TID_COUNT].txq_id;
+
+  bindTx(record_tx_wrapper);
+  ASSERT_EQ(ZX_OK, iwl_mvm_tx_skb(mvm_, QosDataFrame(6).mac_pkt(), &sta_));  // AC_VO
+  ASSERT_EQ(ZX_OK, iwl_mvm_tx_skb(mvm_, QosDataFrame(1).mac_pkt(), &sta_));  // AC_BK
+  EXPECT_EQ(IWL_MVM_INVALID_QUEUE, sta_.tid_data[6].txq_id);
+  EXPECT_EQ(IWL_MVM_INVALID_QUEUE, sta_.tid_data[1].txq_id);
+  EXPECT_EQ(BIT(6) | BIT(1), static_cast<unsigned long>(sta_.deferred_traffic_tid_map));
+
+  // Let the worker allocate the queues.
+  mtx_unlock(&mvm_->mutex);
+  ASSERT_OK(iwl_task_wait(mvm_->add_stream_wk));
+  mtx_lock(&mvm_->mutex);
+  EXPECT_EQ(0, sta_.deferred_traffic_tid_map);
+
+  ASSERT_EQ(ZX_OK, iwl_mvm_tx_skb(mvm_, QosDataFrame(6).mac_pkt(), &sta_));
+  unbindTx();
+
+  // Each TID got a data queue of its own. The other TIDs are left alone.
+  const uint16_t vo_queue = sta_.tid_data[6].txq_id;
+  const uint16_t bk_queue = sta_.tid_data[1].txq_id;
+  EXPECT_TRUE(iwl_mvm_is_dqa_data_queue(mvm_, vo_queue));
+  EXPECT_TRUE(iwl_mvm_is_dqa_data_queue(mvm_, bk_queue));
+  EXPECT_NE(vo_queue, bk_queue);
+  EXPECT_EQ(IWL_MVM_INVALID_QUEUE, sta_.tid_data[0].txq_id);
+  EXPECT_EQ(6, mvm_->queue_info[vo_queue].txq_tid);
+  EXPECT_EQ(IEEE80211_AC_VO, mvm_->queue_info[vo_queue].mac80211_ac);
+  EXPECT_EQ(1, mvm_->queue_info[bk_queue].txq_tid);
+  EXPECT_EQ(IEEE80211_AC_BK, mvm_->queue_info[bk_queue].mac80211_ac);
+
+  // The sequence numbers are per TID, whichever queue the frames went on.
+  ASSERT_EQ(3, sent_.size());
+  EXPECT_EQ(default_queue, sent_[0].txq_id);
+  EXPECT_EQ(6, sent_[0].tid);
+  EXPECT_EQ(0, sent_[0].sn);
+  EXPECT_EQ(default_queue, sent_[1].txq_id);
+  EXPECT_EQ(1, sent_[1].tid);
+  EXPECT_EQ(0, sent_[1].sn);
+  EXPECT_EQ(vo_queue, sent_[2].txq_id);
+  EXPECT_EQ(6, sent_[2].tid);
+  EXPECT_EQ(1, sent_[2].sn);
+  EXPECT_EQ(IEEE80211_SN_TO_SEQ(2), sta_.tid_data[6].seq_number);
+  EXPECT_EQ(IEEE80211_SN_TO_SEQ(1), sta_.tid_data[1].seq_number);
+}
+
 // Check to see Tx params are set correctly based on frame control
 TEST_F(TxqTest, TxPktProtected) {
   // Send a protected data frame and see that the crypt header is being added
@@ -1196,6 +1339,412 @@ TEST_F(TxqTest, TxPktProtected) {
   free(key_conf);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+//                             Rx Reorder Test
+//
+// The RX reorder buffer and duplicate detection are only used with the multi-queue RX API.
+class RxReorderTest : public FakeUcodeTest {
+ public:
+  static constexpr uint8_t kTid = 5;
+  static constexpr uint8_t kBaid = kTid;  // the simulated firmware uses the TID as the BAID.
+  static constexpr uint16_t kSsn = 100;
+  static constexpr uint16_t kBufSize = 64;
+  static constexpr uint8_t kChannel = 11;
+  static constexpr size_t kMacPayloadLen = 60;
+
+  RxReorderTest() __TA_NO_THREAD_SAFETY_ANALYSIS
+      : FakeUcodeTest(IWL_UCODE_TLV_CAPA_MULTI_QUEUE_RX_SUPPORT / 32,
+                      BIT(IWL_UCODE_TLV_CAPA_MULTI_QUEUE_RX_SUPPORT % 32), 0, 0) {
+    mvm_ = iwl_trans_get_mvm(sim_trans_.iwl_trans());
+    mvmvif_ = reinterpret_cast<struct iwl_mvm_vif*>(calloc(1, sizeof(struct iwl_mvm_vif)));
+    mvmvif_->mvm = mvm_;
+    mvmvif_->mac_role = WLAN_MAC_ROLE_CLIENT;
+    mvmvif_->ifc.ops = reinterpret_cast<wlan_softmac_ifc_protocol_ops_t*>(
+        calloc(1, sizeof(wlan_softmac_ifc_protocol_ops_t)));
+    mvm_->mvmvif[0] = mvmvif_;
+    mvm_->vif_count++;
+
+    // Record the sequence number of every frame passed to MLME.
+    mvmvif_->ifc.ctx = &received_sns_;
+    mvmvif_->ifc.ops->recv = [](void* ctx, const wlan_rx_packet_t* packet) {
+      auto received_sns = reinterpret_cast<std::vector<uint16_t>*>(ctx);
+      auto frame = reinterpret_cast<const struct ieee80211_frame_header*>(packet->mac_frame_buffer);
+      received_sns->push_back(IEEE80211_SEQ_TO_SN(frame->seq_ctrl));
+    };
+
+    // A station as iwl_mvm_add_sta() would have set it up.
+    sta_.sta_id = 0;
+    sta_.mvmvif = mvmvif_;
+    memcpy(sta_.addr, kStaAddr, sizeof(sta_.addr));
+    for (size_t i = 0; i < std::size(sta_.tid_to_baid); ++i) {
+      sta_.tid_to_baid[i] = IWL_RX_REORDER_DATA_INVALID_BAID;
+    }
+    sta_.dup_data = reinterpret_cast<struct iwl_mvm_rxq_dup_data*>(
+        calloc(mvm_->trans->num_rx_queues, sizeof(struct iwl_mvm_rxq_dup_data)));
+    for (int q = 0; q < mvm_->trans->num_rx_queues; ++q) {
+      memset(sta_.dup_data[q].last_seq, 0xff, sizeof(sta_.dup_data[q].last_seq));
+    }
+    mvm_->fw_id_to_mac_id[0] = &sta_;
+
+    mtx_lock(&mvm_->mutex);
+  }
+
+  ~RxReorderTest() __TA_NO_THREAD_SAFETY_ANALYSIS {
+    if (sta_.tid_to_baid[kTid] != IWL_RX_REORDER_DATA_INVALID_BAID) {
+      EXPECT_OK(iwl_mvm_sta_rx_agg(mvm_, &sta_, kTid, 0, false, 0, 0));
+    }
+    mvm_->fw_id_to_mac_id[0] = nullptr;
+    free(sta_.dup_data);
+    free(mvmvif_->ifc.ops);
+    free(mvmvif_);
+    mtx_unlock(&mvm_->mutex);
+  }
+
+ protected:
+  // Inject a QoS data MPDU from the station on RX queue 'queue'. If 'in_ba' is true, the firmware
+  // reports it in the BA session, with the NSSN 'nssn'.
+  void InjectMpdu(uint16_t sn, uint16_t nssn, bool retry = false, bool in_ba = true,
+                  int queue = 0) {
+    struct {
+      char mpdu_desc[IWL_RX_DESC_SIZE_V1];
+      struct ieee80211_frame_header frame;
+      uint16_t qos_ctrl;
+      uint8_t mac_payload[kMacPayloadLen];
+    } __packed mpdu = {};
+    struct iwl_rx_mpdu_desc* desc = reinterpret_cast<struct iwl_rx_mpdu_desc*>(mpdu.mpdu_desc);
+    desc->mpdu_len = sizeof(mpdu.frame) + sizeof(mpdu.qos_ctrl) + kMacPayloadLen;
+    FillDesc(desc, in_ba ? kBaid : IWL_RX_REORDER_DATA_INVALID_BAID, sn, nssn);
+    mpdu.frame.frame_ctrl = 0x88 | (retry ? 0x800 : 0);  // QoS data frame
+    memcpy(mpdu.frame.addr2, kStaAddr, sizeof(mpdu.frame.addr2));
+    mpdu.frame.seq_ctrl = sn << IEEE80211_SCTL_SEQ_OFFSET;
+    mpdu.qos_ctrl = kTid;
+
+    TestRxcb rxcb(sim_trans_.iwl_trans()->dev, &mpdu, sizeof(mpdu));
+    iwl_mvm_rx_mpdu_mq(mvm_, nullptr /* napi */, &rxcb, queue);
+  }
+
+  // Inject a Block Ack Request for the BA session. The firmware reports the NSSN 'nssn' for it.
+  void InjectBar(uint16_t nssn) {
+    struct {
+      char mpdu_desc[IWL_RX_DESC_SIZE_V1];
+      struct ieee80211_bar bar;
+      uint8_t fcs[4];
+    } __packed mpdu = {};
+    struct iwl_rx_mpdu_desc* desc = reinterpret_cast<struct iwl_rx_mpdu_desc*>(mpdu.mpdu_desc);
+    desc->mpdu_len = sizeof(mpdu.bar) + sizeof(mpdu.fcs);
+    FillDesc(desc, kBaid, nssn, nssn);
+    mpdu.bar.frame_ctrl = 0x84;  // Block Ack Request
+    memcpy(mpdu.bar.ta, kStaAddr, sizeof(mpdu.bar.ta));
+    mpdu.bar.control = kTid << IEEE80211_BAR_CTRL_TID_INFO_SHIFT;
+    mpdu.bar.start_seq_num = nssn << IEEE80211_SCTL_SEQ_OFFSET;
+
+    TestRxcb rxcb(sim_trans_.iwl_trans()->dev, &mpdu, sizeof(mpdu));
+    iwl_mvm_rx_mpdu_mq(mvm_, nullptr /* napi */, &rxcb, 0);
+  }
+
+  struct iwl_mvm_baid_data* baid_data() { return mvm_->baid_map[kBaid]; }
+
+  const uint8_t kStaAddr[ETH_ALEN] = {0x02, 0x03, 0x04, 0x05, 0x06, 0x07};
+
+  struct iwl_mvm* mvm_;
+  struct iwl_mvm_vif* mvmvif_;
+  struct iwl_mvm_sta sta_ = {};
+  std::vector<uint16_t> received_sns_;
+
+  static void FillDesc(struct iwl_rx_mpdu_desc* desc, uint8_t baid, uint16_t sn, uint16_t nssn) {
+    desc->v1.channel = kChannel;
+    desc->v1.energy_a = 0x7f;
+    desc->v1.energy_b = 0x28;
+    desc->v1.rate_n_flags = 0x820a;
+    desc->status = IWL_RX_MPDU_STATUS_CRC_OK | IWL_RX_MPDU_STATUS_OVERRUN_OK |
+                   IWL_RX_MPDU_STATUS_SRC_STA_FOUND;
+    desc->sta_id_flags = 0;  // sta_id
+    desc->reorder_data = (baid << IWL_RX_MPDU_REORDER_BAID_SHIFT) |
+                         (sn << IWL_RX_MPDU_REORDER_SN_SHIFT) | nssn;
+  }
+};
+
+TEST_F(RxReorderTest, StartStopSession) {
+  ASSERT_OK(iwl_mvm_sta_rx_agg(mvm_, &sta_, kTid, kSsn, true, kBufSize, 0));
+  EXPECT_EQ(kBaid, sta_.tid_to_baid[kTid]);
+  ASSERT_NE(nullptr, baid_data());
+  EXPECT_EQ(kTid, baid_data()->tid);
+  EXPECT_EQ(sta_.sta_id, baid_data()->sta_id);
+  EXPECT_EQ(kSsn, baid_data()->reorder_buf[0].head_sn);
+  EXPECT_EQ(kBufSize, baid_data()->reorder_buf[0].buf_size);
+  EXPECT_EQ(1, mvm_->rx_ba_sessions);
+
+  ASSERT_OK(iwl_mvm_sta_rx_agg(mvm_, &sta_, kTid, 0, false, 0, 0));
+  EXPECT_EQ(IWL_RX_REORDER_DATA_INVALID_BAID, sta_.tid_to_baid[kTid]);
+  EXPECT_EQ(nullptr, baid_data());
+  EXPECT_EQ(0, mvm_->rx_ba_sessions);
+}
+
+TEST_F(RxReorderTest, InOrderFramesPassThrough) {
+  ASSERT_OK(iwl_mvm_sta_rx_agg(mvm_, &sta_, kTid, kSsn, true, kBufSize, 0));
+
+  InjectMpdu(kSsn, kSsn + 1);
+  InjectMpdu(kSsn + 1, kSsn + 2);
+  EXPECT_EQ((std::vector<uint16_t>{kSsn, kSsn + 1}), received_sns_);
+  EXPECT_EQ(0, baid_data()->reorder_buf[0].num_stored);
+  EXPECT_EQ(kSsn + 2, baid_data()->reorder_buf[0].head_sn);
+}
+
+TEST_F(RxReorderTest, OutOfOrderFramesAreReordered) {
+  ASSERT_OK(iwl_mvm_sta_rx_agg(mvm_, &sta_, kTid, kSsn, true, kBufSize, 0));
+
+  // The firmware doesn't advance the NSSN over the hole.
+  InjectMpdu(kSsn + 2, kSsn);
+  InjectMpdu(kSsn + 1, kSsn);
+  EXPECT_TRUE(received_sns_.empty());
+  EXPECT_EQ(2, baid_data()->reorder_buf[0].num_stored);
+
+  // The hole is filled.
+  InjectMpdu(kSsn, kSsn + 3);
+  EXPECT_EQ((std::vector<uint16_t>{kSsn, kSsn + 1, kSsn + 2}), received_sns_);
+  EXPECT_EQ(0, baid_data()->reorder_buf[0].num_stored);
+  EXPECT_EQ(kSsn + 3, baid_data()->reorder_buf[0].head_sn);
+}
+
+TEST_F(RxReorderTest, DuplicateAndOldFramesAreDropped) {
+  ASSERT_OK(iwl_mvm_sta_rx_agg(mvm_, &sta_, kTid, kSsn, true, kBufSize, 0));
+
+  InjectMpdu(kSsn + 1, kSsn);
+  InjectMpdu(kSsn + 1, kSsn);  // already held in the reorder buffer
+  EXPECT_EQ(1, baid_data()->reorder_buf[0].num_stored);
+
+  InjectMpdu(kSsn, kSsn + 2);
+  EXPECT_EQ((std::vector<uint16_t>{kSsn, kSsn + 1}), received_sns_);
+
+  InjectMpdu(kSsn + 1, kSsn + 2);  // behind the head of the window
+  EXPECT_EQ((std::vector<uint16_t>{kSsn, kSsn + 1}), received_sns_);
+}
+
+TEST_F(RxReorderTest, FrameReleaseNotification) {
+  ASSERT_OK(iwl_mvm_sta_rx_agg(mvm_, &sta_, kTid, kSsn, true, kBufSize, 0));
+
+  InjectMpdu(kSsn + 1, kSsn);
+  EXPECT_TRUE(received_sns_.empty());
+
+  // The firmware tells that the frame at the hole will never come.
+  struct iwl_frame_release release = {
+      .baid = kBaid,
+      .nssn = cpu_to_le16(kSsn + 2),
+  };
+  TestRxcb rxcb(sim_trans_.iwl_trans()->dev, &release, sizeof(release));
+  iwl_mvm_rx_frame_release(mvm_, nullptr /* napi */, &rxcb, 0);
+  EXPECT_EQ((std::vector<uint16_t>{kSsn + 1}), received_sns_);
+  EXPECT_EQ(kSsn + 2, baid_data()->reorder_buf[0].head_sn);
+}
+
+TEST_F(RxReorderTest, BlockAckRequestReleasesFrames) {
+  ASSERT_OK(iwl_mvm_sta_rx_agg(mvm_, &sta_, kTid, kSsn, true, kBufSize, 0));
+
+  InjectMpdu(kSsn + 2, kSsn);
+  EXPECT_TRUE(received_sns_.empty());
+
+  // The BAR itself is consumed by the driver.
+  InjectBar(kSsn + 3);
+  EXPECT_EQ((std::vector<uint16_t>{kSsn + 2}), received_sns_);
+  EXPECT_EQ(kSsn + 3, baid_data()->reorder_buf[0].head_sn);
+}
+
+TEST_F(RxReorderTest, ReorderTimeoutReleasesFrames) {
+  ASSERT_OK(iwl_mvm_sta_rx_agg(mvm_, &sta_, kTid, kSsn, true, kBufSize, 0));
+
+  InjectMpdu(kSsn + 1, kSsn);
+  InjectMpdu(kSsn + 3, kSsn);
+  EXPECT_TRUE(received_sns_.empty());
+
+  // Only the first frame has been held for too long. The frames behind the next hole are kept.
+  struct iwl_mvm_reorder_buffer* reorder_buf = &baid_data()->reorder_buf[0];
+  baid_data()->entries[(kSsn + 1) % kBufSize].reorder_time -= ZX_SEC(1);
+  iwl_mvm_reorder_timer_expired(reorder_buf);
+  EXPECT_EQ((std::vector<uint16_t>{kSsn + 1}), received_sns_);
+  EXPECT_EQ(kSsn + 2, reorder_buf->head_sn);
+  EXPECT_EQ(1, reorder_buf->num_stored);
+}
+
+TEST_F(RxReorderTest, StopSessionFlushesFrames) {
+  ASSERT_OK(iwl_mvm_sta_rx_agg(mvm_, &sta_, kTid, kSsn, true, kBufSize, 0));
+
+  InjectMpdu(kSsn + 1, kSsn);
+  InjectMpdu(kSsn + 2, kSsn);
+  EXPECT_TRUE(received_sns_.empty());
+
+  ASSERT_OK(iwl_mvm_sta_rx_agg(mvm_, &sta_, kTid, 0, false, 0, 0));
+  EXPECT_EQ((std::vector<uint16_t>{kSsn + 1, kSsn + 2}), received_sns_);
+}
+
+// The reorder timer fires while the session is torn down, after the RCU sync of the teardown. The
+// BA data is only freed once the timer function has returned.
+TEST_F(RxReorderTest, StopSessionWhileTimerFires) {
+  ASSERT_OK(iwl_mvm_sta_rx_agg(mvm_, &sta_, kTid, kSsn, true, kBufSize, 0));
+  InjectMpdu(kSsn + 1, kSsn);
+  ASSERT_EQ(1, baid_data()->reorder_buf[0].num_stored);
+
+  // The teardown flushes the held frame to MLME with the buffer lock held. Fire the timer from
+  // there, and give it the time to block on that lock.
+  struct TimerCtx {
+    struct iwl_irq_timer* timer;
+    std::vector<uint16_t> received_sns;
+  } ctx = {.timer = baid_data()->reorder_buf[0].reorder_timer};
+  mvmvif_->ifc.ctx = &ctx;
+  mvmvif_->ifc.ops->recv = [](void* ctx, const wlan_rx_packet_t* packet) {
+    auto timer_ctx = reinterpret_cast<TimerCtx*>(ctx);
+    auto frame = reinterpret_cast<const struct ieee80211_frame_header*>(packet->mac_frame_buffer);
+    timer_ctx->received_sns.push_back(IEEE80211_SEQ_TO_SN(frame->seq_ctrl));
+    EXPECT_OK(iwl_irq_timer_start(timer_ctx->timer, 0));
+    zx_nanosleep(zx_deadline_after(ZX_MSEC(10)));
+  };
+
+  ASSERT_OK(iwl_mvm_sta_rx_agg(mvm_, &sta_, kTid, 0, false, 0, 0));
+  EXPECT_EQ((std::vector<uint16_t>{kSsn + 1}), ctx.received_sns);
+  EXPECT_EQ(nullptr, baid_data());
+}
+
+TEST_F(RxReorderTest, RetransmissionIsDropped) {
+  // No BA session. The duplicate detection still applies.
+  InjectMpdu(10, 0, false, false);
+  InjectMpdu(10, 0, true, false);  // a retransmission of the previous frame
+  InjectMpdu(11, 0, true, false);  // a retransmission of a frame we missed
+  EXPECT_EQ((std::vector<uint16_t>{10, 11}), received_sns_);
+}
+
+// The session follows the Block Ack action frames exchanged between the station and MLME.
+TEST_F(RxReorderTest, SessionFollowsBlockAckActions) {
+  // The ADDBA request from the station carries the starting sequence number.
+  struct {
+    char mpdu_desc[IWL_RX_DESC_SIZE_V1];
+    struct ieee80211_frame_header frame;
+    struct ieee80211_back_action action;
+  } __packed mpdu = {};
+  struct iwl_rx_mpdu_desc* desc = reinterpret_cast<struct iwl_rx_mpdu_desc*>(mpdu.mpdu_desc);
+  desc->mpdu_len = sizeof(mpdu.frame) + sizeof(mpdu.action);
+  FillDesc(desc, IWL_RX_REORDER_DATA_INVALID_BAID, 0, 0);
+  mpdu.frame.frame_ctrl = 0xd0;  // Action frame
+  memcpy(mpdu.frame.addr2, kStaAddr, sizeof(mpdu.frame.addr2));
+  mpdu.action.category = IEEE80211_ACTION_CATEGORY_BACK;
+  mpdu.action.action = IEEE80211_BACK_ACTION_ADDBA_REQ;
+  mpdu.action.u.addba_req.params = kTid << IEEE80211_ADDBA_PARAM_TID_SHIFT;
+  mpdu.action.u.addba_req.start_seq_num = kSsn << IEEE80211_SCTL_SEQ_OFFSET;
+  TestRxcb rxcb(sim_trans_.iwl_trans()->dev, &mpdu, sizeof(mpdu));
+  iwl_mvm_rx_mpdu_mq(mvm_, nullptr /* napi */, &rxcb, 0);
+  EXPECT_EQ(1u, received_sns_.size());
+  EXPECT_EQ(kSsn, sta_.rx_ba_req_ssn[kTid]);
+  EXPECT_EQ(IWL_RX_REORDER_DATA_INVALID_BAID, sta_.tid_to_baid[kTid]);
+
+  // MLME accepts it.
+  struct ieee80211_back_action resp = {
+      .category = IEEE80211_ACTION_CATEGORY_BACK,
+      .action = IEEE80211_BACK_ACTION_ADDBA_RESP,
+  };
+  resp.u.addba_resp.status = IEEE80211_STATUS_SUCCESS;
+  resp.u.addba_resp.params = (kTid << IEEE80211_ADDBA_PARAM_TID_SHIFT) |
+                             (kBufSize << IEEE80211_ADDBA_PARAM_BUF_SIZE_SHIFT);
+  iwl_mvm_sta_tx_ba_action(mvm_, &sta_, reinterpret_cast<const uint8_t*>(&resp), sizeof(resp));
+  EXPECT_EQ(kBaid, sta_.tid_to_baid[kTid]);
+  ASSERT_NE(nullptr, baid_data());
+  EXPECT_EQ(kSsn, baid_data()->reorder_buf[0].head_sn);
+  EXPECT_EQ(kBufSize, baid_data()->reorder_buf[0].buf_size);
+  EXPECT_EQ(1, mvm_->rx_ba_sessions);
+
+  // A DELBA about a TX BA session, as the originator, does not touch it.
+  struct ieee80211_back_action delba = {
+      .category = IEEE80211_ACTION_CATEGORY_BACK,
+      .action = IEEE80211_BACK_ACTION_DELBA,
+  };
+  delba.u.delba.params =
+      IEEE80211_DELBA_PARAM_INITIATOR_MASK | (kTid << IEEE80211_DELBA_PARAM_TID_SHIFT);
+  iwl_mvm_sta_tx_ba_action(mvm_, &sta_, reinterpret_cast<const uint8_t*>(&delba), sizeof(delba));
+  EXPECT_EQ(kBaid, sta_.tid_to_baid[kTid]);
+
+  // MLME tears it down as the recipient.
+  delba.u.delba.params = kTid << IEEE80211_DELBA_PARAM_TID_SHIFT;
+  iwl_mvm_sta_tx_ba_action(mvm_, &sta_, reinterpret_cast<const uint8_t*>(&delba), sizeof(delba));
+  EXPECT_EQ(IWL_RX_REORDER_DATA_INVALID_BAID, sta_.tid_to_baid[kTid]);
+  EXPECT_EQ(nullptr, baid_data());
+  EXPECT_EQ(0, mvm_->rx_ba_sessions);
+}
+
+// The RSS queues are each processed on their own RX thread, as the PCIe transport does.
+class RxQueueThreadTest : public RxReorderTest {
+ public:
+  static constexpr int kNumRxQueues = 3;
+
+  RxQueueThreadTest() {
+    saved_num_rx_queues_ = mvm_->trans->num_rx_queues;
+    mvm_->trans->num_rx_queues = kNumRxQueues;
+    free(sta_.dup_data);
+    sta_.dup_data = reinterpret_cast<struct iwl_mvm_rxq_dup_data*>(
+        calloc(kNumRxQueues, sizeof(struct iwl_mvm_rxq_dup_data)));
+    for (int q = 0; q < kNumRxQueues; ++q) {
+      memset(sta_.dup_data[q].last_seq, 0xff, sizeof(sta_.dup_data[q].last_seq));
+    }
+
+    // Each frame passed to MLME waits (for a bounded time) until a frame from every RSS queue is
+    // inside MLME at the same time, which can only happen if the queues run in parallel.
+    mvmvif_->ifc.ctx = this;
+    mvmvif_->ifc.ops->recv = [](void* ctx, const wlan_rx_packet_t* packet) {
+      auto test = reinterpret_cast<RxQueueThreadTest*>(ctx);
+      std::unique_lock<std::mutex> lock(test->recv_lock_);
+      ++test->in_recv_;
+      test->recv_cv_.notify_all();
+      if (test->recv_cv_.wait_for(lock, std::chrono::seconds(5),
+                                  [test]() { return test->in_recv_ == kNumRxQueues - 1; })) {
+        ++test->concurrent_;
+      }
+    };
+
+    for (int q = 1; q < kNumRxQueues; ++q) {
+      queues_[q] = {.test = this, .queue = q};
+      ASSERT_OK(iwl_irq_thread_create(sim_trans_.iwl_trans()->dev, "iwlwifi-test-rx-worker",
+                                      nullptr, &RxQueueThreadTest::RxThread, &queues_[q],
+                                      &queues_[q].thread));
+    }
+  }
+
+  ~RxQueueThreadTest() {
+    for (int q = 1; q < kNumRxQueues; ++q) {
+      iwl_irq_thread_release_sync(queues_[q].thread);
+    }
+    mvm_->trans->num_rx_queues = saved_num_rx_queues_;
+  }
+
+ protected:
+  struct RxQueue {
+    RxQueueThreadTest* test;
+    int queue;
+    struct iwl_irq_thread* thread;
+    sync_completion_t done;
+  };
+
+  // The RX thread function: receive one frame, with an SN unique to the queue.
+  static void RxThread(void* data) {
+    auto rxq = reinterpret_cast<RxQueue*>(data);
+    rxq->test->InjectMpdu(rxq->queue, 0, false, false, rxq->queue);
+    sync_completion_signal(&rxq->done);
+  }
+
+  RxQueue queues_[kNumRxQueues] = {};
+  int saved_num_rx_queues_;
+  std::mutex recv_lock_;
+  std::condition_variable recv_cv_;
+  int in_recv_ = 0;
+  int concurrent_ = 0;
+};
+
+TEST_F(RxQueueThreadTest, QueuesAreProcessedInParallel) {
+  for (int q = 1; q < kNumRxQueues; ++q) {
+    ASSERT_OK(iwl_irq_thread_wake(queues_[q].thread));
+  }
+  for (int q = 1; q < kNumRxQueues; ++q) {
+    ASSERT_OK(sync_completion_wait(&queues_[q].done, ZX_TIME_INFINITE));
+  }
+  EXPECT_EQ(kNumRxQueues - 1, in_recv_);
+  EXPECT_EQ(kNumRxQueues - 1, concurrent_);
+}
+
 }  // namespace
 }  // namespace testing
 }  // namespace wlan
@@ -22,9 +22,11 @@
 #include <lib/zx/bti.h>
 #include <zircon/listnode.h>
 
+#include <algorithm>
 #include <array>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include <zxtest/zxtest.h>
 
@@ -97,18 +99,26 @@ TEST(MockDdkTesterPci, DeviceLifeCycle) {
 
 class PcieTest;
 
+// Records the last write pointer published to the device, for the tests that wait for a doorbell
+// rung from the TX batch timer.
+static sync_completion_t doorbell_rung;
+static uint32_t doorbell_val;
+static void DoorbellWrite32(struct iwl_trans* trans, uint32_t ofs, uint32_t val) {
+  if (ofs != HBUS_TARG_WRPTR) {
+    return;
+  }
+  doorbell_val = val;
+  sync_completion_signal(&doorbell_rung);
+}
+
 struct iwl_trans_pcie_wrapper {
   struct iwl_trans_pcie trans_pcie;
   PcieTest* test;
 };
 
-// In the SyncHostCommandEmpty() test, this function will generate an ECHO response in order to
-// simulate the firmware event for iwl_pcie_hcmd_complete().
-static void FakeEchoWrite32(struct iwl_trans* trans, uint32_t ofs, uint32_t val) {
-  if (ofs != HBUS_TARG_WRPTR) {
-    return;
-  }
-
+// Generate an ECHO response to the oldest command in the command queue, in order to simulate the
+// firmware event for iwl_pcie_hcmd_complete().
+static void RespondToHostCommand(struct iwl_trans* trans) {
   struct iwl_iobuf* io_buf = nullptr;
   ASSERT_OK(iwl_iobuf_allocate_contiguous(trans->dev, 128, &io_buf));
   struct iwl_rx_cmd_buffer rxcb = {
@@ -126,6 +136,21 @@ static void FakeEchoWrite32(struct iwl_trans* trans, uint32_t ofs, uint32_t val)
   resp_pkt->hdr.sequence =
       cpu_to_le16(QUEUE_TO_SEQ(trans_pcie->cmd_queue) | INDEX_TO_SEQ(txq->read_ptr));
 
+  iwl_pcie_hcmd_complete(trans, &rxcb);
+
+  iwl_iobuf_release(io_buf);
+}
+
+// In the SyncHostCommandEmpty() test, this function responds to the command as soon as it is
+// written to the device.
+static void FakeEchoWrite32(struct iwl_trans* trans, uint32_t ofs, uint32_t val) {
+  if (ofs != HBUS_TARG_WRPTR) {
+    return;
+  }
+
+  struct iwl_trans_pcie* trans_pcie = IWL_TRANS_GET_PCIE_TRANS(trans);
+  struct iwl_txq* txq = trans_pcie->txq[trans_pcie->cmd_queue];
+
   // iwl_pcie_hcmd_complete() will require the txq->lock. However, we already have done it in
   // iwl_trans_pcie_send_hcmd(). So release the lock before calling it. Note that this is safe
   // because in the test, it is always single thread and has no race.
@@ -140,12 +165,9 @@ static void FakeEchoWrite32(struct iwl_trans* trans, uint32_t ofs, uint32_t val)
 #pragma GCC diagnostic ignored "-Wthread-safety-analysis"
   mtx_unlock(&trans_pcie->reg_lock);
   mtx_unlock(&txq->lock);
-  iwl_pcie_hcmd_complete(trans, &rxcb);
+  RespondToHostCommand(trans);
   mtx_lock(&txq->lock);
   mtx_lock(&trans_pcie->reg_lock);
-
-  iwl_iobuf_release(io_buf);
-  io_buf = nullptr;
 }
 #pragma GCC diagnostic pop
 
@@ -570,6 +592,139 @@ TEST_F(PcieTest, RxInterrupts) {
   iwl_pcie_free_ict(trans_);
 }
 
+// With rx_queue_threads set, an RX interrupt wakes the thread of each RSS queue instead of handling
+// the queue inline, and the threads can be quiesced.
+TEST_F(PcieTest, RxQueueThreads) {
+  trans_->num_rx_queues = 2;
+  trans_pcie_->rx_queue_threads = true;
+  trans_pcie_->rx_buf_size = IWL_AMSDU_2K;
+  trans_pcie_->use_ict = true;
+  trans_pcie_->inta_mask = CSR_INI_SET_MASK;
+  set_bit(STATUS_DEVICE_ENABLED, &trans_->status);
+  ASSERT_OK(iwl_pcie_alloc_ict(trans_));
+  ASSERT_OK(iwl_pcie_rx_init(trans_));
+  EXPECT_NULL(trans_pcie_->rxq[0].rx_thread);
+  ASSERT_NOT_NULL(trans_pcie_->rxq[1].rx_thread);
+
+  uint32_t* ict_table = static_cast<uint32_t*>(iwl_iobuf_virtual(trans_pcie_->ict_tbl));
+  trans_pcie_->ict_index = 0;
+  ict_table[0] = static_cast<uint32_t>(CSR_INT_BIT_FH_RX) >> 16;
+  ict_table[1] = 0;
+
+  // Each handled queue records one (empty) RX batch. Holding the lock of queue 1 blocks its thread,
+  // but not the interrupt, which only handles queue 0 itself.
+  const size_t batches = iwl_stats_read_hist(IWL_STATS_HIST_RX_BATCH, 0);
+  mtx_lock(&trans_pcie_->rxq[1].lock);
+  ASSERT_OK(iwl_pcie_isr(trans_));
+  EXPECT_EQ(batches + 1, iwl_stats_read_hist(IWL_STATS_HIST_RX_BATCH, 0));
+  mtx_unlock(&trans_pcie_->rxq[1].lock);
+
+  iwl_pcie_rx_sync_threads(trans_);
+  EXPECT_EQ(batches + 2, iwl_stats_read_hist(IWL_STATS_HIST_RX_BATCH, 0));
+
+  iwl_pcie_rx_free(trans_);
+  iwl_pcie_free_ict(trans_);
+}
+
+// By default, all the RX queues are handled inline on the interrupt thread.
+TEST_F(PcieTest, RxQueuesInline) {
+  trans_->num_rx_queues = 2;
+  trans_pcie_->rx_buf_size = IWL_AMSDU_2K;
+  trans_pcie_->use_ict = true;
+  trans_pcie_->inta_mask = CSR_INI_SET_MASK;
+  set_bit(STATUS_DEVICE_ENABLED, &trans_->status);
+  ASSERT_OK(iwl_pcie_alloc_ict(trans_));
+  ASSERT_OK(iwl_pcie_rx_init(trans_));
+  EXPECT_NULL(trans_pcie_->rxq[0].rx_thread);
+  EXPECT_NULL(trans_pcie_->rxq[1].rx_thread);
+
+  uint32_t* ict_table = static_cast<uint32_t*>(iwl_iobuf_virtual(trans_pcie_->ict_tbl));
+  trans_pcie_->ict_index = 0;
+  ict_table[0] = static_cast<uint32_t>(CSR_INT_BIT_FH_RX) >> 16;
+  ict_table[1] = 0;
+
+  const size_t batches = iwl_stats_read_hist(IWL_STATS_HIST_RX_BATCH, 0);
+  ASSERT_OK(iwl_pcie_isr(trans_));
+  EXPECT_EQ(batches + 2, iwl_stats_read_hist(IWL_STATS_HIST_RX_BATCH, 0));
+
+  iwl_pcie_rx_free(trans_);
+  iwl_pcie_free_ict(trans_);
+}
+
+// Records the firmware chunks kicked to the FH service channel, and completes each of them at once
+// as the FH_TX interrupt would.
+struct FwChunk {
+  uint32_t dst_addr;
+  uint32_t byte_cnt;
+  std::vector<uint8_t> staged;  // The content of the expected staging buffer at kick time.
+};
+static std::vector<FwChunk> fw_chunks;
+static uint32_t fw_chunk_dst_addr;
+static void FwChunkWrite32(struct iwl_trans* trans, uint32_t ofs, uint32_t val) {
+  struct iwl_trans_pcie* trans_pcie = IWL_TRANS_GET_PCIE_TRANS(trans);
+
+  if (ofs == FH_SRVC_CHNL_SRAM_ADDR_REG(FH_SRVC_CHNL)) {
+    fw_chunk_dst_addr = val;
+  } else if (ofs == FH_TFDIB_CTRL1_REG(FH_SRVC_CHNL)) {
+    FwChunk chunk = {
+        .dst_addr = fw_chunk_dst_addr,
+        .byte_cnt = val & (BIT(FH_MEM_TFDIB_REG1_ADDR_BITSHIFT) - 1),
+    };
+    // The chunks must alternate between the staging buffers.
+    const uint8_t* staged = static_cast<const uint8_t*>(iwl_iobuf_virtual(
+        trans_pcie->fw_staging[fw_chunks.size() % IWL_PCIE_FW_STAGING_BUFS]));
+    chunk.staged.assign(staged, staged + chunk.byte_cnt);
+    fw_chunks.push_back(std::move(chunk));
+  } else if (ofs == FH_TCSR_CHNL_TX_CONFIG_REG(FH_SRVC_CHNL) &&
+             (val & FH_TCSR_TX_CONFIG_REG_VAL_DMA_CHNL_ENABLE)) {
+    trans_pcie->ucode_write_complete = true;
+    sync_completion_signal(&trans_pcie->ucode_write_waitq);
+  }
+}
+
+TEST_F(PcieTest, LoadFirmwareSection) {
+  trans_ops_.write32 = FwChunkWrite32;
+  ASSERT_OK(iwl_pcie_alloc_fw_staging(trans_));
+  struct iwl_iobuf* staging[IWL_PCIE_FW_STAGING_BUFS];
+  memcpy(staging, trans_pcie_->fw_staging, sizeof(staging));
+
+  // Two and a half chunks.
+  std::vector<uint8_t> data(FH_MEM_TB_MAX_LENGTH * 2 + FH_MEM_TB_MAX_LENGTH / 2);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<uint8_t>(i * 7 + i / FH_MEM_TB_MAX_LENGTH);
+  }
+  const struct fw_desc section = {
+      .data = data.data(),
+      .len = static_cast<uint32_t>(data.size()),
+      .offset = 0x1000,
+  };
+
+  // Load it twice, as the firmware restart would.
+  for (int load = 0; load < 2; ++load) {
+    fw_chunks.clear();
+    memset(&trans_pcie_->fw_load_stats, 0, sizeof(trans_pcie_->fw_load_stats));
+    ASSERT_OK(iwl_pcie_load_section(trans_, 0, &section));
+
+    ASSERT_EQ(fw_chunks.size(), 3);
+    for (size_t i = 0; i < fw_chunks.size(); ++i) {
+      const size_t offset = i * FH_MEM_TB_MAX_LENGTH;
+      const size_t len = std::min<size_t>(FH_MEM_TB_MAX_LENGTH, data.size() - offset);
+      EXPECT_EQ(fw_chunks[i].dst_addr, section.offset + offset);
+      EXPECT_EQ(fw_chunks[i].byte_cnt, len);
+      EXPECT_BYTES_EQ(fw_chunks[i].staged.data(), data.data() + offset, len);
+    }
+    EXPECT_EQ(trans_pcie_->fw_load_stats.bytes, data.size());
+    EXPECT_EQ(trans_pcie_->fw_load_stats.chunks, 3);
+
+    // The staging buffers are kept across loads.
+    EXPECT_BYTES_EQ(trans_pcie_->fw_staging, staging, sizeof(staging));
+  }
+
+  iwl_pcie_free_fw_staging(trans_);
+  EXPECT_NULL(trans_pcie_->fw_staging[0]);
+  EXPECT_NULL(trans_pcie_->fw_staging[1]);
+}
+
 class TxTest : public PcieTest {
   void SetUp() {
     base_params_.num_of_queues = 31;
@@ -725,6 +880,93 @@ TEST_F(TxTest, AsyncLargeHostCommands) {
   EXPECT_EQ(iwl_trans_pcie_send_hcmd(trans_, &dup_hcmd), ZX_OK);
 }
 
+// Records the calls to a host command completion callback.
+struct HostCmdCompletion {
+  int count = 0;
+  zx_status_t status = ZX_ERR_INTERNAL;
+  uint8_t resp_cmd = 0;
+
+  static void Complete(void* ctx, zx_status_t status, struct iwl_rx_packet* pkt) {
+    auto completion = static_cast<HostCmdCompletion*>(ctx);
+    completion->count++;
+    completion->status = status;
+    completion->resp_cmd = pkt ? pkt->hdr.cmd : 0;
+  }
+};
+
+TEST_F(TxTest, AsyncHostCommandCompletion) {
+  ASSERT_OK(iwl_pcie_tx_init(trans_));
+  HostCmdCompletion completion;
+  struct iwl_host_cmd hcmd = {
+      .flags = CMD_ASYNC,
+      .id = ECHO_CMD,
+      .complete = HostCmdCompletion::Complete,
+      .complete_ctx = &completion,
+  };
+
+  ASSERT_OK(iwl_trans_pcie_send_hcmd(trans_, &hcmd));
+  EXPECT_EQ(0, completion.count);
+
+  RespondToHostCommand(trans_);
+  EXPECT_EQ(1, completion.count);
+  EXPECT_OK(completion.status);
+  EXPECT_EQ(ECHO_CMD, completion.resp_cmd);
+}
+
+TEST_F(TxTest, AsyncHostCommandCanceled) {
+  ASSERT_OK(iwl_pcie_tx_init(trans_));
+  HostCmdCompletion completion;
+  struct iwl_host_cmd hcmd = {
+      .flags = CMD_ASYNC,
+      .id = ECHO_CMD,
+      .complete = HostCmdCompletion::Complete,
+      .complete_ctx = &completion,
+  };
+
+  ASSERT_OK(iwl_trans_pcie_send_hcmd(trans_, &hcmd));
+  iwl_pcie_txq_unmap(trans_, trans_pcie_->cmd_queue);
+  EXPECT_EQ(1, completion.count);
+  EXPECT_EQ(ZX_ERR_CANCELED, completion.status);
+}
+
+TEST_F(TxTest, BatchedHostCommands) {
+  ASSERT_OK(iwl_pcie_tx_init(trans_));
+  trans_ops_.send_cmd = iwl_trans_pcie_send_hcmd;
+  trans_->state = IWL_TRANS_FW_ALIVE;
+  struct iwl_txq* txq = trans_pcie_->txq[trans_pcie_->cmd_queue];
+
+  struct iwl_hcmd_batch batch;
+  iwl_hcmd_batch_init(&batch);
+  EXPECT_OK(iwl_hcmd_batch_wait(trans_, &batch));  // Nothing in flight.
+
+  // All the commands are queued without waiting for a response.
+  constexpr int kCmds = 3;
+  for (int i = 0; i < kCmds; i++) {
+    struct iwl_host_cmd hcmd = {
+        .flags = CMD_PIPELINED,
+        .id = ECHO_CMD,
+    };
+    ASSERT_OK(iwl_trans_send_cmd_batched(trans_, &batch, &hcmd));
+  }
+  EXPECT_EQ(kCmds, txq->write_ptr - txq->read_ptr);
+
+  // The batch is done once the firmware has responded to all of them.
+  for (int i = 0; i < kCmds; i++) {
+    EXPECT_EQ(ZX_ERR_TIMED_OUT, sync_completion_wait(&batch.done, 0));
+    RespondToHostCommand(trans_);
+  }
+  EXPECT_OK(iwl_hcmd_batch_wait(trans_, &batch));
+  EXPECT_EQ(txq->read_ptr, txq->write_ptr);
+
+  // A command whose response is needed cannot be batched.
+  struct iwl_host_cmd want_skb_cmd = {
+      .flags = CMD_WANT_SKB,
+      .id = ECHO_CMD,
+  };
+  EXPECT_EQ(ZX_ERR_INVALID_ARGS, iwl_trans_send_cmd_batched(trans_, &batch, &want_skb_cmd));
+  EXPECT_OK(iwl_hcmd_batch_wait(trans_, &batch));
+}
+
 TEST_F(TxTest, SyncTwoFragmentsWithOneDup) {
   ASSERT_OK(iwl_pcie_tx_init(trans_));
   // Must be long enough so that len(fragment1+iwl_cmd_header) >= IWL_FIRST_TB_SIZE(20)
@@ -1050,6 +1292,33 @@ TEST_F(TxTest, TxNormal) {
   unref_.VerifyAndClear();
 }
 
+static size_t hist_samples(enum iwl_stats_histogram_index index) {
+  size_t samples = 0;
+  for (size_t bucket = 0; bucket < IWL_STATS_HIST_BUCKETS; ++bucket) {
+    samples += iwl_stats_read_hist(index, bucket);
+  }
+  return samples;
+}
+
+// The TX path records the queue occupancy on enqueue, and the latency on reclaim.
+TEST_F(TxTest, TxStatsHistograms) {
+  SetupTxQueue();
+  SetupTxPacket();
+  const size_t occupancy = hist_samples(IWL_STATS_HIST_TXQ_OCCUPANCY);
+  const size_t latency = hist_samples(IWL_STATS_HIST_TX_LATENCY_US);
+
+  ref_.ExpectCall();
+  ASSERT_EQ(ZX_OK, iwl_trans_pcie_tx(trans_, wlan_pkt_->mac_pkt(), &dev_cmd_, txq_id_));
+  ref_.VerifyAndClear();
+  EXPECT_EQ(occupancy + 1, hist_samples(IWL_STATS_HIST_TXQ_OCCUPANCY));
+  EXPECT_EQ(latency, hist_samples(IWL_STATS_HIST_TX_LATENCY_US));
+
+  unref_.ExpectCall();
+  iwl_trans_pcie_reclaim(trans_, txq_id_, /*ssn*/ 1);
+  unref_.VerifyAndClear();
+  EXPECT_EQ(latency + 1, hist_samples(IWL_STATS_HIST_TX_LATENCY_US));
+}
+
 // Note that even the number of queued packets exceed the high mark, the function still returns
 // OK. Beside checking the txq->write_ptr, we also expect queue_full is called.
 //
@@ -1069,4 +1338,196 @@ TEST_F(TxTest, TxSoManyPackets) {
   op_mode_queue_not_full_.VerifyAndClear();
 }
 
+// The TX command and payload buffers of a data frame are taken from the per-queue slabs and given
+// back when the frame is reclaimed.
+//
+TEST_F(TxTest, TxUsesSlab) {
+  SetupTxQueue();
+  SetupTxPacket();
+
+  ASSERT_NOT_NULL(txq_->cmd_pool);
+  ASSERT_NOT_NULL(txq_->data_pool);
+  const size_t cmd_available = iwl_iobuf_pool_available(txq_->cmd_pool);
+  const size_t data_available = iwl_iobuf_pool_available(txq_->data_pool);
+  EXPECT_EQ(TFD_TX_CMD_SLOTS, cmd_available);
+  EXPECT_EQ(TFD_TX_CMD_SLOTS, data_available);
+
+  ref_.ExpectCall();
+  ASSERT_EQ(ZX_OK, iwl_trans_pcie_tx(trans_, wlan_pkt_->mac_pkt(), &dev_cmd_, txq_id_));
+  ref_.VerifyAndClear();
+  EXPECT_EQ(cmd_available - 1, iwl_iobuf_pool_available(txq_->cmd_pool));
+  EXPECT_EQ(data_available - 1, iwl_iobuf_pool_available(txq_->data_pool));
+  EXPECT_EQ(IWL_TX_SLAB_DATA_BUF_SIZE, iwl_iobuf_size(txq_->entries[0].dup_io_buf));
+
+  unref_.ExpectCall();
+  iwl_trans_pcie_reclaim(trans_, txq_id_, /*ssn*/ 1);
+  unref_.VerifyAndClear();
+  EXPECT_EQ(cmd_available, iwl_iobuf_pool_available(txq_->cmd_pool));
+  EXPECT_EQ(data_available, iwl_iobuf_pool_available(txq_->data_pool));
+  EXPECT_NULL(txq_->entries[0].cmd);
+  EXPECT_NULL(txq_->entries[0].dup_io_buf);
+  EXPECT_EQ(0, txq_->slab_exhausted);
+}
+
+// The slabs of a data queue only exist while the queue is enabled.
+//
+TEST_F(TxTest, SlabsFollowQueueEnable) {
+  ASSERT_OK(iwl_pcie_tx_init(trans_));
+  struct iwl_trans_pcie* trans_pcie = IWL_TRANS_GET_PCIE_TRANS(trans_);
+  txq_id_ = IWL_MVM_DQA_MIN_DATA_QUEUE;
+  txq_ = trans_pcie->txq[txq_id_];
+  EXPECT_NULL(txq_->cmd_pool);
+  EXPECT_NULL(txq_->data_pool);
+
+  iwl_trans_txq_scd_cfg scd_cfg = {};
+  ASSERT_FALSE(iwl_trans_pcie_txq_enable(trans_, txq_id_, /*ssn*/ 0, &scd_cfg, /*wdg_timeout*/ 0));
+  ASSERT_NOT_NULL(txq_->cmd_pool);
+  ASSERT_NOT_NULL(txq_->data_pool);
+  EXPECT_EQ(TFD_TX_CMD_SLOTS, iwl_iobuf_pool_available(txq_->data_pool));
+
+  iwl_trans_pcie_txq_disable(trans_, txq_id_, /*configure_scd*/ false);
+  EXPECT_NULL(txq_->cmd_pool);
+  EXPECT_NULL(txq_->data_pool);
+
+  // The command queue never has slabs.
+  EXPECT_NULL(trans_pcie->txq[trans_pcie->cmd_queue]->cmd_pool);
+  EXPECT_NULL(trans_pcie->txq[trans_pcie->cmd_queue]->data_pool);
+}
+
+// With TX batching on, the write pointer is published once for the whole batch instead of once per
+// frame.
+TEST_F(TxTest, TxBatchDoorbell) {
+  trans_pcie_->tx_batch_size = 4;
+  trans_pcie_->tx_batch_timeout = ZX_SEC(3600);
+  SetupTxQueue();
+  SetupTxPacket();
+
+  // Any other doorbell write would not match the expectations. The first frame finds the queue
+  // idle and is published on its own, the next four are published together.
+  mock_write32_.ExpectCall(HBUS_TARG_WRPTR, 1 | (txq_id_ << 8));
+  mock_write32_.ExpectCall(HBUS_TARG_WRPTR, 5 | (txq_id_ << 8));
+  ref_.ExpectCall();
+  ASSERT_EQ(ZX_OK, iwl_trans_pcie_tx(trans_, wlan_pkt_->mac_pkt(), &dev_cmd_, txq_id_));
+  EXPECT_EQ(0, txq_->batch_len);
+  for (int i = 0; i < 3; i++) {
+    ASSERT_EQ(ZX_OK, iwl_trans_pcie_tx(trans_, wlan_pkt_->mac_pkt(), &dev_cmd_, txq_id_));
+    EXPECT_EQ(i + 2, txq_->write_ptr);
+    EXPECT_EQ(i + 1, txq_->batch_len);
+  }
+  ASSERT_EQ(ZX_OK, iwl_trans_pcie_tx(trans_, wlan_pkt_->mac_pkt(), &dev_cmd_, txq_id_));
+  EXPECT_EQ(0, txq_->batch_len);
+  mock_write32_.VerifyAndClear();
+  ref_.VerifyAndClear();
+
+  // A partial batch can be flushed explicitly.
+  ASSERT_EQ(ZX_OK, iwl_trans_pcie_tx(trans_, wlan_pkt_->mac_pkt(), &dev_cmd_, txq_id_));
+  EXPECT_EQ(1, txq_->batch_len);
+  mock_write32_.ExpectCall(HBUS_TARG_WRPTR, 6 | (txq_id_ << 8));
+  iwl_pcie_txq_batch_flush(trans_, txq_);
+  EXPECT_EQ(0, txq_->batch_len);
+  mock_write32_.VerifyAndClear();
+}
+
+// A frame put on an idle queue does not wait for the batch deadline, and neither does the first
+// frame after the device has drained the queue.
+TEST_F(TxTest, TxBatchIdleQueue) {
+  trans_pcie_->tx_batch_size = 4;
+  trans_pcie_->tx_batch_timeout = ZX_SEC(3600);
+  SetupTxQueue();
+  SetupTxPacket();
+
+  mock_write32_.ExpectCall(HBUS_TARG_WRPTR, 1 | (txq_id_ << 8));
+  ref_.ExpectCall();
+  ASSERT_EQ(ZX_OK, iwl_trans_pcie_tx(trans_, wlan_pkt_->mac_pkt(), &dev_cmd_, txq_id_));
+  EXPECT_EQ(0, txq_->batch_len);
+  mock_write32_.VerifyAndClear();
+  ref_.VerifyAndClear();
+
+  unref_.ExpectCall();
+  iwl_trans_pcie_reclaim(trans_, txq_id_, /*ssn*/ 1);
+  unref_.VerifyAndClear();
+
+  mock_write32_.ExpectCall(HBUS_TARG_WRPTR, 2 | (txq_id_ << 8));
+  ref_.ExpectCall();
+  ASSERT_EQ(ZX_OK, iwl_trans_pcie_tx(trans_, wlan_pkt_->mac_pkt(), &dev_cmd_, txq_id_));
+  EXPECT_EQ(0, txq_->batch_len);
+  mock_write32_.VerifyAndClear();
+  ref_.VerifyAndClear();
+}
+
+// A partial batch is published by the batch timer once the deadline passes.
+TEST_F(TxTest, TxBatchDeadline) {
+  trans_pcie_->tx_batch_size = 4;
+  trans_pcie_->tx_batch_timeout = ZX_MSEC(1);
+  SetupTxQueue();
+  SetupTxPacket();
+
+  // Keep the queue busy so that the next frame is batched.
+  mock_write32_.ExpectCall(HBUS_TARG_WRPTR, 1 | (txq_id_ << 8));
+  ASSERT_EQ(ZX_OK, iwl_trans_pcie_tx(trans_, wlan_pkt_->mac_pkt(), &dev_cmd_, txq_id_));
+  mock_write32_.VerifyAndClear();
+
+  sync_completion_reset(&doorbell_rung);
+  trans_ops_.write32 = DoorbellWrite32;
+  ASSERT_EQ(ZX_OK, iwl_trans_pcie_tx(trans_, wlan_pkt_->mac_pkt(), &dev_cmd_, txq_id_));
+  ASSERT_OK(sync_completion_wait(&doorbell_rung, ZX_TIME_INFINITE));
+
+  mtx_lock(&txq_->lock);
+  EXPECT_EQ(2 | (txq_id_ << 8), doorbell_val);
+  EXPECT_EQ(0, txq_->batch_len);
+  mtx_unlock(&txq_->lock);
+}
+
+// The pending batch is published right away when the queue runs low, so that the frames holding
+// the queue stopped are visible to the device.
+TEST_F(TxTest, TxBatchFlushWhenQueueLow) {
+  trans_pcie_->tx_batch_size = TFD_QUEUE_SIZE_MAX;
+  trans_pcie_->tx_batch_timeout = ZX_SEC(3600);
+  SetupTxQueue();
+  SetupTxPacket();
+
+  op_mode_queue_full_.ExpectCall(txq_id_);
+  while (iwl_queue_space(trans_, txq_) >= txq_->high_mark) {
+    ASSERT_EQ(ZX_OK, iwl_trans_pcie_tx(trans_, wlan_pkt_->mac_pkt(), &dev_cmd_, txq_id_));
+  }
+  EXPECT_EQ(0, txq_->batch_len);
+
+  // The next frame stops the queue and is published on its own.
+  ASSERT_EQ(ZX_OK, iwl_trans_pcie_tx(trans_, wlan_pkt_->mac_pkt(), &dev_cmd_, txq_id_));
+  EXPECT_EQ(0, txq_->batch_len);
+  op_mode_queue_full_.VerifyAndClear();
+}
+
+// When the data slab is empty, the TX path falls back to a dedicated allocation and counts it.
+//
+TEST_F(TxTest, TxSlabExhausted) {
+  SetupTxQueue();
+  SetupTxPacket();
+
+  std::vector<struct iwl_iobuf*> bufs;
+  struct iwl_iobuf* buf = nullptr;
+  while (iwl_iobuf_pool_acquire(txq_->data_pool, &buf) == ZX_OK) {
+    bufs.push_back(buf);
+  }
+  const size_t exhausted = iwl_stats_read(IWL_STATS_CNT_TX_SLAB_EXHAUSTED);
+
+  ref_.ExpectCall();
+  ASSERT_EQ(ZX_OK, iwl_trans_pcie_tx(trans_, wlan_pkt_->mac_pkt(), &dev_cmd_, txq_id_));
+  ref_.VerifyAndClear();
+  EXPECT_EQ(1, txq_->slab_exhausted);
+  EXPECT_EQ(exhausted + 1, iwl_stats_read(IWL_STATS_CNT_TX_SLAB_EXHAUSTED));
+  ASSERT_NOT_NULL(txq_->entries[0].dup_io_buf);
+  EXPECT_EQ(wlan_pkt_->mac_pkt()->headroom_used_size + wlan_pkt_->mac_pkt()->body_size,
+            iwl_iobuf_size(txq_->entries[0].dup_io_buf));
+
+  unref_.ExpectCall();
+  iwl_trans_pcie_reclaim(trans_, txq_id_, /*ssn*/ 1);
+  unref_.VerifyAndClear();
+  EXPECT_EQ(0, iwl_iobuf_pool_available(txq_->data_pool));
+
+  for (auto b : bufs) {
+    iwl_iobuf_release(b);
+  }
+}
+
 }  // namespace
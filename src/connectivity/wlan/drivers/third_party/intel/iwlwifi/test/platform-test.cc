@@ -3,11 +3,20 @@
 //
 // Unittest code for the platform-support code in platform/.
 
+#include <lib/async-testing/test_loop.h>
+#include <lib/inspect/cpp/hierarchy.h>
+#include <lib/inspect/cpp/reader.h>
+
+#include <thread>
+#include <vector>
+
 #include <zxtest/zxtest.h>
 
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/compiler.h"
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/debug.h"
+#include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/driver-inspector.h"
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/kernel.h"
+#include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/stats.h"
 
 namespace {
 
@@ -245,4 +254,89 @@ TEST_F(PlatformTest, HexDumpZeroByte) {
   EXPECT_EQ(' ', buf[50]);                      // nothing dumped
   EXPECT_EQ('\0', buf[HEX_DUMP_BUF_SIZE - 1]);  // null-terminator
 }
+
+TEST_F(PlatformTest, StatsCountersFromManyThreads) {
+  ::async::TestLoop test_loop;
+  iwl_stats_init(test_loop.dispatcher());
+
+  constexpr int kThreads = 4;
+  constexpr int kIncrements = 1000;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; ++i) {
+    threads.emplace_back([]() {
+      for (int j = 0; j < kIncrements; ++j) {
+        iwl_stats_inc(IWL_STATS_CNT_DATA_TO_FW);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(kThreads * kIncrements, iwl_stats_read(IWL_STATS_CNT_DATA_TO_FW));
+
+  // Re-initializing resets the counters on every shard.
+  iwl_stats_init(test_loop.dispatcher());
+  EXPECT_EQ(0, iwl_stats_read(IWL_STATS_CNT_DATA_TO_FW));
+}
+
+TEST_F(PlatformTest, StatsHistogramBuckets) {
+  ::async::TestLoop test_loop;
+  iwl_stats_init(test_loop.dispatcher());
+
+  for (uint64_t value : {0, 1, 2, 3, 4, 7, 8}) {
+    iwl_stats_hist_add(IWL_STATS_HIST_RX_BATCH, value);
+  }
+  iwl_stats_hist_add(IWL_STATS_HIST_RX_BATCH, UINT64_MAX);
+
+  EXPECT_EQ(1, iwl_stats_read_hist(IWL_STATS_HIST_RX_BATCH, 0));  // 0
+  EXPECT_EQ(1, iwl_stats_read_hist(IWL_STATS_HIST_RX_BATCH, 1));  // 1
+  EXPECT_EQ(2, iwl_stats_read_hist(IWL_STATS_HIST_RX_BATCH, 2));  // 2, 3
+  EXPECT_EQ(2, iwl_stats_read_hist(IWL_STATS_HIST_RX_BATCH, 3));  // 4, 7
+  EXPECT_EQ(1, iwl_stats_read_hist(IWL_STATS_HIST_RX_BATCH, 4));  // 8
+  EXPECT_EQ(1, iwl_stats_read_hist(IWL_STATS_HIST_RX_BATCH, IWL_STATS_HIST_BUCKETS - 1));
+  EXPECT_EQ(0, iwl_stats_read_hist(IWL_STATS_HIST_TX_LATENCY_US, 0));
+}
+
+TEST_F(PlatformTest, StatsPublishedToInspect) {
+  ::async::TestLoop test_loop;
+  auto inspector = std::make_unique<wlan::iwlwifi::DriverInspector>(
+      wlan::iwlwifi::DriverInspectorOptions{.root_name = "test_inspector", .vmo_size = 64 * 1024});
+  iwl_stats_init(test_loop.dispatcher());
+  iwl_stats_publish(static_cast<struct driver_inspector*>(inspector.get()));
+
+  iwl_stats_inc(IWL_STATS_CNT_DATA_TO_FW);
+  iwl_stats_hist_add(IWL_STATS_HIST_HCMD_RTT_US, 3);
+  iwl_stats_hist_add(IWL_STATS_HIST_HCMD_RTT_US, 3);
+
+  // The Inspect values are refreshed by the periodical task.
+  iwl_stats_start_reporting();
+  test_loop.RunUntilIdle();
+
+  auto root_hierarchy = ::inspect::ReadFromVmo(inspector->DuplicateVmo()).take_value();
+  auto hierarchy = root_hierarchy.GetByPath({"test_inspector", "stats"});
+  ASSERT_NOT_NULL(hierarchy);
+
+  auto data_to_fw = hierarchy->node().get_property<::inspect::UintPropertyValue>("data_to_fw");
+  ASSERT_NOT_NULL(data_to_fw);
+  EXPECT_EQ(1, data_to_fw->value());
+
+  auto hcmd_rtt = hierarchy->node().get_property<::inspect::UintArrayValue>("hcmd_rtt_us");
+  ASSERT_NOT_NULL(hcmd_rtt);
+  bool found = false;
+  for (const auto& bucket : hcmd_rtt->GetBuckets()) {
+    if (bucket.floor == 2) {
+      EXPECT_EQ(4, bucket.upper_limit);
+      EXPECT_EQ(2, bucket.count);
+      found = true;
+    } else {
+      EXPECT_EQ(0, bucket.count);
+    }
+  }
+  EXPECT_TRUE(found);
+
+  iwl_stats_publish(nullptr);
+  root_hierarchy = ::inspect::ReadFromVmo(inspector->DuplicateVmo()).take_value();
+  EXPECT_NULL(root_hierarchy.GetByPath({"test_inspector", "stats"}));
+}
+
 }  // namespace
@@ -0,0 +1,106 @@
+// Copyright 2022 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Contention benchmark for the RcuManager: the cost of a read-side section on one thread, while
+// other threads run read-side sections and writers wait for grace periods.
+
+#include <lib/async-loop/cpp/loop.h>
+#include <lib/async-loop/default.h>
+#include <lib/async/cpp/task.h>
+#include <lib/sync/completion.h>
+#include <zircon/time.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <perftest/perftest.h>
+
+#include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/rcu-manager.h"
+
+namespace wlan::testing {
+namespace {
+
+enum class WriterType {
+  kSync,      // Writers block in Sync().
+  kCallSync,  // Writers queue CallSync() callbacks.
+};
+
+// Measure a read-side section on the benchmark thread, while `readers` other threads run read-side
+// sections and `writers` threads continuously start grace periods.
+bool ReadLockBenchmark(perftest::RepeatState* state, int readers, int writers, WriterType type) {
+  ::async::Loop loop(&kAsyncLoopConfigNoAttachToCurrentThread);
+  loop.StartThread("rcu-benchmark-worker");
+  auto manager = std::make_unique<::wlan::iwlwifi::RcuManager>(loop.dispatcher());
+  ::async::PostTask(loop.dispatcher(), [&]() { manager->InitForThread(); });
+
+  std::atomic<bool> stop = false;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < readers; ++i) {
+    threads.emplace_back([&]() {
+      manager->InitForThread();
+      while (!stop.load(std::memory_order_relaxed)) {
+        manager->ReadLock();
+        manager->ReadUnlock();
+      }
+    });
+  }
+  for (int i = 0; i < writers; ++i) {
+    threads.emplace_back([&]() {
+      manager->InitForThread();
+      while (!stop.load(std::memory_order_relaxed)) {
+        if (type == WriterType::kSync) {
+          manager->Sync();
+        } else {
+          // Wait for each callback, so that the queue does not grow without bound.
+          sync_completion_t called = {};
+          manager->CallSync(
+              [](void* data) { sync_completion_signal(static_cast<sync_completion_t*>(data)); },
+              &called);
+          sync_completion_wait(&called, ZX_TIME_INFINITE);
+        }
+      }
+    });
+  }
+
+  manager->InitForThread();
+  volatile int protected_data = 0;
+  while (state->KeepRunning()) {
+    manager->ReadLock();
+    protected_data = protected_data + 1;
+    manager->ReadUnlock();
+  }
+
+  stop.store(true, std::memory_order_relaxed);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  loop.Shutdown();
+  return true;
+}
+
+void RegisterTests() {
+  for (int readers : {0, 3}) {
+    for (int writers : {0, 1, 4}) {
+      perftest::RegisterTest(
+          ("RcuManager/ReadLock/Readers" + std::to_string(readers) + "/SyncWriters" +
+           std::to_string(writers))
+              .c_str(),
+          ReadLockBenchmark, readers, writers, WriterType::kSync);
+    }
+    perftest::RegisterTest(
+        ("RcuManager/ReadLock/Readers" + std::to_string(readers) + "/CallSyncWriters4").c_str(),
+        ReadLockBenchmark, readers, 4, WriterType::kCallSync);
+  }
+}
+PERFTEST_CTOR(RegisterTests)
+
+}  // namespace
+}  // namespace wlan::testing
+
+int main(int argc, char** argv) {
+  return perftest::PerfTestMain(argc, argv, "fuchsia.wlan.iwlwifi.rcu_manager");
+}
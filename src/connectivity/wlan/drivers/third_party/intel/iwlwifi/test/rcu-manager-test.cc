@@ -6,10 +6,14 @@
 
 #include <lib/async-testing/test_loop.h>
 #include <lib/sync/completion.h>
+#include <zircon/syscalls.h>
 #include <zircon/time.h>
 
+#include <atomic>
+#include <iterator>
 #include <memory>
 #include <thread>
+#include <vector>
 
 #include <zxtest/zxtest.h>
 
@@ -96,7 +100,11 @@ TEST(RcuManagerTest, CallSync) {
   // Prepare a call that will execute after all read-side locks are unlocked.
   bool called = false;
   manager->CallSync([](void* data) { *reinterpret_cast<bool*>(data) = true; }, &called);
-  std::thread loop_thread([&]() { test_loop->RunUntilIdle(); });
+  std::thread loop_thread([&]() {
+    while (!called) {
+      test_loop->RunFor(ZX_MSEC(1));
+    }
+  });
   EXPECT_FALSE(called);
 
   // A nested lock will not cause the call to executed.
@@ -111,5 +119,107 @@ TEST(RcuManagerTest, CallSync) {
   EXPECT_TRUE(called);
 }
 
+TEST(RcuManagerTest, CallSyncBatched) {
+  auto test_loop = std::make_unique<::async::TestLoop>();
+  auto manager = std::make_unique<::wlan::iwlwifi::RcuManager>(test_loop->dispatcher());
+
+  manager->InitForThread();
+  manager->ReadLock();
+
+  // All the calls queued while the read-side lock is held wait for the same grace period, and run
+  // in the order they were queued.
+  std::vector<int> called;
+  struct Call {
+    std::vector<int>* called;
+    int index;
+  } calls[] = {{&called, 0}, {&called, 1}, {&called, 2}};
+  for (auto& call : calls) {
+    manager->CallSync(
+        [](void* data) {
+          auto call = reinterpret_cast<Call*>(data);
+          call->called->push_back(call->index);
+        },
+        &call);
+  }
+  std::thread loop_thread([&]() {
+    while (called.size() < std::size(calls)) {
+      test_loop->RunFor(ZX_MSEC(1));
+    }
+  });
+  EXPECT_TRUE(called.empty());
+
+  manager->ReadUnlock();
+  loop_thread.join();
+  EXPECT_EQ((std::vector<int>{0, 1, 2}), called);
+}
+
+// While a grace period is pending, the callbacks are polled for with a backoff, rather than by a
+// task that reposts itself right away and keeps the dispatcher busy.
+TEST(RcuManagerTest, CallSyncBacksOff) {
+  auto test_loop = std::make_unique<::async::TestLoop>();
+  auto manager = std::make_unique<::wlan::iwlwifi::RcuManager>(test_loop->dispatcher());
+
+  manager->InitForThread();
+  manager->ReadLock();
+
+  bool called = false;
+  manager->CallSync([](void* data) { *reinterpret_cast<bool*>(data) = true; }, &called);
+
+  // The dispatcher goes idle even though the grace period has not elapsed.
+  EXPECT_TRUE(test_loop->RunUntilIdle());
+  EXPECT_FALSE(called);
+  test_loop->RunFor(ZX_MSEC(10));
+  EXPECT_FALSE(called);
+
+  // The next poll, at most 1 msec later, runs the call.
+  manager->ReadUnlock();
+  test_loop->RunFor(ZX_MSEC(1));
+  EXPECT_TRUE(called);
+}
+
+// The read-side sections of one manager do not delay the grace periods of another, and entering a
+// read-side section of one manager does not hide the thread from the other.
+TEST(RcuManagerTest, ManagersAreIndependent) {
+  auto test_loop = std::make_unique<::async::TestLoop>();
+  auto manager_a = std::make_unique<::wlan::iwlwifi::RcuManager>(test_loop->dispatcher());
+  auto manager_b = std::make_unique<::wlan::iwlwifi::RcuManager>(test_loop->dispatcher());
+
+  manager_a->InitForThread();
+  manager_b->InitForThread();
+  manager_a->ReadLock();
+  manager_b->ReadLock();
+  manager_b->ReadUnlock();
+
+  std::thread sync_b_thread([&]() { manager_b->Sync(); });
+  sync_b_thread.join();
+
+  std::atomic<bool> synced = false;
+  std::thread sync_a_thread([&]() {
+    manager_a->Sync();
+    synced = true;
+  });
+  zx_nanosleep(zx_deadline_after(ZX_MSEC(10)));
+  EXPECT_FALSE(synced);
+
+  manager_a->ReadUnlock();
+  sync_a_thread.join();
+  EXPECT_TRUE(synced);
+}
+
+TEST(RcuManagerTest, ExitedThreadDoesNotBlockSync) {
+  auto test_loop = std::make_unique<::async::TestLoop>();
+  auto manager = std::make_unique<::wlan::iwlwifi::RcuManager>(test_loop->dispatcher());
+
+  // A thread that read-side locks, without calling InitForThread() first, and then exits.
+  std::thread lock_thread([&]() {
+    manager->ReadLock();
+    manager->ReadUnlock();
+  });
+  lock_thread.join();
+
+  manager->InitForThread();
+  manager->Sync();
+}
+
 }  // namespace
 }  // namespace wlan::testing
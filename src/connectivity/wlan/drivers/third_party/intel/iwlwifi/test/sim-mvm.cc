@@ -28,6 +28,21 @@ static void build_response_with_status(SimMvmResponse* resp, uint32_t status) {
   cmd_resp->status = cpu_to_le32(status);
 }
 
+// Returns the status of the ADD_STA command.  When a RX BA session is started, the firmware assigns
+// a BAID to it. The simulated firmware simply uses the TID as the BAID.
+static uint32_t add_sta_status(struct iwl_host_cmd* cmd) {
+  auto add_sta_cmd = reinterpret_cast<const struct iwl_mvm_add_sta_cmd*>(cmd->data[0]);
+  uint32_t status = ADD_STA_SUCCESS;
+
+  if (add_sta_cmd->add_modify == STA_MODE_MODIFY &&
+      (add_sta_cmd->modify_mask & STA_MODIFY_ADD_BA_TID)) {
+    status |= IWL_ADD_STA_BAID_VALID_MASK |
+              (add_sta_cmd->add_immediate_ba_tid << IWL_ADD_STA_BAID_SHIFT);
+  }
+
+  return status;
+}
+
 zx_status_t SimMvm::SendCmd(struct iwl_trans* trans, struct iwl_host_cmd* cmd, bool* notify_wait) {
   INSPECT_HOST_CMD(cmd);
   uint8_t opcode = iwl_cmd_opcode(cmd->id);
@@ -92,7 +107,11 @@ zx_status_t SimMvm::SendCmd(struct iwl_trans* trans, struct iwl_host_cmd* cmd, b
           ret = ZX_OK;
           break;
 
-        case ADD_STA:  // fall-thru
+        case ADD_STA:
+          build_response_with_status(&resp, add_sta_status(cmd));
+          ret = ZX_OK;
+          break;
+
         case REMOVE_STA:
         case ADD_STA_KEY:
           build_response_with_status(&resp, ADD_STA_SUCCESS);
@@ -136,7 +155,7 @@ zx_status_t SimMvm::SendCmd(struct iwl_trans* trans, struct iwl_host_cmd* cmd, b
   // Prepare the response packet buffer if the command requires a response.
   struct iwl_rx_packet* resp_pkt = reinterpret_cast<struct iwl_rx_packet*>(resp_buf_.data());
   ZX_ASSERT(sizeof(*resp_pkt) + resp.size() <= resp_buf_.size());  // avoid overflow
-  if (cmd->flags & CMD_WANT_SKB) {
+  if ((cmd->flags & CMD_WANT_SKB) || cmd->complete) {
     resp_pkt->len_n_flags = cpu_to_le32(resp.size());
     resp_pkt->hdr.cmd = opcode;
     resp_pkt->hdr.group_id = group_id;
@@ -22,8 +22,14 @@
 #include <fuchsia/hardware/wlanphyimpl/c/banjo.h>
 #include <lib/async-loop/cpp/loop.h>
 #include <lib/async-loop/default.h>
+#include <lib/async/cpp/task.h>
 #include <lib/fake-bti/bti.h>
+#include <lib/sync/completion.h>
+#include <lib/zx/time.h>
 #include <zircon/status.h>
+#include <zircon/syscalls.h>
+
+#include <vector>
 
 extern "C" {
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/fw/api/alive.h"
@@ -112,9 +118,42 @@ static void iwl_sim_trans_fw_alive(struct iwl_trans* trans, uint32_t scd_addr) {
 
 static void iwl_sim_trans_stop_device(struct iwl_trans* trans, bool low_power) {}
 
+// Deliver the response of an asynchronous command to its completion callback, like
+// iwl_pcie_hcmd_complete() does.
+static void complete_async_cmd(struct iwl_trans* trans, struct iwl_host_cmd* cmd) {
+  struct sim_trans_priv* sim_trans = IWL_TRANS_GET_SIM_TRANS(trans);
+
+  // Not all the simulated commands build a response. Make up an empty one for them.
+  iwl_rx_packet empty_pkt = {};
+  const struct iwl_rx_packet* pkt = cmd->resp_pkt;
+  if (!pkt) {
+    empty_pkt.len_n_flags = cpu_to_le32(sizeof(empty_pkt.hdr));
+    empty_pkt.hdr.cmd = iwl_cmd_opcode(cmd->id);
+    empty_pkt.hdr.group_id = iwl_cmd_groupid(cmd->id);
+    pkt = &empty_pkt;
+  }
+  cmd->resp_pkt = nullptr;
+
+  if (sim_trans->hcmd_latency == 0) {
+    cmd->complete(cmd->complete_ctx, ZX_OK, const_cast<struct iwl_rx_packet*>(pkt));
+    return;
+  }
+
+  // The response buffer is reused by the next command.
+  const char* bytes = reinterpret_cast<const char*>(pkt);
+  std::vector<char> resp(bytes, bytes + sizeof(*pkt) + iwl_rx_packet_payload_len(pkt));
+  ::async::PostTaskForTime(
+      sim_trans->irq_dispatcher,
+      [complete = cmd->complete, ctx = cmd->complete_ctx, resp = std::move(resp)]() mutable {
+        complete(ctx, ZX_OK, reinterpret_cast<struct iwl_rx_packet*>(resp.data()));
+      },
+      zx::time(zx_deadline_after(sim_trans->hcmd_latency)));
+}
+
 static zx_status_t iwl_sim_trans_send_cmd(struct iwl_trans* trans, struct iwl_host_cmd* cmd) {
+  struct sim_trans_priv* sim_trans = IWL_TRANS_GET_SIM_TRANS(trans);
   bool notify_wait;
-  zx_status_t ret = IWL_TRANS_GET_SIM_TRANS(trans)->fw->SendCmd(trans, cmd, &notify_wait);
+  zx_status_t ret = sim_trans->fw->SendCmd(trans, cmd, &notify_wait);
 
   // On real hardware, some particular commands would reply a packet to unblock the wait.
   // However, in the simulated firmware, we don't generate the packet. We unblock it directly.
@@ -122,6 +161,22 @@ static zx_status_t iwl_sim_trans_send_cmd(struct iwl_trans* trans, struct iwl_ho
     unblock_notif_wait(trans);
   }
 
+  if (!(cmd->flags & CMD_ASYNC)) {
+    sim_trans->sync_hcmds++;
+    if (sim_trans->hcmd_latency != 0) {
+      // The response is delivered like those of the pipelined commands, which 'irq_dispatcher' runs
+      // in deadline order: a SYNC command also waits for the commands queued before it.
+      sync_completion_t done;
+      ::async::PostTaskForTime(
+          sim_trans->irq_dispatcher, [&done]() { sync_completion_signal(&done); },
+          zx::time(zx_deadline_after(sim_trans->hcmd_latency)));
+      sync_completion_wait(&done, ZX_TIME_INFINITE);
+    }
+  } else if (cmd->complete && ret == ZX_OK) {
+    sim_trans->pipelined_hcmds++;
+    complete_async_cmd(trans, cmd);
+  }
+
   return ret;
 }
 
@@ -334,7 +389,16 @@ SimTransport::~SimTransport() {
 }
 
 zx_status_t SimTransport::Init() {
-  return sim_transport_bind(this, &device_, &iwl_trans_, &sim_device_);
+  zx_status_t status = sim_transport_bind(this, &device_, &iwl_trans_, &sim_device_);
+  if (status != ZX_OK) {
+    return status;
+  }
+  IWL_TRANS_GET_SIM_TRANS(iwl_trans_)->irq_dispatcher = device_.irq_dispatcher;
+  return ZX_OK;
+}
+
+void SimTransport::SetHostCmdLatency(zx_duration_t latency) {
+  IWL_TRANS_GET_SIM_TRANS(iwl_trans_)->hcmd_latency = latency;
 }
 
 struct iwl_trans* SimTransport::iwl_trans() {
@@ -13,6 +13,9 @@
 #ifndef SRC_CONNECTIVITY_WLAN_DRIVERS_THIRD_PARTY_INTEL_IWLWIFI_TEST_SIM_TRANS_H_
 #define SRC_CONNECTIVITY_WLAN_DRIVERS_THIRD_PARTY_INTEL_IWLWIFI_TEST_SIM_TRANS_H_
 
+#include <lib/async/dispatcher.h>
+#include <zircon/time.h>
+
 #include <memory>
 
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/kernel.h"
@@ -41,6 +44,17 @@ struct sim_trans_priv {
   // The pointer pointing back to a Test case for mock functions.  This must be initialized before
   // mock functions are called.
   void* test;
+
+  // The simulated time from queuing a host command to its response (DMA, firmware processing and
+  // interrupt). The completions of CMD_ASYNC commands are delivered on 'irq_dispatcher' after it,
+  // so that pipelined commands overlap. A SYNC command blocks until its own response, which comes
+  // after those of the commands sent before it. When 0, the commands complete immediately.
+  zx_duration_t hcmd_latency;
+  async_dispatcher_t* irq_dispatcher;
+
+  // The number of host commands the driver waited for, and the number it pipelined.
+  size_t sync_hcmds;
+  size_t pipelined_hcmds;
 };
 
 static inline struct sim_trans_priv* IWL_TRANS_GET_SIM_TRANS(struct iwl_trans* trans) {
@@ -55,6 +69,9 @@ class SimTransport : public SimMvm {
   // This function must be called before starting using other functions.
   zx_status_t Init();
 
+  // Set the simulated round trip of a host command. See sim_trans_priv::hcmd_latency.
+  void SetHostCmdLatency(zx_duration_t latency);
+
   // Member accessors.
   struct iwl_trans* iwl_trans();
   const struct iwl_trans* iwl_trans() const;
@@ -2,14 +2,20 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <lib/async-loop/cpp/loop.h>
+#include <lib/async-loop/default.h>
 #include <lib/async-testing/test_loop.h>
+#include <lib/sync/completion.h>
+#include <zircon/syscalls.h>
 #include <zircon/time.h>
 
+#include <atomic>
 #include <memory>
 #include <thread>
 
 #include <zxtest/zxtest.h>
 
+#include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/irq.h"
 #include "src/connectivity/wlan/drivers/third_party/intel/iwlwifi/platform/task-internal.h"
 
 namespace wlan::testing {
@@ -130,5 +136,151 @@ TEST(TaskTest, WaitTask) {
   EXPECT_TRUE(cancel_waited);
 }
 
+// Context for an IRQ thread function that blocks until released.
+struct IrqThreadCtx {
+  sync_completion_t entered;
+  sync_completion_t release;
+  std::atomic<int> calls = 0;
+};
+
+void IrqThreadFunc(void* data) {
+  auto ctx = reinterpret_cast<IrqThreadCtx*>(data);
+  ++ctx->calls;
+  sync_completion_signal(&ctx->entered);
+  sync_completion_wait(&ctx->release, ZX_TIME_INFINITE);
+}
+
+TEST(IrqThreadTest, WakeRunsFunction) {
+  struct device dev = {};
+  IrqThreadCtx ctx;
+  struct iwl_irq_thread* thread = nullptr;
+  ASSERT_OK(iwl_irq_thread_create(&dev, "iwlwifi-test-irq-thread", nullptr, &IrqThreadFunc, &ctx,
+                                  &thread));
+  sync_completion_signal(&ctx.release);
+  EXPECT_EQ(0, ctx.calls);
+
+  EXPECT_OK(iwl_irq_thread_wake(thread));
+  EXPECT_OK(sync_completion_wait(&ctx.entered, ZX_TIME_INFINITE));
+  iwl_irq_thread_release_sync(thread);
+  EXPECT_EQ(1, ctx.calls);
+}
+
+TEST(IrqThreadTest, WakeDuringExecution) {
+  struct device dev = {};
+  IrqThreadCtx ctx;
+  struct iwl_irq_thread* thread = nullptr;
+  ASSERT_OK(iwl_irq_thread_create(&dev, "iwlwifi-test-irq-thread", nullptr, &IrqThreadFunc, &ctx,
+                                  &thread));
+
+  EXPECT_OK(iwl_irq_thread_wake(thread));
+  EXPECT_OK(sync_completion_wait(&ctx.entered, ZX_TIME_INFINITE));
+  sync_completion_reset(&ctx.entered);
+
+  // Wakeups while the function is executing are not lost, but they are coalesced into one run.
+  EXPECT_OK(iwl_irq_thread_wake(thread));
+  EXPECT_OK(iwl_irq_thread_wake(thread));
+  sync_completion_signal(&ctx.release);
+  EXPECT_OK(sync_completion_wait(&ctx.entered, ZX_TIME_INFINITE));
+  iwl_irq_thread_release_sync(thread);
+  EXPECT_EQ(2, ctx.calls);
+}
+
+TEST(IrqThreadTest, SyncWaitsForFunction) {
+  struct device dev = {};
+  IrqThreadCtx ctx;
+  struct iwl_irq_thread* thread = nullptr;
+  ASSERT_OK(iwl_irq_thread_create(&dev, "iwlwifi-test-irq-thread", nullptr, &IrqThreadFunc, &ctx,
+                                  &thread));
+
+  // Nothing to wait for.
+  iwl_irq_thread_sync(thread);
+
+  EXPECT_OK(iwl_irq_thread_wake(thread));
+  EXPECT_OK(sync_completion_wait(&ctx.entered, ZX_TIME_INFINITE));
+  std::atomic<bool> synced = false;
+  std::thread syncer([&]() {
+    iwl_irq_thread_sync(thread);
+    synced = true;
+  });
+  zx_nanosleep(zx_deadline_after(ZX_MSEC(10)));
+  EXPECT_FALSE(synced);
+
+  sync_completion_signal(&ctx.release);
+  syncer.join();
+  EXPECT_TRUE(synced);
+  EXPECT_EQ(1, ctx.calls);
+  iwl_irq_thread_release_sync(thread);
+}
+
+// Stopping or releasing a timer whose function is executing waits for the function to return, so
+// that the function never runs on freed memory.
+TEST(IrqTimerTest, StopSyncWaitsForFunction) {
+  ::async::Loop loop(&kAsyncLoopConfigNoAttachToCurrentThread);
+  ASSERT_OK(loop.StartThread("iwlwifi-test-irq-timer"));
+  struct device dev = {};
+  dev.irq_dispatcher = loop.dispatcher();
+  IrqThreadCtx ctx;
+  struct iwl_irq_timer* timer = nullptr;
+  ASSERT_OK(iwl_irq_timer_create(&dev, &IrqThreadFunc, &ctx, &timer));
+
+  for (bool release : {false, true}) {
+    sync_completion_reset(&ctx.entered);
+    sync_completion_reset(&ctx.release);
+    ASSERT_OK(iwl_irq_timer_start(timer, 0));
+    ASSERT_OK(sync_completion_wait(&ctx.entered, ZX_TIME_INFINITE));
+
+    // The timer is no longer queued, but it is still executing.
+    EXPECT_EQ(ZX_ERR_NOT_FOUND, iwl_irq_timer_stop(timer));
+    std::atomic<bool> stopped = false;
+    std::thread stopper([&]() {
+      if (release) {
+        iwl_irq_timer_release_sync(timer);
+      } else {
+        EXPECT_EQ(ZX_ERR_NOT_FOUND, iwl_irq_timer_stop_sync(timer));
+      }
+      stopped = true;
+    });
+    zx_nanosleep(zx_deadline_after(ZX_MSEC(10)));
+    EXPECT_FALSE(stopped);
+
+    sync_completion_signal(&ctx.release);
+    stopper.join();
+    EXPECT_TRUE(stopped);
+  }
+  EXPECT_EQ(2, ctx.calls);
+}
+
+// A post made while the task is executing is not lost: the task runs again once its function
+// returns, with the posts made during one execution coalesced into one.
+TEST(TaskTest, PostWhileExecuting) {
+  ::async::Loop loop(&kAsyncLoopConfigNoAttachToCurrentThread);
+  ASSERT_OK(loop.StartThread("iwlwifi-test-task"));
+  IrqThreadCtx ctx;
+  auto task =
+      std::make_unique<::wlan::iwlwifi::TaskInternal>(loop.dispatcher(), &IrqThreadFunc, &ctx);
+
+  ASSERT_OK(task->Post(0));
+  ASSERT_OK(sync_completion_wait(&ctx.entered, ZX_TIME_INFINITE));
+  sync_completion_reset(&ctx.entered);
+  EXPECT_OK(task->Post(0));
+  EXPECT_OK(task->Post(0));
+  sync_completion_signal(&ctx.release);
+  ASSERT_OK(sync_completion_wait(&ctx.entered, ZX_TIME_INFINITE));
+  EXPECT_OK(task->Wait());
+  EXPECT_EQ(2, ctx.calls);
+
+  // Cancelling drops the pending post, but not the execution in progress.
+  sync_completion_reset(&ctx.entered);
+  sync_completion_reset(&ctx.release);
+  ASSERT_OK(task->Post(0));
+  ASSERT_OK(sync_completion_wait(&ctx.entered, ZX_TIME_INFINITE));
+  EXPECT_OK(task->Post(0));
+  EXPECT_OK(task->Cancel());
+  EXPECT_EQ(ZX_ERR_NOT_FOUND, task->Cancel());
+  sync_completion_signal(&ctx.release);
+  EXPECT_OK(task->Wait());
+  EXPECT_EQ(3, ctx.calls);
+}
+
 }  // namespace
 }  // namespace wlan::testing
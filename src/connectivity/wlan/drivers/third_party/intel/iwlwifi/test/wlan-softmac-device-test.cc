@@ -754,6 +754,93 @@ TEST_F(MacInterfaceTest, AssociateToOpenNetwork) {
   ASSERT_EQ(list_length(&mvm->time_event_list), 0);
 }
 
+// Connect to an open network when the simulated firmware takes some time to answer each host
+// command. The independent commands of each step are pipelined, so only the SYNC commands cost a
+// full round trip each: check the counts rather than the wall-clock time, which is not reliable.
+TEST_F(MacInterfaceTest, ConnectLatency) {
+  constexpr zx_duration_t kHostCmdLatency = ZX_MSEC(5);
+  struct sim_trans_priv* sim_trans = IWL_TRANS_GET_SIM_TRANS(sim_trans_.iwl_trans());
+  sim_trans->sync_hcmds = 0;
+  sim_trans->pipelined_hcmds = 0;
+  sim_trans_.SetHostCmdLatency(kHostCmdLatency);
+
+  ASSERT_EQ(ZX_OK, SetChannel(&kChannel));
+  ASSERT_EQ(ZX_OK, ConfigureBss(&kBssConfig));
+  ASSERT_EQ(ZX_OK, ConfigureAssoc(&kAssocCtx));
+  sim_trans_.SetHostCmdLatency(0);
+
+  // Some commands overlapped, so fewer round trips were waited for than commands were sent.
+  EXPECT_GT(sim_trans->sync_hcmds, 0);
+  EXPECT_GT(sim_trans->pipelined_hcmds, 0);
+  EXPECT_EQ(IWL_STA_AUTHORIZED, mvmvif_->mvm->fw_id_to_mac_id[mvmvif_->ap_sta_id]->sta_state);
+
+  ASSERT_EQ(ZX_OK, ClearAssoc());
+}
+
+// The WMM parameters are converted into the EDCA parameters of the firmware.
+TEST_F(MacInterfaceTest, UpdateWmmParams) {
+  wlan_wmm_params_t params = {
+      .apsd = false,
+      .ac_be_params = {.ecw_min = 4, .ecw_max = 10, .aifsn = 3, .txop_limit = 0},
+      .ac_bk_params = {.ecw_min = 4, .ecw_max = 10, .aifsn = 7, .txop_limit = 0},
+      .ac_vi_params = {.ecw_min = 3, .ecw_max = 4, .aifsn = 2, .txop_limit = 94},
+      .ac_vo_params = {.ecw_min = 2, .ecw_max = 3, .aifsn = 2, .txop_limit = 47},
+  };
+  ASSERT_EQ(ZX_OK, SetChannel(&kChannel));
+  ASSERT_EQ(ZX_OK, ConfigureBss(&kBssConfig));
+
+  // Not associated yet. The parameters are only recorded, for all four ACs.
+  ExpectSendCmd(expected_cmd_id_list({}));
+  ASSERT_EQ(ZX_OK, device_->WlanSoftmacUpdateWmmParams(WLAN_AC_VOICE, &params));
+  EXPECT_TRUE(mvmvif_->bss_conf.qos);
+  EXPECT_EQ(3, mvmvif_->queue_params[IEEE80211_AC_VO].cw_min);
+  EXPECT_EQ(7, mvmvif_->queue_params[IEEE80211_AC_VO].cw_max);
+  EXPECT_EQ(2, mvmvif_->queue_params[IEEE80211_AC_VO].aifs);
+  EXPECT_EQ(47, mvmvif_->queue_params[IEEE80211_AC_VO].txop);
+  EXPECT_EQ(7, mvmvif_->queue_params[IEEE80211_AC_VI].cw_min);
+  EXPECT_EQ(94, mvmvif_->queue_params[IEEE80211_AC_VI].txop);
+  EXPECT_EQ(15, mvmvif_->queue_params[IEEE80211_AC_BE].cw_min);
+  EXPECT_EQ(3, mvmvif_->queue_params[IEEE80211_AC_BE].aifs);
+  EXPECT_EQ(15, mvmvif_->queue_params[IEEE80211_AC_BK].cw_min);
+  EXPECT_EQ(7, mvmvif_->queue_params[IEEE80211_AC_BK].aifs);
+  ASSERT_EQ(ZX_OK, device_->WlanSoftmacUpdateWmmParams(WLAN_AC_BACKGROUND, &params));
+  EXPECT_EQ(15, mvmvif_->queue_params[IEEE80211_AC_BK].cw_min);
+  EXPECT_EQ(1023, mvmvif_->queue_params[IEEE80211_AC_BK].cw_max);
+  EXPECT_EQ(7, mvmvif_->queue_params[IEEE80211_AC_BK].aifs);
+  VerifyExpectation();
+  ResetSendCmdFunc();
+
+  // Once associated, the MAC context in the firmware is updated right away, once, and it carries
+  // all four ACs even if none was recorded before association.
+  ASSERT_EQ(ZX_OK, ConfigureAssoc(&kAssocCtx));
+  memset(mvmvif_->queue_params, 0, sizeof(mvmvif_->queue_params));
+  ExpectSendCmd(expected_cmd_id_list({
+      MockCommand(WIDE_ID(LONG_GROUP, MAC_CONTEXT_CMD)),
+  }));
+  ASSERT_EQ(ZX_OK, device_->WlanSoftmacUpdateWmmParams(WLAN_AC_VIDEO, &params));
+  EXPECT_EQ(7, mvmvif_->queue_params[IEEE80211_AC_VI].cw_min);
+  EXPECT_EQ(15, mvmvif_->queue_params[IEEE80211_AC_VI].cw_max);
+  EXPECT_EQ(94, mvmvif_->queue_params[IEEE80211_AC_VI].txop);
+  EXPECT_EQ(3, mvmvif_->queue_params[IEEE80211_AC_VO].cw_min);
+  EXPECT_EQ(47, mvmvif_->queue_params[IEEE80211_AC_VO].txop);
+  EXPECT_EQ(15, mvmvif_->queue_params[IEEE80211_AC_BE].cw_min);
+  EXPECT_EQ(1023, mvmvif_->queue_params[IEEE80211_AC_BE].cw_max);
+  EXPECT_EQ(3, mvmvif_->queue_params[IEEE80211_AC_BE].aifs);
+  EXPECT_EQ(15, mvmvif_->queue_params[IEEE80211_AC_BK].cw_min);
+  EXPECT_EQ(7, mvmvif_->queue_params[IEEE80211_AC_BK].aifs);
+  VerifyExpectation();
+  ResetSendCmdFunc();
+
+  ASSERT_EQ(ZX_OK, ClearAssoc());
+  EXPECT_FALSE(mvmvif_->bss_conf.qos);
+}
+
+TEST_F(MacInterfaceTest, UpdateWmmParamsInvalidAc) {
+  wlan_wmm_params_t params = {};
+  ASSERT_EQ(ZX_ERR_INVALID_ARGS,
+            device_->WlanSoftmacUpdateWmmParams(static_cast<wlan_ac_t>(0), &params));
+}
+
 // Check if calling iwl_mvm_mac_sta_state() sets the state correctly.
 TEST_F(MacInterfaceTest, CheckStaState) {
   ASSERT_EQ(ZX_OK, SetChannel(&kChannel));